@@ -0,0 +1,477 @@
+#pragma once
+
+#include <biovoltron/algo/align/exact_match/fm_index.hpp>
+#include <biovoltron/algo/align/inexact_match/smith_waterman.hpp>
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/file_io/sam.hpp>
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <tbb/parallel_for.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Seed-and-extend short read aligner.
+ *
+ * Each strand of a read is covered by maximal exact matches found by backward
+ * search on the FM-index, from the 3' end towards the 5' end. The occurrences
+ * of seeds of at least MIN_SEED_LEN bases are grouped into chains by their
+ * diagonal, and the heaviest chains are extended with SmithWaterman inside a
+ * window of the reference. Pairs are chosen among the candidates of both ends
+ * by their total score, and an unpaired end is rescued by aligning it around
+ * its mate. The MAPQ of an end of a proper pair is raised when its pair is
+ * better than any other pair.
+ *
+ * Reads are processed in batches of BATCH_SIZE in parallel. Every read only
+ * depends on itself and its mate, so the output is identical for any number
+ * of threads.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/algo/align/aligner.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto ref = FastaRecord<true>{};
+ *   std::ifstream{"chr22.fa"} >> ref;
+ *   auto index = FMIndex{};
+ *   index.build(ref);
+ *
+ *   auto reads = std::vector<FastqRecord<true>>{};
+ *   auto fin = std::ifstream{"chr22.fq"};
+ *   for (auto read = FastqRecord<true>{}; fin >> read;)
+ *     reads.push_back(read);
+ *
+ *   const auto aligner = Aligner{.ref = ref, .index = std::move(index)};
+ *   for (const auto& record : aligner.align(reads))
+ *     std::cout << record << "\n";
+ * }
+ * ```
+ */
+struct Aligner {
+  /**
+   * @brief Reference which the index was built from.
+   */
+  const FastaRecord<true>& ref;
+
+  /**
+   * @brief FM-index of the reference.
+   */
+  FMIndex index;
+
+  /**
+   * @brief Scoring scheme of the extension, in local mode.
+   */
+  SmithWaterman SW{};
+
+  /**
+   * @brief Minimum length of a seed.
+   */
+  int MIN_SEED_LEN = 19;
+
+  /**
+   * @brief Seeds with more occurrences are ignored.
+   */
+  int MAX_OCC = 100;
+
+  /**
+   * @brief Maximum number of chains extended per read.
+   */
+  int MAX_CHAINS = 8;
+
+  /**
+   * @brief Number of reference bases added at both sides of a chain before
+   * extension, which also bounds the size of indels.
+   */
+  int PAD = 32;
+
+  /**
+   * @brief Penalty of soft clipping an end of the read. A clip is replaced by
+   * matches and mismatches when they score higher than minus this penalty.
+   */
+  int CLIP_PENALTY = 5;
+
+  /**
+   * @brief Alignments with a lower score are reported as unmapped.
+   */
+  int MIN_SCORE = 30;
+
+  /**
+   * @brief Maximum template length of a proper pair.
+   */
+  int MAX_INSERT = 1000;
+
+  /**
+   * @brief Number of reads processed by one task.
+   */
+  int BATCH_SIZE = 256;
+
+ private:
+  struct Hit {
+    bool reverse;
+    std::int64_t diag;
+    std::uint32_t read_begin;
+    std::uint32_t size;
+  };
+
+  struct Candidate {
+    bool reverse;
+    std::uint32_t pos;
+    SmithWaterman::Alignment aln;
+  };
+
+  /*
+   * Backward search the longest exact matches of seq, from right to left,
+   * restarting before the base which breaks each match.
+   */
+  auto
+  seed(istring_view seq, bool reverse, std::vector<Hit>& hits) const {
+    for (auto end = seq.size(); end >= std::size_t(MIN_SEED_LEN);) {
+      auto beg_row = std::uint32_t{};
+      auto end_row = index.bwt_size;
+      auto begin = end;
+      for (; begin > 0; begin--) {
+        const auto c = seq[begin - 1];
+        if (c > 3)
+          break;
+        const auto b = index.cnt[c] + index.get_occ(c, beg_row);
+        const auto e = index.cnt[c] + index.get_occ(c, end_row);
+        if (b >= e)
+          break;
+        beg_row = b;
+        end_row = e;
+      }
+      const auto size = end - begin;
+      if (size >= std::size_t(MIN_SEED_LEN) && end_row - beg_row <= MAX_OCC)
+        for (const auto offset : index.get_offsets(beg_row, end_row))
+          hits.push_back({reverse, std::int64_t(offset) - std::int64_t(begin),
+                          std::uint32_t(begin), std::uint32_t(size)});
+      if (begin == 0)
+        break;
+      end = begin - 1;
+    }
+  }
+
+  /*
+   * Score of the ungapped alignment of seq[read_pos, read_pos + size) at
+   * ref_pos.
+   */
+  auto
+  ungapped_score(istring_view seq, std::uint32_t read_pos,
+                 std::uint32_t ref_pos, std::uint32_t size) const {
+    auto score = 0;
+    for (auto k = 0u; k < size; k++) {
+      const auto c = seq[read_pos + k];
+      score += c == ref.seq[ref_pos + k] && c < 4 ? SW.MATCH : -SW.MISMATCH;
+    }
+    return score;
+  }
+
+  auto
+  unclip(istring_view seq, Candidate& candidate) const {
+    auto& cigar = candidate.aln.cigar;
+    if (cigar.size() <= 1)
+      return;
+    if (const auto [size, op] = Cigar::Element(cigar.front());
+        op == 'S' && candidate.pos >= size) {
+      const auto score
+        = ungapped_score(seq, 0, candidate.pos - size, size);
+      if (score + CLIP_PENALTY > 0) {
+        cigar.front() = {size, 'M'};
+        candidate.pos -= size;
+        candidate.aln.score += score;
+      }
+    }
+    if (const auto [size, op] = Cigar::Element(cigar.back()); op == 'S') {
+      const auto ref_end = candidate.pos + cigar.ref_size();
+      if (ref_end + size <= ref.seq.size()) {
+        const auto score
+          = ungapped_score(seq, seq.size() - size, ref_end, size);
+        if (score + CLIP_PENALTY > 0) {
+          cigar.back() = {size, 'M'};
+          candidate.aln.score += score;
+        }
+      }
+    }
+    cigar.compact();
+  }
+
+  /*
+   * Extend the seq of a strand against ref[begin, end).
+   */
+  auto
+  extend(istring_view seq, bool reverse, std::int64_t begin,
+         std::int64_t end) const {
+    begin = std::max<std::int64_t>(begin, 0);
+    end = std::min<std::int64_t>(end, ref.seq.size());
+    auto candidate = Candidate{reverse};
+    if (begin >= end)
+      return candidate;
+    candidate.aln
+      = SW.align(istring_view{ref.seq}.substr(begin, end - begin), seq);
+    candidate.pos = begin + candidate.aln.ref_begin;
+    unclip(seq, candidate);
+    return candidate;
+  }
+
+  /*
+   * Candidates of both strands, sorted by descending score.
+   */
+  auto
+  candidates(istring_view fwd, istring_view rev) const {
+    auto hits = std::vector<Hit>{};
+    seed(fwd, false, hits);
+    seed(rev, true, hits);
+    std::ranges::sort(hits, [](const auto& a, const auto& b) {
+      return std::tie(a.reverse, a.diag, a.read_begin)
+             < std::tie(b.reverse, b.diag, b.read_begin);
+    });
+
+    struct Chain {
+      bool reverse;
+      std::int64_t diag_begin, diag_end;
+      std::uint32_t weight;
+    };
+    auto chains = std::vector<Chain>{};
+    for (const auto& hit : hits) {
+      if (chains.empty() || chains.back().reverse != hit.reverse
+          || hit.diag - chains.back().diag_end > PAD)
+        chains.push_back({hit.reverse, hit.diag, hit.diag, 0});
+      chains.back().diag_end = hit.diag;
+      chains.back().weight += hit.size;
+    }
+    std::ranges::stable_sort(chains, std::ranges::greater{}, &Chain::weight);
+    if (chains.size() > std::size_t(MAX_CHAINS))
+      chains.resize(MAX_CHAINS);
+
+    auto res = std::vector<Candidate>{};
+    for (const auto& chain : chains) {
+      if (chain.weight * 2 < chains.front().weight)
+        break;
+      const auto seq = chain.reverse ? rev : fwd;
+      auto candidate
+        = extend(seq, chain.reverse, chain.diag_begin - PAD,
+                 chain.diag_end + std::int64_t(seq.size()) + PAD);
+      if (std::ranges::none_of(res, [&](const auto& c) {
+            return c.reverse == candidate.reverse && c.pos == candidate.pos;
+          }))
+        res.push_back(std::move(candidate));
+    }
+    std::ranges::stable_sort(res, std::ranges::greater{},
+                             [](const auto& c) { return c.aln.score; });
+    return res;
+  }
+
+  auto
+  mapq(int best, int sub) const {
+    return std::clamp(6 * (best - sub) / SW.MATCH, 0, 60);
+  }
+
+  /*
+   * MAPQ of the chosen candidate against the best of the others.
+   */
+  auto
+  mapq(const std::vector<Candidate>& candidates,
+       const Candidate* chosen) const {
+    if (chosen == nullptr)
+      return 0;
+    auto sub = MIN_SCORE - 1;
+    for (const auto& candidate : candidates)
+      if (&candidate != chosen)
+        sub = std::max(sub, candidate.aln.score);
+    return mapq(chosen->aln.score, sub);
+  }
+
+  static auto
+  insert_size(const Candidate& a, const Candidate& b) {
+    const auto begin = std::min(a.pos, b.pos);
+    const auto end = std::max(a.pos + a.aln.cigar.ref_size(),
+                              b.pos + b.aln.cigar.ref_size());
+    return std::int64_t(end) - begin;
+  }
+
+  auto
+  is_proper(const Candidate& a, const Candidate& b) const {
+    if (a.reverse == b.reverse || a.aln.score < MIN_SCORE
+        || b.aln.score < MIN_SCORE)
+      return false;
+    const auto& fwd = a.reverse ? b : a;
+    const auto& rev = a.reverse ? a : b;
+    return fwd.pos <= rev.pos + rev.aln.cigar.ref_size()
+           && insert_size(a, b) <= MAX_INSERT;
+  }
+
+  /*
+   * Align the mate in the insert window downstream of a forward read, or
+   * upstream of a reverse read.
+   */
+  auto
+  rescue(const Candidate& anchor, istring_view fwd, istring_view rev) const {
+    const auto begin = std::int64_t(anchor.pos);
+    const auto end = begin + anchor.aln.cigar.ref_size();
+    return anchor.reverse ? extend(fwd, false, end - MAX_INSERT, end)
+                          : extend(rev, true, begin, begin + MAX_INSERT);
+  }
+
+  auto
+  to_record(const FastqRecord<true>& read, const Candidate* candidate,
+            int mapq) const {
+    auto record = SamRecord<true>{};
+    record.qname = read.name;
+    if (candidate == nullptr || candidate->aln.score < MIN_SCORE) {
+      record.flag = SamUtil::READ_UNMAPPED;
+      record.rname = "*";
+      record.rnext = "*";
+      record.seq = read.seq;
+      record.qual = read.qual;
+      return record;
+    }
+    record.rname = ref.name;
+    record.pos = candidate->pos + 1;
+    record.mapq = mapq;
+    record.cigar = candidate->aln.cigar;
+    record.rnext = "*";
+    if (candidate->reverse) {
+      record.flag = SamUtil::READ_REVERSE_STRAND;
+      record.seq = Codec::rev_comp(read.seq);
+      record.qual = {read.qual.rbegin(), read.qual.rend()};
+    } else {
+      record.seq = read.seq;
+      record.qual = read.qual;
+    }
+    return record;
+  }
+
+  auto
+  align_read(const FastqRecord<true>& read) const {
+    const auto rev = Codec::rev_comp(read.seq);
+    const auto cands = candidates(read.seq, rev);
+    const auto* best = cands.empty() ? nullptr : &cands[0];
+    return to_record(read, best, mapq(cands, best));
+  }
+
+  auto
+  align_pair(const FastqRecord<true>& read1, const FastqRecord<true>& read2,
+             SamRecord<true>& record1, SamRecord<true>& record2) const {
+    const auto rev1 = Codec::rev_comp(read1.seq);
+    const auto rev2 = Codec::rev_comp(read2.seq);
+    auto cands1 = candidates(read1.seq, rev1);
+    auto cands2 = candidates(read2.seq, rev2);
+
+    const Candidate* best1 = cands1.empty() ? nullptr : &cands1[0];
+    const Candidate* best2 = cands2.empty() ? nullptr : &cands2[0];
+    auto proper = false;
+    auto best_score = std::numeric_limits<int>::min();
+    auto second_score = 2 * MIN_SCORE - 1;
+    for (const auto& a : cands1)
+      for (const auto& b : cands2) {
+        if (!is_proper(a, b))
+          continue;
+        if (const auto score = a.aln.score + b.aln.score; score > best_score) {
+          second_score = std::max(second_score, best_score);
+          best_score = score;
+          best1 = &a;
+          best2 = &b;
+          proper = true;
+        } else
+          second_score = std::max(second_score, score);
+      }
+
+    // As in BWA, a unique pair raises the MAPQ of an end which is ambiguous
+    // alone, by at most 40.
+    auto mapq1 = mapq(cands1, best1);
+    auto mapq2 = mapq(cands2, best2);
+    if (proper) {
+      const auto pair = mapq(best_score, second_score);
+      mapq1 = std::max(mapq1, std::min(pair, mapq1 + 40));
+      mapq2 = std::max(mapq2, std::min(pair, mapq2 + 40));
+    }
+
+    auto rescued = Candidate{};
+    if (!proper && best1 != nullptr && best1->aln.score >= MIN_SCORE) {
+      if (rescued = rescue(*best1, read2.seq, rev2); is_proper(*best1, rescued))
+        best2 = &rescued, mapq2 = mapq1, proper = true;
+    }
+    if (!proper && best2 != nullptr && best2->aln.score >= MIN_SCORE) {
+      if (rescued = rescue(*best2, read1.seq, rev1); is_proper(rescued, *best2))
+        best1 = &rescued, mapq1 = mapq2, proper = true;
+    }
+
+    record1 = to_record(read1, best1, mapq1);
+    record2 = to_record(read2, best2, mapq2);
+    auto set_mate = [](SamRecord<true>& record, const SamRecord<true>& mate,
+                       SamUtil::Flag order) {
+      record.flag |= SamUtil::READ_PAIRED | order;
+      if (mate.read_unmapped())
+        record.flag |= SamUtil::MATE_UNMAPPED;
+      if (mate.read_reverse_strand())
+        record.flag |= SamUtil::MATE_REVERSE_STRAND;
+      // An unmapped mate placed at this read is at the same position.
+      if (mate.rname != "*") {
+        record.rnext = "=";
+        record.pnext = mate.pos;
+      }
+    };
+    // An unmapped end is placed at its mate.
+    if (record1.read_unmapped() && !record2.read_unmapped())
+      record1.rname = record2.rname, record1.pos = record2.pos;
+    if (record2.read_unmapped() && !record1.read_unmapped())
+      record2.rname = record1.rname, record2.pos = record1.pos;
+    set_mate(record1, record2, SamUtil::FIRST_OF_PAIR);
+    set_mate(record2, record1, SamUtil::SECOND_OF_PAIR);
+    if (!record1.read_unmapped() && !record2.read_unmapped()) {
+      if (proper) {
+        record1.flag |= SamUtil::PROPER_PAIR;
+        record2.flag |= SamUtil::PROPER_PAIR;
+      }
+      record1.tlen = SamUtil::compute_tlen(
+        record1.pos, record1.cigar, !record1.read_reverse_strand(),
+        record2.pos, record2.cigar, !record2.read_reverse_strand());
+      record2.tlen = -record1.tlen;
+    }
+  }
+
+ public:
+  /**
+   * @brief Align single-end reads.
+   *
+   * @return One primary record per read, in the order of reads.
+   */
+  auto
+  align(std::span<const FastqRecord<true>> reads) const {
+    auto records = std::vector<SamRecord<true>>(reads.size());
+    tbb::parallel_for(
+      tbb::blocked_range<std::size_t>(0, reads.size(), BATCH_SIZE),
+      [&](const auto& batch) {
+        for (auto i = batch.begin(); i != batch.end(); i++)
+          records[i] = align_read(reads[i]);
+      });
+    return records;
+  }
+
+  /**
+   * @brief Align paired-end reads in forward-reverse orientation.
+   *
+   * @return Records of reads1[i] and reads2[i] at 2i and 2i + 1.
+   */
+  auto
+  align(std::span<const FastqRecord<true>> reads1,
+        std::span<const FastqRecord<true>> reads2) const {
+    if (reads1.size() != reads2.size())
+      throw std::invalid_argument("Aligner: unequal number of mates");
+    auto records = std::vector<SamRecord<true>>(reads1.size() * 2);
+    tbb::parallel_for(
+      tbb::blocked_range<std::size_t>(0, reads1.size(), BATCH_SIZE),
+      [&](const auto& batch) {
+        for (auto i = batch.begin(); i != batch.end(); i++)
+          align_pair(reads1[i], reads2[i], records[i * 2], records[i * 2 + 1]);
+      });
+    return records;
+  }
+};
+
+}  // namespace biovoltron
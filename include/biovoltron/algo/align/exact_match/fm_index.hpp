@@ -0,0 +1,449 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/archive/serializer.hpp>
+#include <biovoltron/utility/istring.hpp>
+#include <bit>
+#include <limits>
+#include <ranges>
+#include <tuple>
+#include <utility>
+#include <tbb/parallel_for.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief FM-index over the 2-bit encoded reference for exact matching.
+ *
+ * The BWT is stored in cache-line sized blocks which interleave the
+ * occurrence counts at the start of the block with 192 2-bit bases, so a rank
+ * query touches a single cache line. The suffix array is sampled every
+ * SA_INTERVAL rows and the SA intervals of every LOOKUP_LEN-mer are kept in a
+ * lookup table to skip the first steps of backward search.
+ *
+ * The suffix array is built by SA-IS in linear time. Besides the reference
+ * and the index, building holds the full suffix array (4 bytes per base), a
+ * type bit per base and the buckets of the reduced problem (at most 2 bytes
+ * per base), whose string and suffix array reuse the full suffix array.
+ *
+ * Ambiguous bases (code 4) in the reference are indexed as `A`, as in
+ * Codec::hash.
+ *
+ * Example
+ * ```cpp
+ * #include <iostream>
+ * #include <biovoltron/algo/align/exact_match/fm_index.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto index = FMIndex{.SA_INTERVAL = 4, .LOOKUP_LEN = 2};
+ *   index.build(0123012301_s);
+ *   const auto [beg, end, offset] = index.get_range(2301_s);
+ *   for (const auto offset : index.get_offsets(beg, end))
+ *     std::cout << offset << "\n";
+ *   // Output (in any order):
+ *   // 2
+ *   // 6
+ *
+ *   {
+ *     auto fout = std::ofstream{"ref.fmi", std::ios::binary};
+ *     index.save(fout);
+ *   }
+ *   auto mapped = FMIndex{};
+ *   mapped.load("ref.fmi");
+ * }
+ * ```
+ */
+struct FMIndex {
+  /**
+   * @brief Row interval between two sampled suffix array entries.
+   */
+  int SA_INTERVAL = 16;
+
+  /**
+   * @brief Length of the k-mers whose SA intervals are precomputed.
+   */
+  int LOOKUP_LEN = 10;
+
+  /**
+   * @brief Number of bases in one occurrence block.
+   */
+  constexpr static auto BLOCK_SIZE = 192u;
+
+  /**
+   * @brief Occurrence counts of each base before the block, followed by the
+   * BWT bases of the block.
+   */
+  struct alignas(64) OccBlock {
+    std::array<std::uint32_t, 4> occ;
+    std::array<std::uint64_t, BLOCK_SIZE / 32> bwt;
+  };
+
+  /**
+   * @brief Size of the BWT, i.e. size of the reference plus one for the
+   * sentinel.
+   */
+  std::uint32_t bwt_size{};
+
+  /**
+   * @brief Row of the BWT holding the sentinel.
+   */
+  std::uint32_t primary{};
+
+  /**
+   * @brief First row of suffixes starting with each base, cnt[4] ==
+   * bwt_size.
+   */
+  std::array<std::uint32_t, 5> cnt{};
+
+  MappedVector<OccBlock> occ;
+  MappedVector<std::uint32_t> sa;
+  MappedVector<std::uint32_t> lookup;
+
+ private:
+  constexpr static auto MAGIC = std::uint64_t{0x3130494d46564942};  // BVFMI01
+
+  /*
+   * Reference with the sentinel appended, over the alphabet 0 to 4 where 0
+   * is the sentinel.
+   */
+  struct Text {
+    istring_view ref;
+
+    auto
+    operator[](std::size_t i) const noexcept {
+      return i < ref.size() ? std::uint32_t(ref[i] & 3) + 1 : 0u;
+    }
+  };
+
+  constexpr static auto EMPTY = std::numeric_limits<std::uint32_t>::max();
+
+  template<class S>
+  static auto
+  buckets(const S& s, std::uint32_t n, std::uint32_t k, bool end) {
+    auto bkt = std::vector<std::uint32_t>(k + 1);
+    for (auto i = 0u; i < n; i++) bkt[s[i]]++;
+    for (auto c = 0u, sum = 0u; c <= k; c++) {
+      sum += bkt[c];
+      bkt[c] = end ? sum : sum - bkt[c];
+    }
+    return bkt;
+  }
+
+  /*
+   * Induce L-type suffixes from the sorted LMS suffixes, then S-type ones
+   * from the L-type ones.
+   */
+  template<class S>
+  static auto
+  induce(const S& s, const std::vector<bool>& stype, std::uint32_t* sa,
+         std::uint32_t n, std::uint32_t k) {
+    auto bkt = buckets(s, n, k, false);
+    for (auto i = 0u; i < n; i++)
+      if (sa[i] != EMPTY && sa[i] > 0 && !stype[sa[i] - 1])
+        sa[bkt[s[sa[i] - 1]]++] = sa[i] - 1;
+    bkt = buckets(s, n, k, true);
+    for (auto i = n; i-- > 0;)
+      if (sa[i] != EMPTY && sa[i] > 0 && stype[sa[i] - 1])
+        sa[--bkt[s[sa[i] - 1]]] = sa[i] - 1;
+  }
+
+  /*
+   * SA-IS of s, whose last character is a unique smallest sentinel, over the
+   * alphabet [0, k]. The reduced problem is kept in sa itself, so besides sa
+   * only a bit per character and the buckets are allocated.
+   */
+  template<class S>
+  static auto
+  sais(const S& s, std::uint32_t* sa, std::uint32_t n, std::uint32_t k)
+    -> void {
+    if (n == 1) {
+      sa[0] = 0;
+      return;
+    }
+    auto stype = std::vector<bool>(n);
+    stype[n - 1] = true;
+    for (auto i = n - 1; i-- > 0;)
+      stype[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && stype[i + 1]);
+    const auto lms = [&stype](std::uint32_t i) {
+      return i > 0 && i != EMPTY && stype[i] && !stype[i - 1];
+    };
+
+    // Sort the LMS substrings.
+    std::fill(sa, sa + n, EMPTY);
+    auto bkt = buckets(s, n, k, true);
+    for (auto i = 1u; i < n; i++)
+      if (lms(i))
+        sa[--bkt[s[i]]] = i;
+    induce(s, stype, sa, n, k);
+
+    // Name them, names of the substring at i stored at n1 + i / 2.
+    auto n1 = 0u;
+    for (auto i = 0u; i < n; i++)
+      if (lms(sa[i]))
+        sa[n1++] = sa[i];
+    std::fill(sa + n1, sa + n, EMPTY);
+    auto names = 0u;
+    for (auto i = 0u, prev = EMPTY; i < n1; i++) {
+      const auto pos = sa[i];
+      auto diff = prev == EMPTY;
+      for (auto d = 0u; !diff; d++) {
+        if (s[pos + d] != s[prev + d] || stype[pos + d] != stype[prev + d])
+          diff = true;
+        else if (d > 0 && (lms(pos + d) || lms(prev + d)))
+          break;
+      }
+      if (diff) {
+        names++;
+        prev = pos;
+      }
+      sa[n1 + pos / 2] = names - 1;
+    }
+    for (auto i = n, j = n; i-- > n1;)
+      if (sa[i] != EMPTY)
+        sa[--j] = sa[i];
+
+    // Sort the LMS suffixes by the suffix array of their names.
+    auto* s1 = sa + n - n1;
+    if (names < n1)
+      sais(s1, sa, n1, names - 1);
+    else
+      for (auto i = 0u; i < n1; i++) sa[s1[i]] = i;
+
+    for (auto i = 1u, j = 0u; i < n; i++)
+      if (lms(i))
+        s1[j++] = i;
+    for (auto i = 0u; i < n1; i++) sa[i] = s1[sa[i]];
+    std::fill(sa + n1, sa + n, EMPTY);
+    bkt = buckets(s, n, k, true);
+    for (auto i = n1; i-- > 0;) {
+      const auto j = std::exchange(sa[i], EMPTY);
+      sa[--bkt[s[j]]] = j;
+    }
+    induce(s, stype, sa, n, k);
+  }
+
+  static auto
+  build_sa(istring_view ref) {
+    const auto n = std::uint32_t(ref.size()) + 1;
+    auto sa = std::vector<std::uint32_t>(n);
+    sais(Text{ref}, sa.data(), n, 4);
+    return sa;
+  }
+
+  static auto
+  count(std::uint64_t word, ichar c, unsigned len) noexcept {
+    constexpr auto LOW = std::uint64_t{0x5555555555555555};
+    const auto x = word ^ (LOW * c);
+    auto match = ~(x | x >> 1) & LOW;
+    if (len < 32)
+      match &= (std::uint64_t{1} << 2 * len) - 1;
+    return std::popcount(match);
+  }
+
+  auto
+  bwt_at(std::uint32_t i) const noexcept {
+    const auto& block = occ[i / BLOCK_SIZE];
+    const auto j = i % BLOCK_SIZE;
+    return ichar(block.bwt[j / 32] >> 2 * (j % 32) & 3);
+  }
+
+ public:
+  /**
+   * @brief Count the occurrences of base c in the BWT rows [0, i).
+   */
+  auto
+  get_occ(ichar c, std::uint32_t i) const noexcept {
+    const auto& block = occ[i / BLOCK_SIZE];
+    const auto j = i % BLOCK_SIZE;
+    auto res = block.occ[c];
+    for (auto w = 0u; w * 32 < j; w++)
+      res += count(block.bwt[w], c, std::min(32u, j - w * 32));
+    // The sentinel row is stored as A.
+    if (c == 0 && primary < i && primary >= i - j)
+      res--;
+    return res;
+  }
+
+  /**
+   * @brief LF mapping, the row of the suffix one base to the left.
+   */
+  auto
+  lf(std::uint32_t i) const noexcept {
+    const auto c = bwt_at(i);
+    return cnt[c] + get_occ(c, i);
+  }
+
+  /**
+   * @brief Backward search.
+   *
+   * @param seed Query in integer encoding.
+   * @param stop_upper Stop extending once at most this many rows are left.
+   * @return Tuple of the range [beg, end) of BWT rows whose suffixes start
+   * with seed[offset:], and offset. The range is empty if seed does not occur
+   * or contains ambiguous bases.
+   */
+  auto
+  get_range(istring_view seed, std::uint32_t stop_upper = 0) const noexcept {
+    auto beg = std::uint32_t{};
+    auto end = bwt_size;
+    auto offset = std::uint32_t(seed.size());
+    if (std::ranges::any_of(seed, [](auto c) { return c > 3; }))
+      return std::tuple{beg, beg, offset};
+    if (!lookup.empty() && seed.size() >= LOOKUP_LEN) {
+      offset -= LOOKUP_LEN;
+      const auto key = Codec::hash(seed.substr(offset));
+      beg = lookup[key * 2];
+      end = lookup[key * 2 + 1];
+    }
+    while (offset > 0 && end - beg > stop_upper) {
+      const auto c = seed[--offset];
+      beg = cnt[c] + get_occ(c, beg);
+      end = cnt[c] + get_occ(c, end);
+      if (beg >= end)
+        return std::tuple{beg, beg, offset};
+    }
+    return std::tuple{beg, end, offset};
+  }
+
+  /**
+   * @brief Locate the reference offsets of the suffixes in BWT rows
+   * [beg, end).
+   */
+  auto
+  get_offsets(std::uint32_t beg, std::uint32_t end) const {
+    auto offsets = std::vector<std::uint32_t>{};
+    offsets.reserve(end - beg);
+    for (auto i = beg; i < end; i++) {
+      auto row = i;
+      auto steps = std::uint32_t{};
+      while (row % SA_INTERVAL != 0 && row != primary) {
+        row = lf(row);
+        steps++;
+      }
+      offsets.push_back((row == primary ? 0 : sa[row / SA_INTERVAL]) + steps);
+    }
+    return offsets;
+  }
+
+  /**
+   * @brief Build the index of a reference.
+   *
+   * @param ref Reference in integer encoding, shorter than 2^32 - 1.
+   */
+  auto
+  build(istring_view ref) {
+    bwt_size = ref.size() + 1;
+    auto sa_full = build_sa(ref);
+
+    const auto blocks = bwt_size / BLOCK_SIZE + 1;
+    auto occ_blocks = std::vector<OccBlock>(blocks);
+    tbb::parallel_for(std::uint32_t{}, blocks, [&](auto b) {
+      auto& block = occ_blocks[b];
+      block = {};
+      for (auto j = 0u; j < BLOCK_SIZE; j++) {
+        const auto i = b * BLOCK_SIZE + j;
+        if (i >= bwt_size || sa_full[i] == 0)
+          continue;
+        const auto c = ref[sa_full[i] - 1] & 3;
+        block.bwt[j / 32] |= std::uint64_t(c) << 2 * (j % 32);
+        block.occ[c]++;
+      }
+    });
+    primary = std::ranges::find(sa_full, 0u) - sa_full.begin();
+    auto total = std::array<std::uint32_t, 4>{};
+    for (auto& block : occ_blocks)
+      for (auto c = 0; c < 4; c++)
+        total[c] += std::exchange(block.occ[c], total[c]);
+    cnt[0] = 1;
+    for (auto c = 0; c < 4; c++) cnt[c + 1] = cnt[c] + total[c];
+    occ = std::move(occ_blocks);
+
+    auto sa_sampled = std::vector<std::uint32_t>{};
+    for (auto i = 0u; i < bwt_size; i += SA_INTERVAL)
+      sa_sampled.push_back(sa_full[i]);
+    sa = std::move(sa_sampled);
+
+    lookup = {};
+    auto table = std::vector<std::uint32_t>(std::size_t{2} << 2 * LOOKUP_LEN);
+    tbb::parallel_for(std::size_t{}, table.size() / 2, [&](auto key) {
+      const auto [beg, end, offset] = get_range(Codec::rhash(key, LOOKUP_LEN));
+      table[key * 2] = beg;
+      table[key * 2 + 1] = end;
+    });
+    lookup = std::move(table);
+  }
+
+  /**
+   * @brief Build the index of a reference record.
+   */
+  auto
+  build(const FastaRecord<true>& ref) {
+    build(ref.seq);
+  }
+
+  /**
+   * @brief Write the index in a layout which load() maps without copying.
+   */
+  auto
+  save(std::ostream& os) const {
+    auto writer = Serializer::Writer{os};
+    writer.save(MAGIC);
+    writer.save(SA_INTERVAL);
+    writer.save(LOOKUP_LEN);
+    writer.save(bwt_size);
+    writer.save(primary);
+    writer.save(cnt);
+    writer.save(occ);
+    writer.save(sa);
+    writer.save(lookup);
+  }
+
+  /**
+   * @brief Read an index written by save() into memory.
+   */
+  auto
+  load(std::istream& is) {
+    auto loader = Serializer::Loader{is};
+    auto magic = std::uint64_t{};
+    loader.load(magic);
+    if (magic != MAGIC)
+      throw std::runtime_error("FMIndex: not an FM-index");
+    loader.load(SA_INTERVAL);
+    loader.load(LOOKUP_LEN);
+    loader.load(bwt_size);
+    loader.load(primary);
+    loader.load(cnt);
+    auto occ_blocks = std::vector<OccBlock>{};
+    auto sa_sampled = std::vector<std::uint32_t>{};
+    auto table = std::vector<std::uint32_t>{};
+    loader.load(occ_blocks);
+    loader.load(sa_sampled);
+    loader.load(table);
+    occ = std::move(occ_blocks);
+    sa = std::move(sa_sampled);
+    lookup = std::move(table);
+  }
+
+  /**
+   * @brief Memory map an index written by save(), nothing is copied.
+   */
+  auto
+  load(const std::filesystem::path& path) {
+    auto reader = Serializer::Reader{path};
+    if (reader.value<std::uint64_t>() != MAGIC)
+      throw std::runtime_error("FMIndex: " + path.string()
+                               + " is not an FM-index");
+    SA_INTERVAL = reader.value<int>();
+    LOOKUP_LEN = reader.value<int>();
+    bwt_size = reader.value<std::uint32_t>();
+    primary = reader.value<std::uint32_t>();
+    std::ranges::copy(reader.array<std::uint32_t>(), cnt.begin());
+    occ = reader.array<OccBlock>();
+    sa = reader.array<std::uint32_t>();
+    lookup = reader.array<std::uint32_t>();
+  }
+};
+
+}  // namespace biovoltron
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/archive/serializer.hpp>
+#include <biovoltron/utility/istring.hpp>
+#include <array>
+#include <span>
+#include <tbb/parallel_for.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Index of the positions of every k-mer of a reference, keyed by
+ * Codec::hash.
+ *
+ * The (key, position) pairs of the reference are radix sorted in parallel.
+ * The first BUCKET_LEN bases of a key address a bucket of the sorted keys
+ * directly, so a query is one table lookup followed by a binary search in a
+ * small bucket. Windows containing ambiguous bases are not indexed.
+ *
+ * Compared to FMIndex, only fixed-length seeds can be queried, but the index
+ * is built several times faster, which suits small targeted references.
+ *
+ * Example
+ * ```cpp
+ * #include <iostream>
+ * #include <biovoltron/algo/align/exact_match/kmer_index.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto index = KmerIndex{.K = 4, .BUCKET_LEN = 2};
+ *   index.build(0123012301_s);
+ *   for (const auto offset : index.get_offsets(2301_s))
+ *     std::cout << offset << "\n";
+ *   // Output:
+ *   // 2
+ *   // 6
+ * }
+ * ```
+ */
+struct KmerIndex {
+  /**
+   * @brief Length of the indexed k-mers, at most 32.
+   */
+  int K = 15;
+
+  /**
+   * @brief Number of leading bases of a k-mer addressed by the bucket table,
+   * which has 4^BUCKET_LEN + 1 entries.
+   */
+  int BUCKET_LEN = 10;
+
+  /**
+   * @brief Keys of all indexed k-mers, sorted.
+   */
+  MappedVector<std::uint64_t> keys;
+
+  /**
+   * @brief Reference offsets of the k-mers in keys, ascending within a key.
+   */
+  MappedVector<std::uint32_t> offsets;
+
+  /**
+   * @brief Start of each bucket in keys.
+   */
+  MappedVector<std::uint32_t> buckets;
+
+ private:
+  constexpr static auto MAGIC = std::uint64_t{0x3130584d4b564942};  // BVKMX01
+
+  struct Entry {
+    std::uint64_t key;
+    std::uint32_t offset;
+  };
+
+  /*
+   * Parallel LSD radix sort on the lowest bits of the keys. Every pass counts
+   * the digits of each chunk, then scatters the chunks to their own slots,
+   * which keeps the sort stable.
+   */
+  static auto
+  radix_sort(std::vector<Entry>& entries, unsigned bits) {
+    constexpr auto DIGIT_BITS = 8u;
+    constexpr auto RADIX = 1u << DIGIT_BITS;
+    constexpr auto CHUNK_SIZE = std::size_t{1} << 16;
+    const auto chunks = entries.size() / CHUNK_SIZE + 1;
+    auto buffer = std::vector<Entry>(entries.size());
+    auto counts = std::vector<std::array<std::size_t, RADIX>>(chunks);
+    auto chunk_range = [&](auto c) {
+      return std::pair{c * CHUNK_SIZE,
+                       std::min(entries.size(), (c + 1) * CHUNK_SIZE)};
+    };
+
+    for (auto shift = 0u; shift < bits; shift += DIGIT_BITS) {
+      tbb::parallel_for(std::size_t{}, chunks, [&](auto c) {
+        auto& count = counts[c];
+        count.fill(0);
+        const auto [begin, end] = chunk_range(c);
+        for (auto i = begin; i < end; i++)
+          count[entries[i].key >> shift & (RADIX - 1)]++;
+      });
+      auto sum = std::size_t{};
+      for (auto d = 0u; d < RADIX; d++)
+        for (auto& count : counts) sum += std::exchange(count[d], sum);
+      tbb::parallel_for(std::size_t{}, chunks, [&](auto c) {
+        auto& count = counts[c];
+        const auto [begin, end] = chunk_range(c);
+        for (auto i = begin; i < end; i++)
+          buffer[count[entries[i].key >> shift & (RADIX - 1)]++] = entries[i];
+      });
+      entries.swap(buffer);
+    }
+  }
+
+  auto
+  bucket_of(std::uint64_t key) const noexcept {
+    return key >> 2 * (K - std::min(K, BUCKET_LEN));
+  }
+
+ public:
+  /**
+   * @brief Locate the reference offsets of a k-mer key.
+   *
+   * @return A view into the index, in ascending order. Empty if the index is
+   * not built or key is not a key of K bases.
+   */
+  auto
+  get_offsets(std::uint64_t key) const noexcept {
+    const auto bucket = bucket_of(key);
+    if (bucket + 1 >= buckets.size())
+      return std::span<const std::uint32_t>{};
+    const auto begin = keys.begin() + buckets[bucket];
+    const auto end = keys.begin() + buckets[bucket + 1];
+    const auto [lo, hi] = std::equal_range(begin, end, key);
+    return std::span<const std::uint32_t>{offsets.begin() + (lo - keys.begin()),
+                                          offsets.begin() + (hi - keys.begin())};
+  }
+
+  /**
+   * @brief Locate the reference offsets of a k-mer.
+   *
+   * @param kmer K bases in integer encoding.
+   * @return A view into the index, in ascending order. Empty if kmer is not K
+   * bases long or contains ambiguous bases.
+   */
+  auto
+  get_offsets(istring_view kmer) const noexcept {
+    if (kmer.size() != std::size_t(K)
+        || std::ranges::any_of(kmer, [](auto c) { return c > 3; }))
+      return std::span<const std::uint32_t>{};
+    return get_offsets(Codec::hash(kmer));
+  }
+
+  /**
+   * @brief Build the index of a reference.
+   *
+   * @param ref Reference in integer encoding, shorter than 2^32.
+   */
+  auto
+  build(istring_view ref) {
+    if (K < 1 || K > 32)
+      throw std::invalid_argument("KmerIndex: K must be in [1, 32]");
+    const auto mask = K == 32 ? ~0ull : (1ull << 2 * K) - 1;
+    auto entries = std::vector<Entry>{};
+    entries.reserve(ref.size());
+    auto key = 0ull;
+    auto valid = 0;
+    for (auto i = 0u; i < ref.size(); i++) {
+      key = (key << 2 | (ref[i] & 3)) & mask;
+      valid = ref[i] > 3 ? 0 : valid + 1;
+      if (valid >= K)
+        entries.push_back({key, i + 1 - K});
+    }
+    radix_sort(entries, 2 * K);
+
+    auto sorted_keys = std::vector<std::uint64_t>(entries.size());
+    auto sorted_offsets = std::vector<std::uint32_t>(entries.size());
+    tbb::parallel_for(std::size_t{}, entries.size(), [&](auto i) {
+      sorted_keys[i] = entries[i].key;
+      sorted_offsets[i] = entries[i].offset;
+    });
+    auto table = std::vector<std::uint32_t>(
+      (std::size_t{1} << 2 * std::min(K, BUCKET_LEN)) + 1);
+    for (const auto key : sorted_keys) table[bucket_of(key) + 1]++;
+    for (auto b = 1u; b < table.size(); b++) table[b] += table[b - 1];
+
+    keys = std::move(sorted_keys);
+    offsets = std::move(sorted_offsets);
+    buckets = std::move(table);
+  }
+
+  /**
+   * @brief Build the index of a reference record.
+   */
+  auto
+  build(const FastaRecord<true>& ref) {
+    build(ref.seq);
+  }
+
+  /**
+   * @brief Write the index in a layout which load() maps without copying.
+   */
+  auto
+  save(std::ostream& os) const {
+    auto writer = Serializer::Writer{os};
+    writer.save(MAGIC);
+    writer.save(K);
+    writer.save(BUCKET_LEN);
+    writer.save(keys);
+    writer.save(offsets);
+    writer.save(buckets);
+  }
+
+  /**
+   * @brief Read an index written by save() into memory.
+   */
+  auto
+  load(std::istream& is) {
+    auto loader = Serializer::Loader{is};
+    auto magic = std::uint64_t{};
+    loader.load(magic);
+    if (magic != MAGIC)
+      throw std::runtime_error("KmerIndex: not a k-mer index");
+    loader.load(K);
+    loader.load(BUCKET_LEN);
+    auto sorted_keys = std::vector<std::uint64_t>{};
+    auto sorted_offsets = std::vector<std::uint32_t>{};
+    auto table = std::vector<std::uint32_t>{};
+    loader.load(sorted_keys);
+    loader.load(sorted_offsets);
+    loader.load(table);
+    keys = std::move(sorted_keys);
+    offsets = std::move(sorted_offsets);
+    buckets = std::move(table);
+  }
+
+  /**
+   * @brief Memory map an index written by save(), nothing is copied.
+   */
+  auto
+  load(const std::filesystem::path& path) {
+    auto reader = Serializer::Reader{path};
+    if (reader.value<std::uint64_t>() != MAGIC)
+      throw std::runtime_error("KmerIndex: " + path.string()
+                               + " is not a k-mer index");
+    K = reader.value<int>();
+    BUCKET_LEN = reader.value<int>();
+    keys = reader.array<std::uint64_t>();
+    offsets = reader.array<std::uint32_t>();
+    buckets = reader.array<std::uint32_t>();
+  }
+};
+
+}  // namespace biovoltron
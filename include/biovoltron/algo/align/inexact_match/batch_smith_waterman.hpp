@@ -0,0 +1,382 @@
+#pragma once
+
+#include <biovoltron/algo/align/inexact_match/smith_waterman.hpp>
+#include <biovoltron/file_io/sam.hpp>
+#include <numeric>
+#include <span>
+#include <tbb/parallel_for.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Inter-sequence Smith-Waterman aligner for many short reads against
+ * one shared target, e.g. the candidate haplotypes of a realignment region.
+ *
+ * Reads are sorted by length and packed 16 per AVX2 register (one read per
+ * 16-bit lane), so each target base is compared against 16 reads at once.
+ * Traceback directions are kept per lane, thus cigars come out of the same
+ * pass. Groups of 16 reads are aligned in parallel. Lanes whose score would
+ * saturate, and reads or targets too long for 16-bit lanes or for the
+ * memory of the traceback, are aligned with SmithWaterman.
+ *
+ * Scoring is identical to SmithWaterman.
+ *
+ * Example
+ * ```cpp
+ * #include <iostream>
+ * #include <biovoltron/algo/align/inexact_match/batch_smith_waterman.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   const auto aligner = BatchSmithWaterman{.SEMI_GLOBAL = true};
+ *   const auto reads = std::vector{0123_s, 30123_s};
+ *   for (const auto& aln : aligner.align(001230123_s, reads))
+ *     std::cout << aln.ref_begin << " " << aln.cigar << "\n";
+ *   // Output:
+ *   // 1 4M
+ *   // 4 5M
+ * }
+ * ```
+ */
+struct BatchSmithWaterman {
+  using Alignment = SmithWaterman::Alignment;
+
+  /**
+   * @brief Score of a matched base.
+   */
+  int MATCH = 1;
+
+  /**
+   * @brief Penalty of a mismatched base.
+   */
+  int MISMATCH = 4;
+
+  /**
+   * @brief Penalty of opening a gap.
+   */
+  int GAP_OPEN = 6;
+
+  /**
+   * @brief Penalty of each base in a gap, must be positive.
+   */
+  int GAP_EXTEND = 1;
+
+  /**
+   * @brief Align whole reads against any part of the target instead of the
+   * best scoring parts of both.
+   */
+  bool SEMI_GLOBAL = false;
+
+ private:
+  constexpr static auto LANES = sizeof(__m256i) / sizeof(std::int16_t);
+
+  /*
+   * Cells of a group at most, whose traceback directions take LANES bytes
+   * each.
+   */
+  constexpr static auto MAX_CELLS = std::size_t{1} << 22;
+  enum : std::uint8_t { DIAG, DEL, INS, ZERO, DEL_EXT = 4, INS_EXT = 8 };
+
+  static auto
+  lanes(__m256i v) noexcept {
+    auto a = std::array<std::int16_t, LANES>{};
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(a.data()), v);
+    return a;
+  }
+
+  auto
+  fallback() const noexcept {
+    return SmithWaterman{.MATCH = MATCH,
+                         .MISMATCH = MISMATCH,
+                         .GAP_OPEN = GAP_OPEN,
+                         .GAP_EXTEND = GAP_EXTEND,
+                         .SEMI_GLOBAL = SEMI_GLOBAL};
+  }
+
+  auto
+  may_overflow(std::size_t read_size) const noexcept {
+    const auto worst = std::max(MISMATCH, GAP_OPEN + GAP_EXTEND)
+                         * std::int64_t(read_size + 1)
+                       + GAP_OPEN + MATCH * std::int64_t(read_size);
+    return worst >= std::numeric_limits<std::int16_t>::max() / 2;
+  }
+
+  /*
+   * Rows and columns are indexed in 16-bit lanes.
+   */
+  auto
+  fits(std::size_t target_size, std::size_t read_size) const noexcept {
+    using limits = std::numeric_limits<std::int16_t>;
+    return target_size <= std::size_t(limits::max())
+           && read_size <= std::size_t(limits::max())
+           && target_size * read_size <= MAX_CELLS;
+  }
+
+  auto
+  traceback(const std::vector<__m128i>& dirs, std::size_t n, std::size_t lane,
+            int score, int row, int col, std::size_t read_size,
+            Alignment& aln) const {
+    aln = Alignment{};
+    if (!SEMI_GLOBAL && score <= 0) {
+      aln.cigar.emplace_back(read_size, 'S');
+      return;
+    }
+
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(dirs.data());
+    auto ops = std::string{};
+    auto i = row;
+    auto j = col;
+    auto state = std::uint8_t{DIAG};
+    while (i >= 0 && j >= 0) {
+      const auto dir = bytes[(i * n + j) * LANES + lane];
+      if (state == DIAG) {
+        state = dir & 3;
+        if (state == ZERO)
+          break;
+      }
+      if (state == DIAG) {
+        ops += 'M';
+        i--;
+        j--;
+      } else if (state == DEL) {
+        ops += 'D';
+        state = dir & DEL_EXT ? DEL : DIAG;
+        j--;
+      } else {
+        ops += 'I';
+        state = dir & INS_EXT ? INS : DIAG;
+        i--;
+      }
+    }
+    if (SEMI_GLOBAL) {
+      ops.append(i + 1, 'I');
+      i = -1;
+    }
+
+    aln.score = score;
+    aln.read_begin = i + 1;
+    aln.read_end = row + 1;
+    aln.ref_begin = j + 1;
+    aln.ref_end = col + 1;
+    if (aln.read_begin > 0)
+      aln.cigar.emplace_back(aln.read_begin, 'S');
+    for (const auto op : ops | std::views::reverse)
+      aln.cigar.emplace_back(1, op);
+    if (aln.read_end < read_size)
+      aln.cigar.emplace_back(read_size - aln.read_end, 'S');
+    aln.cigar.compact();
+  }
+
+  /*
+   * Align up to LANES reads; alignments of lanes which may overflow are left
+   * untouched for the caller to redo.
+   */
+  auto
+  align_group(istring_view target, std::span<const istring_view> reads,
+              std::span<Alignment*> alns) const {
+    using limits = std::numeric_limits<std::int16_t>;
+    const auto n = target.size();
+    const auto rows
+      = std::ranges::max(reads | std::views::transform(&istring_view::size));
+    const auto gap_oe = GAP_OPEN + GAP_EXTEND;
+
+    // Pack read bases column-wise; 5 pads the shorter reads.
+    auto bases = std::vector<__m256i>(rows);
+    auto lens = std::array<std::int16_t, LANES>{};
+    for (auto i = 0u; i < rows; i++) {
+      auto v = std::array<std::int16_t, LANES>{};
+      for (auto k = 0u; k < LANES; k++)
+        v[k] = k < reads.size() && i < reads[k].size() ? reads[k][i] : 5;
+      bases[i]
+        = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.data()));
+    }
+    for (auto k = 0u; k < reads.size(); k++) lens[k] = reads[k].size();
+    const auto v_last
+      = _mm256_sub_epi16(_mm256_loadu_si256(
+                           reinterpret_cast<const __m256i*>(lens.data())),
+                         _mm256_set1_epi16(1));
+
+    const auto zero = _mm256_setzero_si256();
+    const auto v_neg_inf = _mm256_set1_epi16(limits::min());
+    const auto v_match = _mm256_set1_epi16(MATCH);
+    const auto v_mismatch = _mm256_set1_epi16(-MISMATCH);
+    const auto v_gap_oe = _mm256_set1_epi16(gap_oe);
+    const auto v_gap_e = _mm256_set1_epi16(GAP_EXTEND);
+    const auto v_one = _mm256_set1_epi16(1);
+
+    // Previous row of H and F, indexed by target column + 1.
+    auto h_up = std::vector<__m256i>(n + 1, zero);
+    auto h_cur = std::vector<__m256i>(n + 1);
+    auto f = std::vector<__m256i>(n + 1, v_neg_inf);
+    auto dirs = std::vector<__m128i>(rows * n);
+    auto v_best = SEMI_GLOBAL ? v_neg_inf : zero;
+    auto v_best_row = _mm256_set1_epi16(-1);
+    auto v_best_col = _mm256_set1_epi16(-1);
+    for (auto i = 0u; i < rows; i++) {
+      const auto v_read = bases[i];
+      const auto v_row = _mm256_set1_epi16(i);
+      const auto boundary
+        = SEMI_GLOBAL ? -(GAP_OPEN + GAP_EXTEND * int(i + 1)) : 0;
+      h_cur[0] = _mm256_set1_epi16(std::max<int>(boundary, limits::min()));
+      auto v_e = _mm256_subs_epi16(h_cur[0], v_gap_oe);
+      auto* dir = dirs.data() + i * n;
+      for (auto j = 0u; j < n; j++) {
+        const auto t = target[j] < 4 ? target[j] : 6;
+        const auto eq = _mm256_cmpeq_epi16(v_read, _mm256_set1_epi16(t));
+        auto cur = _mm256_adds_epi16(
+          h_up[j], _mm256_blendv_epi8(v_mismatch, v_match, eq));
+
+        // E (deletion) runs along the row, F (insertion) down the column.
+        const auto e_open = _mm256_subs_epi16(h_cur[j], v_gap_oe);
+        const auto e_ext = _mm256_subs_epi16(v_e, v_gap_e);
+        const auto del_ext = _mm256_cmpgt_epi16(e_ext, e_open);
+        if (j > 0)
+          v_e = _mm256_max_epi16(e_open, e_ext);
+        const auto f_open = _mm256_subs_epi16(h_up[j + 1], v_gap_oe);
+        const auto f_ext = _mm256_subs_epi16(f[j + 1], v_gap_e);
+        const auto ins_ext = _mm256_cmpgt_epi16(f_ext, f_open);
+        f[j + 1] = _mm256_max_epi16(f_open, f_ext);
+
+        auto src = zero;
+        const auto gt_e = _mm256_cmpgt_epi16(v_e, cur);
+        cur = _mm256_max_epi16(cur, v_e);
+        src = _mm256_blendv_epi8(src, _mm256_set1_epi16(DEL), gt_e);
+        const auto gt_f = _mm256_cmpgt_epi16(f[j + 1], cur);
+        cur = _mm256_max_epi16(cur, f[j + 1]);
+        src = _mm256_blendv_epi8(src, _mm256_set1_epi16(INS), gt_f);
+        if (!SEMI_GLOBAL) {
+          const auto le_zero = _mm256_cmpgt_epi16(v_one, cur);
+          cur = _mm256_max_epi16(cur, zero);
+          src = _mm256_blendv_epi8(src, _mm256_set1_epi16(ZERO), le_zero);
+        }
+        h_cur[j + 1] = cur;
+
+        src = _mm256_or_si256(
+          src, _mm256_and_si256(del_ext, _mm256_set1_epi16(DEL_EXT)));
+        src = _mm256_or_si256(
+          src, _mm256_and_si256(ins_ext, _mm256_set1_epi16(INS_EXT)));
+        dir[j] = _mm_packus_epi16(_mm256_castsi256_si128(src),
+                                  _mm256_extracti128_si256(src, 1));
+
+        // Semi-global ends on the last base of each read, local ends
+        // anywhere but in the padding.
+        const auto in_read
+          = SEMI_GLOBAL ? _mm256_cmpeq_epi16(v_row, v_last)
+                        : _mm256_cmpgt_epi16(v_last,
+                                             _mm256_sub_epi16(v_row, v_one));
+        const auto better
+          = _mm256_and_si256(_mm256_cmpgt_epi16(cur, v_best), in_read);
+        v_best = _mm256_blendv_epi8(v_best, cur, better);
+        v_best_row = _mm256_blendv_epi8(v_best_row, v_row, better);
+        v_best_col
+          = _mm256_blendv_epi8(v_best_col, _mm256_set1_epi16(j), better);
+      }
+      h_up.swap(h_cur);
+    }
+
+    const auto best = lanes(v_best);
+    const auto best_row = lanes(v_best_row);
+    const auto best_col = lanes(v_best_col);
+    for (auto k = 0u; k < reads.size(); k++) {
+      if (!SEMI_GLOBAL && best[k] + MATCH >= limits::max())
+        continue;
+      auto& aln = *alns[k];
+      traceback(dirs, n, k, best[k], best_row[k], best_col[k], reads[k].size(),
+                aln);
+    }
+  }
+
+ public:
+  /**
+   * @brief Align every read against the target.
+   *
+   * @param target Target sequence in integer encoding.
+   * @param reads Reads in integer encoding.
+   * @return Alignments in the order of reads, positions relative to target.
+   */
+  auto
+  align(istring_view target, std::span<const istring_view> reads) const {
+    auto alns = std::vector<Alignment>(reads.size());
+    auto order = std::vector<std::size_t>(reads.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, {}, [&reads](auto i) {
+      return reads[i].size();
+    });
+
+    const auto groups = (reads.size() + LANES - 1) / LANES;
+    tbb::parallel_for(std::size_t{}, groups, [&](auto g) {
+      auto group_reads = std::array<istring_view, LANES>{};
+      auto group_alns = std::array<Alignment*, LANES>{};
+      auto size = std::size_t{};
+      auto fallbacks = std::vector<std::size_t>{};
+      for (auto k = g * LANES; k < std::min((g + 1) * LANES, reads.size());
+           k++) {
+        const auto id = order[k];
+        if (reads[id].empty() || target.empty()
+            || !fits(target.size(), reads[id].size())
+            || (SEMI_GLOBAL && may_overflow(reads[id].size()))) {
+          fallbacks.push_back(id);
+          continue;
+        }
+        group_reads[size] = reads[id];
+        group_alns[size++] = &alns[id];
+      }
+      if (size != 0)
+        align_group(target, {group_reads.data(), size},
+                    {group_alns.data(), size});
+      for (auto k = 0u; k < size; k++)
+        if (group_alns[k]->cigar.size() == 0)
+          fallbacks.push_back(group_alns[k] - alns.data());
+      for (const auto id : fallbacks)
+        alns[id] = fallback().align(target, reads[id]);
+    });
+    return alns;
+  }
+
+  /**
+   * @brief Align every read against the target.
+   *
+   * @param target Target sequence in integer encoding.
+   * @param reads Reads in integer encoding.
+   * @return Alignments in the order of reads, positions relative to target.
+   */
+  auto
+  align(istring_view target, const std::vector<istring>& reads) const {
+    auto views = std::vector<istring_view>(reads.begin(), reads.end());
+    return align(target, std::span<const istring_view>{views});
+  }
+
+  /**
+   * @brief Realign records against a reference window and update their
+   * `cigar` and `pos` in place.
+   *
+   * @param target Reference window in integer encoding.
+   * @param target_begin 0-based position of the window on the reference.
+   * @param records Records to realign; hard clips are dropped.
+   * @return Alignments in the order of records, positions relative to target.
+   */
+  template<bool Encoded>
+  auto
+  realign(istring_view target, std::uint32_t target_begin,
+          std::span<SamRecord<Encoded>> records) const {
+    auto seqs = std::vector<istring>{};
+    auto views = std::vector<istring_view>{};
+    if constexpr (Encoded)
+      for (const auto& record : records) views.emplace_back(record.seq);
+    else {
+      seqs.reserve(records.size());
+      for (const auto& record : records)
+        views.emplace_back(seqs.emplace_back(Codec::to_istring(record.seq)));
+    }
+
+    auto alns = align(target, std::span<const istring_view>{views});
+    for (auto i = 0u; i < records.size(); i++) {
+      records[i].cigar = alns[i].cigar;
+      records[i].pos = target_begin + alns[i].ref_begin + 1;
+    }
+    return alns;
+  }
+};
+
+}  // namespace biovoltron
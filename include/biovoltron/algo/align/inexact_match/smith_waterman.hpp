@@ -0,0 +1,555 @@
+#pragma once
+
+#include <biovoltron/file_io/cigar.hpp>
+#include <biovoltron/utility/istring.hpp>
+#include <array>
+#include <immintrin.h>
+#include <limits>
+#include <vector>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Striped (Farrar) Smith-Waterman aligner with affine gap penalty on
+ * AVX2.
+ *
+ * Scores are first computed with 32 unsigned 8-bit lanes, retried with 16
+ * signed 16-bit lanes when the 8-bit score saturates, and finally with a
+ * scalar 32-bit kernel. Once the best score and its end position are known,
+ * the alignment is traced back inside the smallest reference window which can
+ * contain it, so the cost of the CIGAR is independent of the reference size.
+ *
+ * A gap of length `L` costs `GAP_OPEN + L * GAP_EXTEND`, so a zero GAP_OPEN
+ * gives linear gaps. Ambiguous bases (code 4) always score as mismatches.
+ *
+ * Example
+ * ```cpp
+ * #include <iostream>
+ * #include <biovoltron/algo/align/inexact_match/smith_waterman.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   const auto aligner = SmithWaterman{};
+ *   const auto aln = aligner.align(0123012301230123_s, 23012301_s);
+ *   std::cout << aln.score << " " << aln.cigar << "\n";
+ *   // Output: 8 8M
+ * }
+ * ```
+ */
+struct SmithWaterman {
+  /**
+   * @brief Result of aligning a read against a reference.
+   *
+   * Ranges are 0-based and half-open. In local mode, the unaligned parts of
+   * the read are soft clipped in the cigar.
+   */
+  struct Alignment {
+    int score{};
+    std::uint32_t ref_begin{};
+    std::uint32_t ref_end{};
+    std::uint32_t read_begin{};
+    std::uint32_t read_end{};
+    Cigar cigar;
+  };
+
+  /**
+   * @brief Score of a matched base.
+   */
+  int MATCH = 1;
+
+  /**
+   * @brief Penalty of a mismatched base.
+   */
+  int MISMATCH = 4;
+
+  /**
+   * @brief Penalty of opening a gap, may be zero.
+   */
+  int GAP_OPEN = 6;
+
+  /**
+   * @brief Penalty of each base in a gap, must be positive.
+   */
+  int GAP_EXTEND = 1;
+
+  /**
+   * @brief Align the whole read against any part of the reference instead of
+   * the best scoring parts of both.
+   */
+  bool SEMI_GLOBAL = false;
+
+ private:
+  constexpr static auto LANES8 = sizeof(__m256i);
+  constexpr static auto LANES16 = sizeof(__m256i) / 2;
+
+  struct End {
+    int score = 0;
+    int ref_end = -1;
+    int read_end = -1;
+    bool overflow = false;
+  };
+
+  auto
+  score(ichar a, ichar b) const noexcept {
+    return a == b && a < 4 ? MATCH : -MISMATCH;
+  }
+
+  static auto
+  shift8(__m256i v) noexcept {
+    return _mm256_alignr_epi8(v, _mm256_permute2x128_si256(v, v, 0x08), 15);
+  }
+
+  static auto
+  shift16(__m256i v) noexcept {
+    return _mm256_alignr_epi8(v, _mm256_permute2x128_si256(v, v, 0x08), 14);
+  }
+
+  template<class T>
+  static auto
+  lanes(__m256i v) noexcept {
+    auto a = std::array<T, sizeof(__m256i) / sizeof(T)>{};
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(a.data()), v);
+    return a;
+  }
+
+  template<class T>
+  static auto
+  find_read_end(const std::vector<__m256i>& h, std::size_t seg_len,
+                int score) noexcept {
+    auto read_end = std::numeric_limits<int>::max();
+    for (auto s = 0u; s < seg_len; s++) {
+      const auto col = lanes<T>(h[s]);
+      for (auto k = 0u; k < col.size(); k++)
+        if (col[k] == score)
+          read_end = std::min<int>(read_end, k * seg_len + s);
+    }
+    return read_end == std::numeric_limits<int>::max() ? -1 : read_end;
+  }
+
+  /*
+   * 8-bit striped kernel, local mode only. Scores are biased by MISMATCH so
+   * that they fit unsigned saturated arithmetic.
+   */
+  auto
+  striped8(istring_view ref, istring_view read) const {
+    const auto seg_len = (read.size() + LANES8 - 1) / LANES8;
+    const auto bias = MISMATCH;
+    auto profile = std::vector<__m256i>(5 * seg_len);
+    for (auto b = 0; b < 5; b++) {
+      for (auto s = 0u; s < seg_len; s++) {
+        auto v = std::array<std::uint8_t, LANES8>{};
+        for (auto k = 0u; k < LANES8; k++)
+          if (const auto i = k * seg_len + s; i < read.size())
+            v[k] = score(read[i], b) + bias;
+        profile[b * seg_len + s]
+          = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.data()));
+      }
+    }
+
+    const auto zero = _mm256_setzero_si256();
+    const auto v_bias = _mm256_set1_epi8(bias);
+    const auto v_gap_oe = _mm256_set1_epi8(GAP_OPEN + GAP_EXTEND);
+    const auto v_gap_e = _mm256_set1_epi8(GAP_EXTEND);
+    auto h_store = std::vector<__m256i>(seg_len, zero);
+    auto h_load = std::vector<__m256i>(seg_len, zero);
+    auto h_max = std::vector<__m256i>(seg_len, zero);
+    auto e = std::vector<__m256i>(seg_len, zero);
+    auto end = End{};
+    for (auto j = 0; j < ref.size(); j++) {
+      const auto* p = profile.data() + std::min<ichar>(ref[j], 4) * seg_len;
+      auto v_f = zero;
+      auto v_h = shift8(h_store[seg_len - 1]);
+      h_load.swap(h_store);
+      for (auto s = 0u; s < seg_len; s++) {
+        v_h = _mm256_subs_epu8(_mm256_adds_epu8(v_h, p[s]), v_bias);
+        auto v_e = e[s];
+        v_h = _mm256_max_epu8(_mm256_max_epu8(v_h, v_e), v_f);
+        h_store[s] = v_h;
+        v_h = _mm256_subs_epu8(v_h, v_gap_oe);
+        e[s] = _mm256_max_epu8(_mm256_subs_epu8(v_e, v_gap_e), v_h);
+        v_f = _mm256_max_epu8(_mm256_subs_epu8(v_f, v_gap_e), v_h);
+        v_h = h_load[s];
+      }
+
+      v_f = shift8(v_f);
+      for (auto s = 0u;;) {
+        // F only reaches the next segment if it beats the H the first pass
+        // opened the gap from, which must be the H before this update when
+        // GAP_OPEN is 0.
+        const auto v_open = _mm256_subs_epu8(h_store[s], v_gap_oe);
+        v_h = _mm256_max_epu8(h_store[s], v_f);
+        h_store[s] = v_h;
+        v_h = _mm256_subs_epu8(v_h, v_gap_oe);
+        e[s] = _mm256_max_epu8(e[s], v_h);
+        v_f = _mm256_subs_epu8(v_f, v_gap_e);
+        if (const auto gt = _mm256_subs_epu8(v_f, v_open);
+            _mm256_testz_si256(gt, gt))
+          break;
+        if (++s == seg_len) {
+          s = 0;
+          v_f = shift8(v_f);
+        }
+      }
+
+      auto v_max = zero;
+      for (auto s = 0u; s < seg_len; s++)
+        v_max = _mm256_max_epu8(v_max, h_store[s]);
+      const auto col = lanes<std::uint8_t>(v_max);
+      if (const int max = *std::ranges::max_element(col); max > end.score) {
+        if (max + bias + MATCH >= std::numeric_limits<std::uint8_t>::max())
+          return End{.overflow = true};
+        end.score = max;
+        end.ref_end = j;
+        h_max = h_store;
+      }
+    }
+    end.read_end = find_read_end<std::uint8_t>(h_max, seg_len, end.score);
+    return end;
+  }
+
+  /*
+   * 16-bit striped kernel for both local and semi-global modes.
+   */
+  auto
+  striped16(istring_view ref, istring_view read) const {
+    using limits = std::numeric_limits<std::int16_t>;
+    const auto seg_len = (read.size() + LANES16 - 1) / LANES16;
+    auto profile = std::vector<__m256i>(5 * seg_len);
+    for (auto b = 0; b < 5; b++) {
+      for (auto s = 0u; s < seg_len; s++) {
+        auto v = std::array<std::int16_t, LANES16>{};
+        for (auto k = 0u; k < LANES16; k++) {
+          const auto i = k * seg_len + s;
+          v[k] = i < read.size() ? score(read[i], b) : -MISMATCH;
+        }
+        profile[b * seg_len + s]
+          = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.data()));
+      }
+    }
+
+    // Boundary column before the reference: the read prefix is inserted.
+    const auto gap_oe = GAP_OPEN + GAP_EXTEND;
+    auto h_store = std::vector<__m256i>(seg_len);
+    auto e = std::vector<__m256i>(seg_len);
+    for (auto s = 0u; s < seg_len; s++) {
+      auto h = std::array<std::int16_t, LANES16>{};
+      auto v_e = std::array<std::int16_t, LANES16>{};
+      for (auto k = 0u; k < LANES16; k++) {
+        const auto i = k * seg_len + s;
+        if (!SEMI_GLOBAL)
+          continue;
+        h[k] = i < read.size() ? -(GAP_OPEN + GAP_EXTEND * int(i + 1))
+                               : limits::min();
+        v_e[k] = i < read.size() ? h[k] - gap_oe : limits::min();
+      }
+      h_store[s]
+        = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h.data()));
+      e[s] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v_e.data()));
+    }
+
+    const auto zero = _mm256_setzero_si256();
+    const auto v_floor = SEMI_GLOBAL ? _mm256_set1_epi16(limits::min()) : zero;
+    const auto v_lane0_floor
+      = _mm256_setr_epi16(limits::min(), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                          0, 0);
+    const auto v_f_init
+      = SEMI_GLOBAL ? _mm256_insert_epi16(v_floor, -gap_oe, 0) : zero;
+    const auto v_gap_oe = _mm256_set1_epi16(gap_oe);
+    const auto v_gap_e = _mm256_set1_epi16(GAP_EXTEND);
+    auto h_load = std::vector<__m256i>(seg_len, zero);
+    auto h_max = std::vector<__m256i>(seg_len, zero);
+    const auto last_seg = (read.size() - 1) % seg_len;
+    const auto last_lane = (read.size() - 1) / seg_len;
+    auto end = End{.score = SEMI_GLOBAL ? limits::min() : 0};
+    for (auto j = 0; j < ref.size(); j++) {
+      const auto* p = profile.data() + std::min<ichar>(ref[j], 4) * seg_len;
+      auto v_f = v_f_init;
+      auto v_h = shift16(h_store[seg_len - 1]);
+      h_load.swap(h_store);
+      for (auto s = 0u; s < seg_len; s++) {
+        v_h = _mm256_adds_epi16(v_h, p[s]);
+        auto v_e = e[s];
+        v_h = _mm256_max_epi16(_mm256_max_epi16(v_h, v_e), v_f);
+        if (!SEMI_GLOBAL)
+          v_h = _mm256_max_epi16(v_h, zero);
+        h_store[s] = v_h;
+        v_h = _mm256_subs_epi16(v_h, v_gap_oe);
+        e[s] = _mm256_max_epi16(_mm256_subs_epi16(v_e, v_gap_e), v_h);
+        v_f = _mm256_max_epi16(_mm256_subs_epi16(v_f, v_gap_e), v_h);
+        v_h = h_load[s];
+      }
+
+      v_f = _mm256_or_si256(shift16(v_f), v_lane0_floor);
+      for (auto s = 0u;;) {
+        const auto v_open = _mm256_subs_epi16(h_store[s], v_gap_oe);
+        v_h = _mm256_max_epi16(h_store[s], v_f);
+        h_store[s] = v_h;
+        v_h = _mm256_subs_epi16(v_h, v_gap_oe);
+        e[s] = _mm256_max_epi16(e[s], v_h);
+        v_f = _mm256_subs_epi16(v_f, v_gap_e);
+        if (!_mm256_movemask_epi8(_mm256_cmpgt_epi16(v_f, v_open)))
+          break;
+        if (++s == seg_len) {
+          s = 0;
+          v_f = _mm256_or_si256(shift16(v_f), v_lane0_floor);
+        }
+      }
+
+      if (SEMI_GLOBAL) {
+        if (const int h = lanes<std::int16_t>(h_store[last_seg])[last_lane];
+            h > end.score) {
+          end.score = h;
+          end.ref_end = j;
+        }
+        continue;
+      }
+      auto v_max = zero;
+      for (auto s = 0u; s < seg_len; s++)
+        v_max = _mm256_max_epi16(v_max, h_store[s]);
+      const auto col = lanes<std::int16_t>(v_max);
+      if (const int max = *std::ranges::max_element(col); max > end.score) {
+        if (max + MATCH >= limits::max())
+          return End{.overflow = true};
+        end.score = max;
+        end.ref_end = j;
+        h_max = h_store;
+      }
+    }
+    end.read_end = SEMI_GLOBAL
+                     ? read.size() - 1
+                     : find_read_end<std::int16_t>(h_max, seg_len, end.score);
+    return end;
+  }
+
+  /*
+   * Scalar 32-bit kernel, used when the 16-bit kernel may overflow. Ties are
+   * broken exactly as in the striped kernels.
+   */
+  auto
+  scalar(istring_view ref, istring_view read) const {
+    constexpr auto NEG_INF = std::numeric_limits<int>::min() / 2;
+    const auto gap_oe = GAP_OPEN + GAP_EXTEND;
+    auto h = std::vector<int>(read.size());
+    auto e = std::vector<int>(read.size());
+    for (auto i = 0; i < read.size(); i++) {
+      h[i] = SEMI_GLOBAL ? -(GAP_OPEN + GAP_EXTEND * (i + 1)) : 0;
+      e[i] = h[i] - gap_oe;
+    }
+    auto end = End{.score = SEMI_GLOBAL ? NEG_INF : 0};
+    for (auto j = 0; j < ref.size(); j++) {
+      auto diag = 0;
+      auto f = SEMI_GLOBAL ? -gap_oe : NEG_INF;
+      auto col_max = end.score;
+      auto col_end = -1;
+      for (auto i = 0; i < read.size(); i++) {
+        auto cur = std::max({diag + score(read[i], ref[j]), e[i], f});
+        if (!SEMI_GLOBAL)
+          cur = std::max(cur, 0);
+        diag = h[i];
+        h[i] = cur;
+        e[i] = std::max(e[i] - GAP_EXTEND, cur - gap_oe);
+        f = std::max(f - GAP_EXTEND, cur - gap_oe);
+        if (!SEMI_GLOBAL && cur > col_max) {
+          col_max = cur;
+          col_end = i;
+        }
+      }
+      if (SEMI_GLOBAL && h.back() > end.score) {
+        end.score = h.back();
+        end.ref_end = j;
+      } else if (col_end != -1) {
+        end.score = col_max;
+        end.ref_end = j;
+        end.read_end = col_end;
+      }
+    }
+    if (SEMI_GLOBAL)
+      end.read_end = read.size() - 1;
+    return end;
+  }
+
+  auto
+  find_end(istring_view ref, istring_view read) const {
+    if (!SEMI_GLOBAL) {
+      if (MATCH + MISMATCH < std::numeric_limits<std::uint8_t>::max()
+          && GAP_OPEN + GAP_EXTEND < std::numeric_limits<std::uint8_t>::max())
+        if (const auto end = striped8(ref, read); !end.overflow)
+          return end;
+      if (const auto end = striped16(ref, read); !end.overflow)
+        return end;
+      return scalar(ref, read);
+    }
+
+    // Semi-global scores are never clamped, so check the worst case upfront.
+    const auto worst = std::max(MISMATCH, GAP_OPEN + GAP_EXTEND)
+                         * std::int64_t(read.size() + 1)
+                       + GAP_OPEN + MATCH * std::int64_t(read.size());
+    if (worst < std::numeric_limits<std::int16_t>::max() / 2)
+      return striped16(ref, read);
+    return scalar(ref, read);
+  }
+
+  /*
+   * Gotoh with traceback on the window ending at the known end position.
+   */
+  auto
+  traceback(istring_view ref, istring_view read, std::uint32_t ref_offset,
+            Alignment& aln) const {
+    enum : std::uint8_t { DIAG, DEL, INS, ZERO, DEL_EXT = 4, INS_EXT = 8 };
+    constexpr auto NEG_INF = std::numeric_limits<int>::min() / 2;
+    const auto gap_oe = GAP_OPEN + GAP_EXTEND;
+    const auto m = read.size();
+    const auto n = ref.size();
+    auto dirs = std::vector<std::uint8_t>(m * n);
+    auto h = std::vector<int>(m);
+    auto e = std::vector<int>(m);
+    for (auto i = 0; i < m; i++) {
+      h[i] = SEMI_GLOBAL ? -(GAP_OPEN + GAP_EXTEND * (i + 1)) : 0;
+      e[i] = NEG_INF;
+    }
+    // A path scoring aln.score has at most max_del deletions and max_ins
+    // insertions, so only this band of diagonals around the end is filled.
+    const auto slack = std::max(0, MATCH * int(m) - aln.score - GAP_OPEN);
+    const auto max_del = slack / GAP_EXTEND + 1;
+    const auto max_ins = slack / (MATCH + GAP_EXTEND) + 1;
+    const auto shift = int(n) - int(m);
+    for (auto j = 0; j < n; j++) {
+      const auto lo = std::max(0, j - shift - max_ins);
+      const auto hi = std::min(int(m) - 1, j - shift + max_del);
+      if (lo > hi)
+        continue;
+      auto diag = lo == 0 ? 0 : h[lo - 1];
+      auto f = NEG_INF;
+      auto f_ext = false;
+      auto up = lo == 0 ? 0 : NEG_INF;
+      for (auto i = lo; i <= hi; i++) {
+        if (j > 0 && i == j - shift + max_del)
+          h[i] = e[i] = NEG_INF;
+        auto dir = std::uint8_t{};
+        const auto e_open = h[i] - gap_oe;
+        if (e[i] - GAP_EXTEND > e_open) {
+          e[i] -= GAP_EXTEND;
+          dir |= DEL_EXT;
+        } else
+          e[i] = e_open;
+        if (const auto f_open = up - gap_oe; f - GAP_EXTEND > f_open) {
+          f -= GAP_EXTEND;
+          f_ext = true;
+        } else {
+          f = f_open;
+          f_ext = false;
+        }
+        if (f_ext)
+          dir |= INS_EXT;
+
+        auto cur = diag + score(read[i], ref[j]);
+        auto src = DIAG;
+        if (e[i] > cur) {
+          cur = e[i];
+          src = DEL;
+        }
+        if (f > cur) {
+          cur = f;
+          src = INS;
+        }
+        if (!SEMI_GLOBAL && cur <= 0) {
+          cur = 0;
+          src = ZERO;
+        }
+        dirs[j * m + i] = dir | src;
+        diag = h[i];
+        h[i] = cur;
+        up = cur;
+      }
+    }
+
+    auto ops = std::string{};
+    auto i = int(m) - 1;
+    auto j = int(n) - 1;
+    auto state = std::uint8_t{DIAG};
+    while (i >= 0 && j >= 0) {
+      const auto dir = dirs[j * m + i];
+      if (state == DIAG) {
+        state = dir & 3;
+        if (state == ZERO)
+          break;
+      }
+      if (state == DIAG) {
+        ops += 'M';
+        i--;
+        j--;
+      } else if (state == DEL) {
+        ops += 'D';
+        state = dir & DEL_EXT ? DEL : DIAG;
+        j--;
+      } else {
+        ops += 'I';
+        state = dir & INS_EXT ? INS : DIAG;
+        i--;
+      }
+    }
+    if (SEMI_GLOBAL) {
+      ops.append(i + 1, 'I');
+      i = -1;
+    }
+
+    aln.read_begin = i + 1;
+    aln.ref_begin = ref_offset + j + 1;
+    if (aln.read_begin > 0)
+      aln.cigar.emplace_back(aln.read_begin, 'S');
+    for (const auto op : ops | std::views::reverse)
+      aln.cigar.emplace_back(1, op);
+  }
+
+ public:
+  /**
+   * @brief Align a read against a reference.
+   *
+   * @param ref Reference window in integer encoding.
+   * @param read Read in integer encoding.
+   * @return The best alignment. In local mode, a read which does not align
+   * anywhere gets score 0 and a fully soft clipped cigar.
+   */
+  auto
+  align(istring_view ref, istring_view read) const {
+    auto aln = Alignment{};
+    if (read.empty())
+      return aln;
+    if (ref.empty()) {
+      if (SEMI_GLOBAL) {
+        aln.score = -(GAP_OPEN + GAP_EXTEND * int(read.size()));
+        aln.read_end = read.size();
+        aln.cigar.emplace_back(read.size(), 'I');
+      } else
+        aln.cigar.emplace_back(read.size(), 'S');
+      return aln;
+    }
+
+    const auto end = find_end(ref, read);
+    if (!SEMI_GLOBAL && end.score <= 0) {
+      aln.cigar.emplace_back(read.size(), 'S');
+      return aln;
+    }
+
+    aln.score = end.score;
+    aln.read_end = end.read_end + 1;
+    aln.ref_end = end.ref_end + 1;
+
+    // An alignment of `len` read bases scoring `score` cannot contain more
+    // than this many deletions, which bounds the reference span.
+    const auto len = std::int64_t(aln.read_end);
+    const auto max_del = std::max<std::int64_t>(
+      0, (MATCH * len - aln.score - GAP_OPEN) / GAP_EXTEND + 1);
+    const auto ref_begin
+      = std::max<std::int64_t>(0, aln.ref_end - len - max_del);
+    traceback(ref.substr(ref_begin, aln.ref_end - ref_begin),
+              read.substr(0, aln.read_end), ref_begin, aln);
+    if (aln.read_end < read.size())
+      aln.cigar.emplace_back(read.size() - aln.read_end, 'S');
+    aln.cigar.compact();
+    return aln;
+  }
+};
+
+}  // namespace biovoltron
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <biovoltron/file_io/sam.hpp>
+#include <algorithm>
+#include <istream>
+#include <map>
+#include <sstream>
+#include <tbb/concurrent_hash_map.h>
+#include <tbb/parallel_for.h>
+#include <unordered_set>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Extraction and counting of splice junctions from the `N` elements
+ * of the Cigar of spliced alignments, e.g. `6M14N1I5M`.
+ *
+ * Each `N` is an intron, kept as the 0-based half-open interval it skips on
+ * the reference. Its strand is taken from the XS tag of the alignment if
+ * any, else from the LIBRARY type and the orientation of the read, so
+ * unstranded libraries without XS give junctions of unknown strand '.'.
+ * Unmapped, secondary and supplementary alignments, and those below
+ * MIN_MAPQ, are skipped.
+ *
+ * Batches of records are counted in parallel into a concurrent hash map.
+ * Introns between the exons of the transcripts of a GTF can be loaded to
+ * tell known junctions from novel ones.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/algo/align/junction_counter.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto counter = JunctionCounter{.LIBRARY = JunctionCounter::FIRST_STRAND};
+ *   auto gtf = std::ifstream{"gencode.gtf"};
+ *   counter.annotate(gtf);
+ *   auto sam = std::ifstream{"sample.sam"};
+ *   counter.add(sam);
+ *   for (const auto& [junction, count, known] : counter.junctions())
+ *     std::cout << junction << "\t" << count << "\t"
+ *               << (known ? "known" : "novel") << "\n";
+ * }
+ * ```
+ */
+struct JunctionCounter {
+  /**
+   * @brief Strandedness of the library.
+   * - UNSTRANDED: reads come from either strand.
+   * - FIRST_STRAND: the first read is antisense, e.g. dUTP.
+   * - SECOND_STRAND: the first read is sense, e.g. ligation.
+   */
+  enum Library : std::uint8_t { UNSTRANDED, FIRST_STRAND, SECOND_STRAND };
+
+  /**
+   * @brief Strandedness of the library of reads without XS tag.
+   */
+  Library LIBRARY = UNSTRANDED;
+
+  /**
+   * @brief Minimum mapping quality of the alignments counted.
+   */
+  std::uint16_t MIN_MAPQ = 0;
+
+  /**
+   * @brief Minimum number of aligned bases on both sides of a junction.
+   */
+  std::uint32_t MIN_OVERHANG = 0;
+
+  /**
+   * @brief Number of records read from a stream at once.
+   */
+  std::size_t BATCH_SIZE = 1 << 14;
+
+  /**
+   * @brief An intron, from the last base of an exon to the first base of the
+   * next one, in 0-based half-open coordinates. The donor is at begin on
+   * '+' and at end on '-'.
+   */
+  struct Junction {
+    std::string chrom;
+    std::uint32_t begin{};
+    std::uint32_t end{};
+    char strand = '.';
+
+    auto
+    operator<=>(const Junction&) const = default;
+
+    /**
+     * @brief Write a junction as a BED line, chrom, begin, end and strand
+     * separated by tabs.
+     */
+    friend auto&
+    operator<<(std::ostream& os, const Junction& junction) {
+      return os << junction.chrom << "\t" << junction.begin << "\t"
+                << junction.end << "\t" << junction.strand;
+    }
+  };
+
+  struct Hash {
+    auto
+    hash(const Junction& junction) const noexcept -> std::size_t {
+      auto h = std::hash<std::string>{}(junction.chrom);
+      for (const auto value :
+           {std::size_t{junction.begin}, std::size_t{junction.end},
+            std::size_t(junction.strand)})
+        h = h * 0x9e3779b97f4a7c15 ^ value;
+      return h;
+    }
+
+    auto
+    operator()(const Junction& junction) const noexcept -> std::size_t {
+      return hash(junction);
+    }
+
+    auto
+    equal(const Junction& a, const Junction& b) const noexcept -> bool {
+      return a == b;
+    }
+  };
+
+  /**
+   * @brief A junction with its number of reads, and whether it is an intron
+   * of the annotation.
+   */
+  struct Count {
+    Junction junction;
+    std::uint64_t count{};
+    bool known{};
+  };
+
+  /**
+   * @brief Number of reads of each junction.
+   */
+  tbb::concurrent_hash_map<Junction, std::uint64_t, Hash> counts;
+
+  /**
+   * @brief Introns of the annotation.
+   */
+  std::unordered_set<Junction, Hash> introns;
+
+  /**
+   * @brief Strand of the transcript a record comes from, '.' if unknown.
+   */
+  template<bool Encoded>
+  auto
+  strand(const SamRecord<Encoded>& record) const {
+    for (const auto& optional : record.optionals)
+      if (optional.starts_with("XS:A:") && optional.size() == 6)
+        return optional[5];
+    if (LIBRARY == UNSTRANDED)
+      return '.';
+    const auto second = record.read_paired()
+                        && (record.flag & SamUtil::SECOND_OF_PAIR);
+    const auto forward = record.read_reverse_strand() == second;
+    return forward == (LIBRARY == SECOND_STRAND) ? '+' : '-';
+  }
+
+  /**
+   * @brief Junctions of a record, empty if the record is skipped.
+   */
+  template<bool Encoded>
+  auto
+  junctions(const SamRecord<Encoded>& record) const {
+    auto result = std::vector<Junction>{};
+    constexpr auto skipped = SamUtil::READ_UNMAPPED
+                             | SamUtil::SECONDARY_ALIGNMENT
+                             | SamUtil::SUPPLEMENTARY_ALIGNMENT;
+    if ((record.flag & skipped) || record.mapq < MIN_MAPQ
+        || !record.cigar.contains('N'))
+      return result;
+
+    // Aligned bases of the blocks between introns, with the reference
+    // position past each block.
+    auto blocks = std::vector<std::pair<std::uint32_t, std::uint32_t>>{{}};
+    auto skips = std::vector<std::uint32_t>{};
+    auto ref_pos = record.begin();
+    for (const auto [size, op] : record.cigar) {
+      if (op == 'N') {
+        blocks.back().second = ref_pos;
+        skips.push_back(size);
+        blocks.emplace_back();
+      } else if (Cigar::consumes_ref(op) && Cigar::consumes_read(op))
+        blocks.back().first += size;
+      if (Cigar::consumes_ref(op))
+        ref_pos += size;
+    }
+    const auto strand = this->strand(record);
+    for (auto i = 0u; i < skips.size(); i++)
+      if (std::min(blocks[i].first, blocks[i + 1].first) >= MIN_OVERHANG)
+        result.push_back({record.rname, blocks[i].second,
+                          blocks[i].second + skips[i], strand});
+    return result;
+  }
+
+  /**
+   * @brief Count the junctions of a record.
+   */
+  template<bool Encoded>
+  auto
+  add(const SamRecord<Encoded>& record) {
+    for (auto& junction : junctions(record)) {
+      auto accessor = decltype(counts)::accessor{};
+      counts.insert(accessor, std::move(junction));
+      accessor->second++;
+    }
+  }
+
+  /**
+   * @brief Count the junctions of a batch of records in parallel.
+   */
+  template<bool Encoded>
+  auto
+  add(const std::vector<SamRecord<Encoded>>& records) {
+    tbb::parallel_for(std::size_t{}, records.size(),
+                      [&](auto i) { add(records[i]); });
+  }
+
+  /**
+   * @brief Count the junctions of every record of a SAM stream, BATCH_SIZE
+   * records at a time.
+   */
+  auto
+  add(std::istream& is) {
+    auto header = SamHeader{};
+    is >> header;
+    auto batch = std::vector<SamRecord<>>{};
+    for (;;) {
+      batch.clear();
+      for (auto record = SamRecord<>{};
+           batch.size() < BATCH_SIZE && is >> record;)
+        batch.push_back(std::move(record));
+      if (batch.empty())
+        return;
+      add(batch);
+    }
+  }
+
+  /**
+   * @brief Load the introns between consecutive exons of each transcript of
+   * a GTF.
+   */
+  auto
+  annotate(std::istream& gtf) {
+    using Exon = std::pair<std::uint32_t, std::uint32_t>;
+    using Transcript = std::tuple<std::string, char, std::vector<Exon>>;
+    auto transcripts = std::map<std::string, Transcript>{};
+    for (auto line = std::string{}; std::getline(gtf, line);) {
+      if (line.starts_with('#'))
+        continue;
+      auto iss = std::istringstream{line};
+      auto chrom = std::string{}, source = std::string{},
+           feature = std::string{}, score = std::string{},
+           frame = std::string{}, attributes = std::string{};
+      auto begin = std::uint32_t{}, end = std::uint32_t{};
+      auto strand = char{};
+      iss >> chrom >> source >> feature >> begin >> end >> score >> strand
+        >> frame;
+      if (feature != "exon")
+        continue;
+      std::getline(iss, attributes);
+      const auto key = std::string_view{"transcript_id \""};
+      const auto id = attributes.find(key);
+      if (id == std::string::npos)
+        continue;
+      const auto first = id + key.size();
+      auto& [transcript_chrom, transcript_strand, exons]
+        = transcripts[attributes.substr(first,
+                                        attributes.find('"', first) - first)];
+      transcript_chrom = chrom;
+      transcript_strand = strand;
+      exons.emplace_back(begin - 1, end);
+    }
+    for (auto& [id, transcript] : transcripts) {
+      auto& [chrom, strand, exons] = transcript;
+      std::ranges::sort(exons);
+      for (auto i = 1u; i < exons.size(); i++)
+        if (exons[i - 1].second < exons[i].first)
+          introns.insert({chrom, exons[i - 1].second, exons[i].first, strand});
+    }
+  }
+
+  /**
+   * @brief Whether a junction is an intron of the annotation, on either
+   * strand if its strand is unknown.
+   */
+  auto
+  known(const Junction& junction) const {
+    if (junction.strand != '.')
+      return introns.contains(junction);
+    auto stranded = junction;
+    return introns.contains((stranded.strand = '+', stranded))
+           || introns.contains((stranded.strand = '-', stranded));
+  }
+
+  /**
+   * @brief Junctions counted so far, in order of position.
+   */
+  auto
+  junctions() const {
+    auto result = std::vector<Count>{};
+    for (const auto& [junction, count] : counts)
+      result.push_back({junction, count, known(junction)});
+    std::ranges::sort(result, {}, &Count::junction);
+    return result;
+  }
+};
+
+}  // namespace biovoltron
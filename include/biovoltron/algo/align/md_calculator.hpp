@@ -0,0 +1,277 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/file_io/sam.hpp>
+#include <bit>
+#include <cctype>
+#include <immintrin.h>
+#include <optional>
+#include <span>
+#include <tbb/parallel_for.h>
+#include <unordered_map>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Computation of the MD and NM tags of SamRecord against the
+ * reference, as `samtools calmd` does.
+ *
+ * The bases of each `M`, `=` and `X` run are compared with the reference 32
+ * at a time with AVX2, jumping from mismatch to mismatch, so a read matching
+ * the reference costs a few vector compares. An `N` on either side counts as
+ * a mismatch, a `=` in the read as a match, and the reference may be soft
+ * masked. Batches of records are processed in parallel.
+ *
+ * Records which are unmapped, have no sequence, are aligned to a chromosome
+ * not in the reference or past its end are left as they are.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/algo/align/md_calculator.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto refs = std::vector<FastaRecord<>>{};
+ *   auto fa = std::ifstream{"hg38.fa"};
+ *   for (auto ref = FastaRecord<>{}; fa >> ref;) refs.push_back(ref);
+ *
+ *   auto records = std::vector<SamRecord<>>{};
+ *   auto fin = std::ifstream{"sample.sam"};
+ *   for (auto record = SamRecord<>{}; fin >> record;)
+ *     records.push_back(record);
+ *
+ *   const auto calculator = MdCalculator<>{.refs = refs};
+ *   std::cout << calculator.fix(records) << " records fixed\n";
+ * }
+ * ```
+ */
+template<bool Encoded = false>
+struct MdCalculator {
+  /**
+   * @brief Chromosomes of the reference, matched by name with
+   * SamRecord::rname.
+   */
+  std::span<const FastaRecord<Encoded>> refs;
+
+  /**
+   * @brief Tags of an alignment.
+   */
+  struct Tags {
+    std::string md;
+    std::uint32_t nm{};
+
+    auto
+    operator==(const Tags&) const noexcept -> bool
+      = default;
+  };
+
+ private:
+  using Seq = std::conditional_t<Encoded, istring_view, std::string_view>;
+
+  /*
+   * Whether bases match, as in the vector compare of mismatch().
+   */
+  static auto
+  match(auto read, auto ref) noexcept {
+    if constexpr (Encoded)
+      return read == ref && read < 4;
+    else
+      return read == '='
+             || ((read & ~0x20) == (ref & ~0x20) && (read & ~0x20) != 'N');
+  }
+
+  /*
+   * Offset of the first mismatch of two runs of bases, or size.
+   */
+  static auto
+  mismatch(const auto* read, const auto* ref, std::size_t size) noexcept {
+    auto i = std::size_t{};
+    for (; i + 32 <= size; i += 32) {
+      const auto a
+        = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(read + i));
+      const auto b
+        = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ref + i));
+      auto matches = __m256i{};
+      if constexpr (Encoded)
+        matches = _mm256_and_si256(
+          _mm256_cmpeq_epi8(a, b),
+          _mm256_cmpgt_epi8(_mm256_set1_epi8(4), a));
+      else {
+        const auto upper = _mm256_set1_epi8(~0x20);
+        const auto ua = _mm256_and_si256(a, upper);
+        matches = _mm256_or_si256(
+          _mm256_andnot_si256(
+            _mm256_cmpeq_epi8(ua, _mm256_set1_epi8('N')),
+            _mm256_cmpeq_epi8(ua, _mm256_and_si256(b, upper))),
+          _mm256_cmpeq_epi8(a, _mm256_set1_epi8('=')));
+      }
+      if (const auto mask = ~std::uint32_t(_mm256_movemask_epi8(matches)))
+        return i + std::countr_zero(mask);
+    }
+    for (; i < size && match(read[i], ref[i]); i++);
+    return i;
+  }
+
+  static auto
+  to_upper(auto base) noexcept {
+    if constexpr (Encoded)
+      return Codec::to_char(base);
+    else
+      return char(std::toupper(base));
+  }
+
+  auto
+  find(std::string_view rname) const -> const FastaRecord<Encoded>* {
+    for (const auto& ref : refs)
+      if (ref.name == rname)
+        return &ref;
+    return nullptr;
+  }
+
+  static auto
+  compute(const SamRecord<Encoded>& record, const FastaRecord<Encoded>* ref)
+    -> std::optional<Tags> {
+    const auto& cigar = record.cigar;
+    if (ref == nullptr || record.read_unmapped() || record.pos == 0
+        || cigar.size() == 0 || record.seq.size() != cigar.read_size()
+        || std::size_t{record.begin()} + cigar.ref_size() > ref->seq.size())
+      return {};
+
+    const auto read = Seq{record.seq};
+    const auto genome = Seq{ref->seq};
+    auto tags = Tags{};
+    auto read_pos = std::size_t{};
+    auto ref_pos = std::size_t{record.begin()};
+    auto matched = 0u;
+    for (const auto [size, op] : cigar) {
+      switch (op) {
+        case 'M':
+        case '=':
+        case 'X':
+          for (auto i = std::size_t{}; i < size;) {
+            const auto j = i + mismatch(read.data() + read_pos + i,
+                                        genome.data() + ref_pos + i, size - i);
+            matched += j - i;
+            if (j == size)
+              break;
+            tags.md += std::to_string(matched);
+            tags.md += to_upper(genome[ref_pos + j]);
+            tags.nm++;
+            matched = 0;
+            i = j + 1;
+          }
+          read_pos += size;
+          ref_pos += size;
+          break;
+        case 'I':
+          tags.nm += size;
+          read_pos += size;
+          break;
+        case 'S':
+          read_pos += size;
+          break;
+        case 'D':
+          tags.md += std::to_string(matched);
+          tags.md += '^';
+          for (auto i = 0u; i < size; i++)
+            tags.md += to_upper(genome[ref_pos + i]);
+          tags.nm += size;
+          matched = 0;
+          ref_pos += size;
+          break;
+        case 'N':
+          ref_pos += size;
+          break;
+        default:
+          break;
+      }
+    }
+    tags.md += std::to_string(matched);
+    return tags;
+  }
+
+  static auto
+  set(std::vector<std::string>& optionals, std::string_view prefix,
+      std::string value) {
+    value.insert(0, prefix);
+    for (auto& optional : optionals)
+      if (optional.starts_with(prefix)) {
+        if (optional == value)
+          return false;
+        optional = std::move(value);
+        return true;
+      }
+    optionals.push_back(std::move(value));
+    return true;
+  }
+
+  static auto
+  fix(SamRecord<Encoded>& record, const FastaRecord<Encoded>* ref) {
+    const auto tags = compute(record, ref);
+    if (!tags)
+      return false;
+    const auto md = set(record.optionals, "MD:Z:", tags->md);
+    const auto nm = set(record.optionals, "NM:i:", std::to_string(tags->nm));
+    return md || nm;
+  }
+
+ public:
+  /**
+   * @brief MD and NM of a record, none if it cannot be computed.
+   */
+  auto
+  compute(const SamRecord<Encoded>& record) const {
+    return compute(record, find(record.rname));
+  }
+
+  /**
+   * @brief Whether the MD and NM tags of a record are both present and
+   * right. A record whose tags cannot be computed is taken as valid.
+   */
+  auto
+  validate(const SamRecord<Encoded>& record) const {
+    const auto tags = compute(record);
+    if (!tags)
+      return true;
+    auto md = false, nm = false;
+    for (const auto& optional : record.optionals) {
+      md |= optional == "MD:Z:" + tags->md;
+      nm |= optional == "NM:i:" + std::to_string(tags->nm);
+    }
+    return md && nm;
+  }
+
+  /**
+   * @brief Add or replace the MD and NM tags of a record.
+   *
+   * @return Whether a tag was added or changed.
+   */
+  auto
+  fix(SamRecord<Encoded>& record) const {
+    return fix(record, find(record.rname));
+  }
+
+  /**
+   * @brief Add or replace the MD and NM tags of a batch of records in
+   * parallel.
+   *
+   * @return Number of records whose tags were added or changed.
+   */
+  auto
+  fix(std::vector<SamRecord<Encoded>>& records) const {
+    auto chroms
+      = std::unordered_map<std::string_view, const FastaRecord<Encoded>*>{};
+    for (const auto& ref : refs) chroms.emplace(ref.name, &ref);
+    auto fixed = std::vector<std::uint8_t>(records.size());
+    tbb::parallel_for(std::size_t{}, records.size(), [&](auto i) {
+      const auto it = chroms.find(records[i].rname);
+      fixed[i] = fix(records[i], it == chroms.end() ? nullptr : it->second);
+    });
+    return std::size_t(std::ranges::count(fixed, 1));
+  }
+};
+
+}  // namespace biovoltron
@@ -0,0 +1,20 @@
+#pragma once
+
+/**
+ *  @defgroup algo algo
+ */
+
+#include <biovoltron/algo/align/aligner.hpp>
+#include <biovoltron/algo/align/exact_match/fm_index.hpp>
+#include <biovoltron/algo/align/exact_match/kmer_index.hpp>
+#include <biovoltron/algo/align/inexact_match/smith_waterman.hpp>
+#include <biovoltron/algo/align/inexact_match/batch_smith_waterman.hpp>
+#include <biovoltron/algo/align/md_calculator.hpp>
+#include <biovoltron/algo/align/junction_counter.hpp>
+#include <biovoltron/algo/kmer/kmer_counter.hpp>
+#include <biovoltron/algo/kmer/minhash.hpp>
+#include <biovoltron/algo/kmer/bloom_filter.hpp>
+#include <biovoltron/algo/trim/adapter_trimmer.hpp>
+#include <biovoltron/algo/trim/adapter_detector.hpp>
+#include <biovoltron/algo/trim/quality_filter.hpp>
+#include <biovoltron/algo/qc/fastq_qc.hpp>
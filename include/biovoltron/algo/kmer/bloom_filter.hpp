@@ -0,0 +1,289 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/archive/serializer.hpp>
+#include <biovoltron/utility/hash_utils.hpp>
+#include <biovoltron/utility/kmer_view.hpp>
+#include <atomic>
+#include <cmath>
+#include <tbb/parallel_for.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Blocked Bloom filter of the canonical k-mers of references, for
+ * screening reads.
+ *
+ * Every k-mer hashes to one cache-line sized block, and its HASHES bits (or
+ * counters) are all set inside that block, so a query loads a single cache
+ * line. Queries over a read prefetch the blocks of the next k-mers.
+ *
+ * - BloomFilter<> holds one bit per slot and answers membership.
+ * - BloomFilter<true> holds saturating 8-bit counters and answers an upper
+ *   bound of the number of occurrences of a k-mer, as a count-min sketch, for
+ *   abundance thresholds.
+ *
+ * Both are built in parallel, and are saved in a layout which load() memory
+ * maps without copying.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/algo/kmer/bloom_filter.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto host = std::vector<FastaRecord<>>{};
+ *   auto fasta = std::ifstream{"host.fa"};
+ *   for (auto record = FastaRecord<>{}; fasta >> record;)
+ *     host.push_back(record);
+ *   auto filter = BloomFilter{.K = 25};
+ *   filter.build(host);
+ *
+ *   auto fastq = std::ifstream{"sample.fq"};
+ *   for (auto read = FastqRecord<>{}; fastq >> read;)
+ *     if (filter.count_hits(read.seq) < read.seq.size() / 2)
+ *       std::cout << read << "\n";
+ * }
+ * ```
+ *
+ * @tparam Counting Whether slots are 8-bit counters instead of bits.
+ */
+template<bool Counting = false>
+struct BloomFilter {
+  /**
+   * @brief Length of the k-mers, at most 32.
+   */
+  int K = 31;
+
+  /**
+   * @brief Number of slots of a k-mer, at most 7 bits or 10 counters.
+   */
+  int HASHES = Counting ? 4 : 6;
+
+  /**
+   * @brief Size of the filter, in bits per k-mer of the references.
+   */
+  double BITS_PER_KMER = Counting ? 64 : 12;
+
+  /**
+   * @brief A cache line of 512 bits or 64 counters.
+   */
+  struct alignas(64) Block {
+    std::array<std::conditional_t<Counting, std::uint8_t, std::uint64_t>,
+               Counting ? 64 : 8>
+      slots;
+  };
+
+  /**
+   * @brief Blocks of the filter.
+   */
+  MappedVector<Block> blocks;
+
+ private:
+  constexpr static auto MAGIC
+    = Counting ? std::uint64_t{0x31304d43564f4942}   // BIOVCM01
+               : std::uint64_t{0x31304642564f4942};  // BIOVBF01
+
+  constexpr static auto SLOT_BITS = Counting ? 6 : 9;
+
+  static auto
+  block_of(std::uint64_t hash, std::size_t size) noexcept {
+    return std::size_t((unsigned __int128)hash * size >> 64);
+  }
+
+  /*
+   * The slots of a k-mer are taken from a second hash, SLOT_BITS bits each,
+   * which is independent of the block index taken from the high bits.
+   */
+  template<class F>
+  auto
+  for_each_slot(std::uint64_t hash, F&& f) const {
+    hash = HashUtils::fmix64(hash);
+    for (auto i = 0; i < HASHES; i++, hash >>= SLOT_BITS)
+      f(hash & ((1u << SLOT_BITS) - 1));
+  }
+
+  auto
+  min_counter(const Block& block, std::uint64_t hash) const noexcept {
+    auto count = std::uint8_t{255};
+    for_each_slot(hash, [&](auto slot) {
+      count = std::min(count, block.slots[slot]);
+    });
+    return count;
+  }
+
+  auto
+  test(const Block& block, std::uint64_t hash,
+       std::uint8_t min_count) const noexcept {
+    if constexpr (Counting)
+      return min_counter(block, hash) >= min_count;
+    else {
+      auto mask = std::array<std::uint64_t, 8>{};
+      for_each_slot(hash, [&](auto slot) {
+        mask[slot >> 6] |= 1ull << (slot & 63);
+      });
+      auto missing = std::uint64_t{};
+      for (auto w = 0; w < 8; w++) missing |= mask[w] & ~block.slots[w];
+      return missing == 0;
+    }
+  }
+
+  static auto
+  increment(std::uint8_t& counter) noexcept {
+    auto ref = std::atomic_ref{counter};
+    for (auto cur = ref.load(std::memory_order_relaxed); cur != 255;)
+      if (ref.compare_exchange_weak(cur, cur + 1, std::memory_order_relaxed))
+        break;
+  }
+
+ public:
+  /**
+   * @brief Build the filter of the k-mers of references. Long references are
+   * split into chunks which are inserted in parallel.
+   *
+   * @tparam R A FastaRecord or FastqRecord, with either encoding.
+   */
+  template<class R>
+    requires std::derived_from<R, FastaRecord<R::encoded>>
+  auto
+  build(const std::vector<R>& refs) {
+    if (K < 1 || K > 32)
+      throw std::invalid_argument("BloomFilter: K must be in [1, 32]");
+    if (HASHES < 1 || HASHES * SLOT_BITS > 64)
+      throw std::invalid_argument("BloomFilter: too many HASHES");
+    using Char = typename decltype(R::seq)::value_type;
+    constexpr auto CHUNK_SIZE = std::size_t{1} << 16;
+    auto chunks = std::vector<std::pair<std::size_t, std::size_t>>{};
+    auto kmers = std::size_t{};
+    for (auto r = 0u; r < refs.size(); r++) {
+      const auto size = refs[r].seq.size();
+      kmers += size >= K ? size - K + 1 : 0;
+      for (auto begin = 0ul; begin + K <= size; begin += CHUNK_SIZE)
+        chunks.emplace_back(r, begin);
+    }
+    auto table = std::vector<Block>(std::max<std::size_t>(
+      1, std::ceil(kmers * BITS_PER_KMER / (sizeof(Block) * 8))));
+    tbb::parallel_for(std::size_t{}, chunks.size(), [&](auto c) {
+      const auto [r, begin] = chunks[c];
+      const auto seq = std::basic_string_view<Char>{refs[r].seq}.substr(
+        begin, CHUNK_SIZE + K - 1);
+      for (const auto& kmer : views::kmers(seq, K)) {
+        const auto hash = HashUtils::fmix64(kmer.canonical());
+        auto& block = table[block_of(hash, table.size())];
+        for_each_slot(hash, [&](auto slot) {
+          if constexpr (Counting)
+            increment(block.slots[slot]);
+          else
+            std::atomic_ref{block.slots[slot >> 6]}.fetch_or(
+              1ull << (slot & 63), std::memory_order_relaxed);
+        });
+      }
+    });
+    blocks = std::move(table);
+  }
+
+  /**
+   * @brief Whether a canonical k-mer key may be in the references, at least
+   * min_count times for a counting filter. False for an empty filter.
+   */
+  auto
+  contains(std::uint64_t key, std::uint8_t min_count = 1) const noexcept {
+    if (blocks.empty())
+      return false;
+    const auto hash = HashUtils::fmix64(key);
+    return test(blocks[block_of(hash, blocks.size())], hash, min_count);
+  }
+
+  /**
+   * @brief Upper bound of the number of occurrences of a canonical k-mer key
+   * in the references, saturated at 255. Zero for an empty filter.
+   */
+  auto
+  count(std::uint64_t key) const noexcept
+    requires Counting
+  {
+    if (blocks.empty())
+      return std::uint8_t{};
+    const auto hash = HashUtils::fmix64(key);
+    return min_counter(blocks[block_of(hash, blocks.size())], hash);
+  }
+
+  /**
+   * @brief Number of k-mers of a sequence which may be in the references, at
+   * least min_count times for a counting filter.
+   *
+   * @param seq A std::string or an istring, e.g. FastqRecord::seq.
+   */
+  template<class S>
+  auto
+  count_hits(const S& seq, std::uint8_t min_count = 1) const {
+    if (blocks.empty())
+      return std::size_t{};
+    constexpr auto PREFETCH = 16u;
+    auto hashes = std::array<std::uint64_t, PREFETCH>{};
+    auto hits = std::size_t{};
+    auto n = 0u;
+    auto flush = [&] {
+      for (auto i = 0u; i < n; i++)
+        hits += test(blocks[block_of(hashes[i], blocks.size())], hashes[i],
+                     min_count);
+      n = 0;
+    };
+    for (const auto& kmer : views::kmers(seq, K)) {
+      hashes[n] = HashUtils::fmix64(kmer.canonical());
+      __builtin_prefetch(&blocks[block_of(hashes[n], blocks.size())]);
+      if (++n == PREFETCH)
+        flush();
+    }
+    flush();
+    return hits;
+  }
+
+  /**
+   * @brief Write the filter in a layout which load() maps without copying.
+   */
+  auto
+  save(std::ostream& os) const {
+    auto writer = Serializer::Writer{os};
+    writer.save(MAGIC);
+    writer.save(K);
+    writer.save(HASHES);
+    writer.save(blocks);
+  }
+
+  /**
+   * @brief Read a filter written by save() into memory.
+   */
+  auto
+  load(std::istream& is) {
+    auto loader = Serializer::Loader{is};
+    auto magic = std::uint64_t{};
+    loader.load(magic);
+    if (magic != MAGIC)
+      throw std::runtime_error("BloomFilter: not a filter of this type");
+    loader.load(K);
+    loader.load(HASHES);
+    auto table = std::vector<Block>{};
+    loader.load(table);
+    blocks = std::move(table);
+  }
+
+  /**
+   * @brief Memory map a filter written by save(), nothing is copied.
+   */
+  auto
+  load(const std::filesystem::path& path) {
+    auto reader = Serializer::Reader{path};
+    if (reader.value<std::uint64_t>() != MAGIC)
+      throw std::runtime_error("BloomFilter: " + path.string()
+                               + " is not a filter of this type");
+    K = reader.value<int>();
+    HASHES = reader.value<int>();
+    blocks = reader.array<Block>();
+  }
+};
+
+}  // namespace biovoltron
@@ -0,0 +1,429 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/hash_utils.hpp>
+#include <biovoltron/utility/kmer_view.hpp>
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Multi-threaded counter of the canonical k-mers of reads.
+ *
+ * K-mers are counted in a lock-free open addressing table of atomic slots,
+ * keyed by Kmer::canonical(), which threads update with a single compare and
+ * swap per new k-mer. The table takes at most MEMORY_BUDGET bytes. Occupied
+ * slots are counted per block of the table, so that threads inserting new
+ * k-mers do not contend on a single counter. When a block would be more than
+ * 3/4 full, the entries of the table are spilled to SPILL_PARTITIONS
+ * files, chosen by the minimizer of each k-mer, and the table is cleared.
+ * After a spill, every partition is merged on its own in the table, so the
+ * distinct k-mers of a single partition have to fit in the budget.
+ *
+ * K-mers containing ambiguous bases are not counted.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/algo/kmer/kmer_counter.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto counter = KmerCounter{.K = 21};
+ *   auto fin = std::ifstream{"sample.fq"};
+ *   counter.count(fin);
+ *   const auto histogram = counter.histogram();
+ *   for (auto c = 1u; c < histogram.size(); c++)
+ *     if (histogram[c] != 0)
+ *       std::cout << c << "\t" << histogram[c] << "\n";
+ * }
+ * ```
+ */
+struct KmerCounter {
+  /**
+   * @brief Length of the counted k-mers, at most 32.
+   */
+  int K = 31;
+
+  /**
+   * @brief Size of the table in bytes, rounded down to a power of two slots.
+   */
+  std::size_t MEMORY_BUDGET = std::size_t{1} << 30;
+
+  /**
+   * @brief Number of spill files.
+   */
+  int SPILL_PARTITIONS = 64;
+
+  /**
+   * @brief Length of the minimizers which choose the spill file of a k-mer,
+   * at most K.
+   */
+  int MINIMIZER_LEN = 11;
+
+  /**
+   * @brief Number of reads parsed from a stream at once.
+   */
+  std::size_t BATCH_SIZE = 1 << 14;
+
+  /**
+   * @brief Directory in which the spill files are created.
+   */
+  std::filesystem::path SPILL_DIR = std::filesystem::temp_directory_path();
+
+ private:
+  /*
+   * A canonical key is never ~0, because the reverse complement of a k-mer of
+   * T is a k-mer of A.
+   */
+  constexpr static auto EMPTY = ~std::uint64_t{};
+
+  struct Slot {
+    std::atomic<std::uint64_t> key = EMPTY;
+    std::atomic<std::uint64_t> count = 0;
+  };
+
+  /*
+   * Occupied slots of a block of the table, on its own cache line.
+   */
+  struct alignas(64) Stripe {
+    std::atomic<std::size_t> size = 0;
+  };
+
+  struct Entry {
+    std::uint64_t key;
+    std::uint64_t count;
+  };
+
+  struct Spill {
+    std::filesystem::path dir;
+    std::vector<std::ofstream> files;
+
+    auto
+    path(int p) const {
+      return dir / std::to_string(p);
+    }
+
+    Spill(const std::filesystem::path& parent, int partitions)
+    : dir(parent / ("biovoltron_kmer_counter_"
+                    + std::to_string(std::random_device{}()))) {
+      std::filesystem::create_directories(dir);
+      for (auto p = 0; p < partitions; p++) {
+        files.emplace_back(path(p), std::ios::binary);
+        if (!files.back())
+          throw std::runtime_error("KmerCounter: cannot create "
+                                   + path(p).string());
+      }
+    }
+
+    ~Spill() {
+      files.clear();
+      auto ec = std::error_code{};
+      std::filesystem::remove_all(dir, ec);
+    }
+  };
+
+ public:
+  /**
+   * @brief Open addressing table of the k-mers counted since the last spill.
+   */
+  std::vector<Slot> table;
+
+  /**
+   * @brief Number of occupied slots in each block of table.
+   */
+  std::vector<Stripe> stripes;
+
+  /**
+   * @brief Spill files, null until the table first overflows.
+   */
+  std::unique_ptr<Spill> spill;
+
+ private:
+  auto
+  stripe_shift() const noexcept {
+    return std::countr_zero(table.size()) - std::countr_zero(stripes.size());
+  }
+
+  auto
+  limit() const noexcept {
+    return (std::size_t{1} << stripe_shift()) / 4 * 3;
+  }
+
+  auto
+  init() {
+    if (K < 1 || K > 32)
+      throw std::invalid_argument("KmerCounter: K must be in [1, 32]");
+    if (MINIMIZER_LEN < 1)
+      throw std::invalid_argument("KmerCounter: MINIMIZER_LEN must be > 0");
+    if (SPILL_PARTITIONS < 1)
+      throw std::invalid_argument("KmerCounter: SPILL_PARTITIONS must be > 0");
+    if (!table.empty())
+      return;
+    table = std::vector<Slot>(
+      std::max(std::size_t{4}, std::bit_floor(MEMORY_BUDGET / sizeof(Slot))));
+    // Blocks of at least 4096 slots, whose fill varies little around the
+    // fill of the table.
+    stripes = std::vector<Stripe>(
+      std::clamp(table.size() >> 12, std::size_t{1}, std::size_t{1} << 10));
+  }
+
+  /*
+   * Add count to a key, lock-free. Fails without changing the table if the
+   * key is new and its block is at its limit.
+   */
+  auto
+  insert(std::uint64_t key, std::uint64_t count = 1) noexcept {
+    const auto mask = table.size() - 1;
+    for (auto i = HashUtils::fmix64(key) & mask;; i = (i + 1) & mask) {
+      auto& slot = table[i];
+      auto cur = slot.key.load(std::memory_order_relaxed);
+      if (cur == EMPTY) {
+        auto& stripe = stripes[i >> stripe_shift()];
+        if (stripe.size.load(std::memory_order_relaxed) >= limit())
+          return false;
+        if (slot.key.compare_exchange_strong(cur, key,
+                                             std::memory_order_relaxed)) {
+          stripe.size.fetch_add(1, std::memory_order_relaxed);
+          cur = key;
+        }
+      }
+      if (cur == key) {
+        slot.count.fetch_add(count, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+
+  auto
+  find(std::uint64_t key) const noexcept {
+    const auto mask = table.size() - 1;
+    for (auto i = HashUtils::fmix64(key) & mask;; i = (i + 1) & mask) {
+      const auto cur = table[i].key.load(std::memory_order_relaxed);
+      if (cur == key)
+        return table[i].count.load(std::memory_order_relaxed);
+      if (cur == EMPTY)
+        return std::uint64_t{};
+    }
+  }
+
+  auto
+  clear() {
+    tbb::parallel_for(std::size_t{}, table.size(), [&](auto i) {
+      table[i].key.store(EMPTY, std::memory_order_relaxed);
+      table[i].count.store(0, std::memory_order_relaxed);
+    });
+    for (auto& stripe : stripes) stripe.size = 0;
+  }
+
+  /*
+   * Partition of a key, by the smallest hash of its minimizer-length
+   * substrings, so that k-mers sharing a minimizer share a file.
+   */
+  auto
+  partition_of(std::uint64_t key) const noexcept {
+    const auto len = std::min(K, MINIMIZER_LEN);
+    const auto mask = len == 32 ? ~0ull : (1ull << 2 * len) - 1;
+    auto minimizer = EMPTY;
+    for (auto i = 0; i + len <= K; i++)
+      minimizer = std::min(minimizer, HashUtils::fmix64(key >> 2 * i & mask));
+    return minimizer % SPILL_PARTITIONS;
+  }
+
+  auto
+  spill_table() {
+    if (!spill)
+      spill = std::make_unique<Spill>(SPILL_DIR, SPILL_PARTITIONS);
+    for (const auto& slot : table)
+      if (const auto key = slot.key.load(std::memory_order_relaxed);
+          key != EMPTY) {
+        const auto entry
+          = Entry{key, slot.count.load(std::memory_order_relaxed)};
+        spill->files[partition_of(key)].write(
+          reinterpret_cast<const char*>(&entry), sizeof(entry));
+      }
+    for (auto& file : spill->files)
+      if (!file.flush())
+        throw std::runtime_error("KmerCounter: cannot write spill files");
+    clear();
+  }
+
+  template<class F>
+  auto
+  for_each_entry(int p, F&& f) const {
+    auto fin = std::ifstream{spill->path(p), std::ios::binary};
+    auto buffer = std::vector<Entry>(1 << 16);
+    while (fin.read(reinterpret_cast<char*>(buffer.data()),
+                    buffer.size() * sizeof(Entry))
+           || fin.gcount() != 0)
+      for (auto i = 0u; i < fin.gcount() / sizeof(Entry); i++) f(buffer[i]);
+  }
+
+  template<class R>
+  auto
+  count_batch(const std::vector<R>& reads) {
+    auto pending = tbb::enumerable_thread_specific<std::vector<std::uint64_t>>{};
+    tbb::parallel_for(
+      tbb::blocked_range<std::size_t>(0, reads.size()), [&](const auto& range) {
+        for (auto i = range.begin(); i != range.end(); i++)
+          for (const auto& kmer : views::kmers(reads[i].seq, K))
+            if (!insert(kmer.canonical()))
+              pending.local().push_back(kmer.canonical());
+      });
+    for (const auto& keys : pending)
+      for (const auto key : keys)
+        while (!insert(key)) spill_table();
+  }
+
+ public:
+  /**
+   * @brief Count the k-mers of reads.
+   *
+   * @tparam R A FastaRecord or FastqRecord, with either encoding.
+   */
+  template<class R>
+    requires std::derived_from<R, FastaRecord<R::encoded>>
+  auto
+  count(const std::vector<R>& reads) {
+    init();
+    count_batch(reads);
+  }
+
+  /**
+   * @brief Count the k-mers of every read in a stream. The next batch is
+   * parsed while the current one is counted.
+   *
+   * @tparam R Record type of the stream, FastqRecord by default.
+   */
+  template<class R = FastqRecord<>>
+    requires std::derived_from<R, FastaRecord<R::encoded>>
+  auto
+  count(std::istream& is) {
+    init();
+    auto read_batch = [&] {
+      auto reads = std::vector<R>{};
+      for (auto read = R{}; reads.size() < BATCH_SIZE && is >> read;)
+        reads.push_back(std::move(read));
+      return reads;
+    };
+    for (auto reads = read_batch(); !reads.empty();) {
+      auto next = std::vector<R>{};
+      auto group = tbb::task_group{};
+      group.run([&] { next = read_batch(); });
+      count_batch(reads);
+      group.wait();
+      reads.swap(next);
+    }
+  }
+
+  /**
+   * @brief Whether the table has been spilled to disk.
+   */
+  auto
+  spilled() const noexcept {
+    return spill != nullptr;
+  }
+
+  /**
+   * @brief Number of occurrences of a canonical key.
+   *
+   * Once spilled, the partition file of the key is scanned.
+   */
+  auto
+  get_count(std::uint64_t key) const {
+    auto count = table.empty() ? std::uint64_t{} : find(key);
+    if (spill) {
+      spill->files[partition_of(key)].flush();
+      for_each_entry(partition_of(key), [&](const auto& entry) {
+        if (entry.key == key)
+          count += entry.count;
+      });
+    }
+    return count;
+  }
+
+  /**
+   * @brief Number of occurrences of a k-mer or of its reverse complement.
+   *
+   * @param kmer K bases, zero if any is ambiguous.
+   */
+  auto
+  get_count(std::string_view kmer) const {
+    if (kmer.size() != K)
+      return std::uint64_t{};
+    auto kmers = views::kmers(kmer, K);
+    const auto it = kmers.begin();
+    if (it == kmers.end())
+      return std::uint64_t{};
+    return get_count((*it).canonical());
+  }
+
+  /**
+   * @brief Visit every distinct canonical key with its count, in no
+   * particular order.
+   *
+   * After a spill, the table is spilled again and each partition is merged in
+   * the table in turn, which is left empty.
+   *
+   * @param f Called as f(key, count).
+   */
+  template<class F>
+  auto
+  for_each(F&& f) {
+    if (table.empty())
+      return;
+    auto visit = [&] {
+      for (const auto& slot : table)
+        if (const auto key = slot.key.load(std::memory_order_relaxed);
+            key != EMPTY)
+          f(key, slot.count.load(std::memory_order_relaxed));
+    };
+    if (!spill) {
+      visit();
+      return;
+    }
+    spill_table();
+    for (auto p = 0; p < SPILL_PARTITIONS; p++) {
+      for_each_entry(p, [&](const auto& entry) {
+        if (!insert(entry.key, entry.count))
+          throw std::runtime_error(
+            "KmerCounter: partition exceeds MEMORY_BUDGET, increase "
+            "SPILL_PARTITIONS");
+      });
+      visit();
+      clear();
+    }
+  }
+
+  /**
+   * @brief K-mer spectrum.
+   *
+   * @param max_count Counts above are added to the last bin.
+   * @return The number of distinct k-mers occurring c times at index c, up to
+   * the largest count.
+   */
+  auto
+  histogram(std::uint64_t max_count = 10000) {
+    auto histogram = std::vector<std::uint64_t>{};
+    for_each([&](auto, auto count) {
+      count = std::min(count, max_count);
+      if (histogram.size() <= count)
+        histogram.resize(count + 1);
+      histogram[count]++;
+    });
+    return histogram;
+  }
+};
+
+}  // namespace biovoltron
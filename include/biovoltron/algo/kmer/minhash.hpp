@@ -0,0 +1,325 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/archive/serializer.hpp>
+#include <biovoltron/utility/hash_utils.hpp>
+#include <biovoltron/utility/kmer_view.hpp>
+#include <bit>
+#include <cmath>
+#include <immintrin.h>
+#include <span>
+#include <tbb/parallel_for.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief MinHash sketch of the canonical k-mers of a sample, as produced by
+ * MinHash.
+ */
+struct Sketch {
+  /**
+   * @brief Name of the sample.
+   */
+  std::string name;
+
+  /**
+   * @brief Length of the sketched k-mers.
+   */
+  int k{};
+
+  /**
+   * @brief Maximum number of hashes of a bottom-k sketch, 0 for FracMinHash.
+   */
+  std::uint64_t size{};
+
+  /**
+   * @brief Largest hash kept by a FracMinHash sketch, ~0 for bottom-k.
+   */
+  std::uint64_t max_hash = ~std::uint64_t{};
+
+  /**
+   * @brief Distinct hashes, ascending.
+   */
+  std::vector<std::uint64_t> hashes;
+
+  /**
+   * @brief Write the sketch with Serializer.
+   */
+  auto
+  save(std::ostream& os) const {
+    auto writer = Serializer::Writer{os};
+    writer.save(name);
+    writer.save(k);
+    writer.save(size);
+    writer.save(max_hash);
+    writer.save(hashes);
+  }
+
+  /**
+   * @brief Read a sketch written by save().
+   */
+  auto
+  load(std::istream& is) {
+    auto loader = Serializer::Loader{is};
+    loader.load(name);
+    loader.load(k);
+    loader.load(size);
+    loader.load(max_hash);
+    loader.load(hashes);
+  }
+
+  friend bool
+  operator==(const Sketch&, const Sketch&) = default;
+};
+
+/**
+ * @ingroup algo
+ * @brief Sketching and comparison of samples by the hashes of their
+ * canonical k-mers.
+ *
+ * A bottom-k sketch keeps the SKETCH_SIZE smallest hashes of a sample. A
+ * FracMinHash sketch, chosen by a non-zero SCALE, keeps every hash below
+ * 2^64 / SCALE, so that its size grows with the sample and containment of a
+ * small sample in a large one can be estimated. The hash of a k-mer is an
+ * invertible mix of Kmer::canonical(), so distinct k-mers never collide.
+ *
+ * Sketches are compared by the size of the intersection of their sorted
+ * hashes, which is computed four hashes at a time with AVX2, and distances()
+ * compares all pairs of a set of sketches in parallel.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/algo/kmer/minhash.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   const auto minhash = MinHash{.K = 21, .SKETCH_SIZE = 1000};
+ *   auto fin1 = std::ifstream{"sample1.fq"};
+ *   auto fin2 = std::ifstream{"sample2.fq"};
+ *   const auto a = minhash.sketch(fin1, "sample1");
+ *   const auto b = minhash.sketch(fin2, "sample2");
+ *   std::cout << MinHash::jaccard(a, b) << "\t" << MinHash::distance(a, b)
+ *             << "\n";
+ * }
+ * ```
+ */
+struct MinHash {
+  /**
+   * @brief Length of the sketched k-mers, at most 32.
+   */
+  int K = 21;
+
+  /**
+   * @brief Number of hashes of a bottom-k sketch.
+   */
+  std::size_t SKETCH_SIZE = 1000;
+
+  /**
+   * @brief If non-zero, make FracMinHash sketches keeping about one hash in
+   * SCALE instead of bottom-k sketches.
+   */
+  std::uint64_t SCALE = 0;
+
+ private:
+  struct Builder {
+    Sketch sketch;
+    std::uint64_t threshold;
+
+    auto
+    compact() {
+      auto& hashes = sketch.hashes;
+      std::ranges::sort(hashes);
+      hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+      if (sketch.size != 0 && hashes.size() >= sketch.size) {
+        hashes.resize(sketch.size);
+        threshold = hashes.back();
+      }
+    }
+
+    auto
+    add(std::uint64_t hash) {
+      if (hash > threshold)
+        return;
+      sketch.hashes.push_back(hash);
+      if (sketch.size != 0 && sketch.hashes.size() >= 2 * sketch.size)
+        compact();
+    }
+  };
+
+  auto
+  builder(std::string name) const {
+    if (K < 1 || K > 32)
+      throw std::invalid_argument("MinHash: K must be in [1, 32]");
+    if (SCALE == 0 && SKETCH_SIZE == 0)
+      throw std::invalid_argument("MinHash: SKETCH_SIZE must be > 0");
+    auto sketch = Sketch{.name = std::move(name), .k = K};
+    if (SCALE != 0)
+      sketch.max_hash = ~std::uint64_t{} / SCALE;
+    else
+      sketch.size = SKETCH_SIZE;
+    const auto threshold = sketch.max_hash;
+    return Builder{std::move(sketch), threshold};
+  }
+
+  template<class R>
+  auto
+  add(Builder& builder, const R& record) const {
+    for (const auto& kmer : views::kmers(record.seq, K))
+      builder.add(hash(kmer.canonical()));
+  }
+
+ public:
+  /**
+   * @brief Hash of a canonical k-mer key, a bijection of 64-bit integers.
+   */
+  constexpr static auto
+  hash(std::uint64_t key) noexcept {
+    return HashUtils::fmix64(key);
+  }
+
+  /**
+   * @brief Sketch the k-mers of a set of records.
+   *
+   * @tparam R A FastaRecord or FastqRecord, with either encoding.
+   */
+  template<class R>
+    requires std::derived_from<R, FastaRecord<R::encoded>>
+  auto
+  sketch(const std::vector<R>& records, std::string name = {}) const {
+    auto builder = this->builder(std::move(name));
+    for (const auto& record : records) add(builder, record);
+    builder.compact();
+    return std::move(builder.sketch);
+  }
+
+  /**
+   * @brief Sketch the k-mers of every record in a stream.
+   *
+   * @tparam R Record type of the stream, FastqRecord by default.
+   */
+  template<class R = FastqRecord<>>
+    requires std::derived_from<R, FastaRecord<R::encoded>>
+  auto
+  sketch(std::istream& is, std::string name = {}) const {
+    auto builder = this->builder(std::move(name));
+    for (auto record = R{}; is >> record;) add(builder, record);
+    builder.compact();
+    return std::move(builder.sketch);
+  }
+
+  /**
+   * @brief Number of common elements of two ascending ranges of distinct
+   * hashes, compared in blocks of four with AVX2.
+   */
+  static auto
+  intersect_size(std::span<const std::uint64_t> a,
+                 std::span<const std::uint64_t> b) noexcept {
+    auto count = std::size_t{};
+    auto i = std::size_t{}, j = std::size_t{};
+    for (; i + 4 <= a.size() && j + 4 <= b.size();) {
+      const auto va
+        = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i]));
+      const auto vb
+        = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[j]));
+      auto eq = _mm256_cmpeq_epi64(va, vb);
+      eq = _mm256_or_si256(
+        eq, _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x39)));
+      eq = _mm256_or_si256(
+        eq, _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x4e)));
+      eq = _mm256_or_si256(
+        eq, _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x93)));
+      count += std::popcount(
+        unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(eq))));
+      const auto a_max = a[i + 3], b_max = b[j + 3];
+      i += a_max <= b_max ? 4 : 0;
+      j += b_max <= a_max ? 4 : 0;
+    }
+    while (i < a.size() && j < b.size()) {
+      if (a[i] < b[j])
+        i++;
+      else if (b[j] < a[i])
+        j++;
+      else
+        count++, i++, j++;
+    }
+    return count;
+  }
+
+ private:
+  static auto
+  check(const Sketch& a, const Sketch& b) {
+    if (a.k != b.k || (a.size == 0) != (b.size == 0))
+      throw std::invalid_argument("MinHash: incompatible sketches");
+  }
+
+  /*
+   * Size of the intersection of two sketches and their own sizes, over the
+   * range of hashes which both of them hold completely.
+   */
+  static auto
+  overlap(const Sketch& a, const Sketch& b) {
+    check(a, b);
+    auto max_hash = std::min(a.max_hash, b.max_hash);
+    if (a.size != 0 && !a.hashes.empty() && !b.hashes.empty())
+      max_hash = std::min(a.hashes.back(), b.hashes.back());
+    auto truncate = [max_hash](const auto& hashes) {
+      return std::span{hashes.begin(),
+                       std::ranges::upper_bound(hashes, max_hash)};
+    };
+    const auto x = truncate(a.hashes), y = truncate(b.hashes);
+    const auto common = intersect_size(x, y);
+    return std::tuple{common, x.size(), y.size()};
+  }
+
+ public:
+  /**
+   * @brief Estimated Jaccard index of the k-mer sets of two samples.
+   */
+  static auto
+  jaccard(const Sketch& a, const Sketch& b) {
+    const auto [common, x, y] = overlap(a, b);
+    return x + y == common ? 0.0 : double(common) / (x + y - common);
+  }
+
+  /**
+   * @brief Estimated fraction of the k-mers of a which are also in b.
+   */
+  static auto
+  containment(const Sketch& a, const Sketch& b) {
+    const auto [common, x, y] = overlap(a, b);
+    return x == 0 ? 0.0 : double(common) / x;
+  }
+
+  /**
+   * @brief Mash distance, an estimate of the mutation rate between two
+   * samples from their Jaccard index. It is 1 for disjoint samples.
+   */
+  static auto
+  distance(const Sketch& a, const Sketch& b) {
+    const auto j = jaccard(a, b);
+    return j == 0 ? 1.0 : std::min(1.0, -std::log(2 * j / (1 + j)) / a.k);
+  }
+
+  /**
+   * @brief Mash distances of all pairs of sketches, in parallel.
+   *
+   * @return A symmetric n by n matrix in row-major order.
+   */
+  static auto
+  distances(std::span<const Sketch> sketches) {
+    const auto n = sketches.size();
+    for (const auto& sketch : sketches) check(sketches.front(), sketch);
+    auto matrix = std::vector<float>(n * n);
+    tbb::parallel_for(std::size_t{}, n, [&](auto i) {
+      for (auto j = i + 1; j < n; j++)
+        matrix[i * n + j] = matrix[j * n + i]
+          = distance(sketches[i], sketches[j]);
+    });
+    return matrix;
+  }
+};
+
+}  // namespace biovoltron
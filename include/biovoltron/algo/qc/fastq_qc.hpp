@@ -0,0 +1,375 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/read/quality_utils.hpp>
+#include <cstring>
+#include <immintrin.h>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <unordered_map>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Quality control statistics of FastqRecord, as reported by FastQC,
+ * collected in one parallel pass.
+ *
+ * Every thread accumulates its own statistics, which are merged at the end
+ * of each batch. The base composition of each position is counted 32
+ * positions at a time with AVX2, in 8-bit counters which are added to the
+ * totals every 255 reads.
+ *
+ * Sequences are also counted as FastQC does to find over-represented
+ * sequences and to estimate duplication: reads longer than 75 bases are
+ * truncated to 50, and only the first DUPLICATION_SAMPLE distinct sequences
+ * are tracked. Reads are counted in the order they are added, which keeps
+ * the estimate deterministic.
+ *
+ * Since batches can be added as they are read, QC can run in the same pass
+ * as trimming or filtering.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/algo/qc/fastq_qc.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto qc = FastqQc{};
+ *   auto fin = std::ifstream{"sample.fq"};
+ *   qc.add(fin);
+ *   const auto& stats = qc.stats;
+ *   for (auto i = 0u; i < stats.base_counts.size(); i++)
+ *     std::cout << i + 1 << "\t" << stats.mean_quality(i) << "\n";
+ *   for (const auto& [seq, count] : qc.overrepresented())
+ *     std::cout << seq << "\t" << count << "\n";
+ * }
+ * ```
+ */
+struct FastqQc {
+  /**
+   * @brief Number of reads read from a stream at once.
+   */
+  std::size_t BATCH_SIZE = 1 << 14;
+
+  /**
+   * @brief Number of distinct sequences tracked for duplication.
+   */
+  std::size_t DUPLICATION_SAMPLE = 100000;
+
+  /**
+   * @brief Minimum fraction of the reads of an over-represented sequence.
+   */
+  double OVERREPRESENTED_FRACTION = 0.001;
+
+  /**
+   * @brief Number of quality scores, from 0 to 93.
+   */
+  constexpr static auto QUALITIES = 94;
+
+  /**
+   * @brief Statistics of a set of reads.
+   */
+  struct Stats {
+    std::uint64_t reads{};
+    std::uint64_t bases{};
+
+    /**
+     * @brief Numbers of A, C, G, T and other bases at each position.
+     */
+    std::vector<std::array<std::uint64_t, 5>> base_counts;
+
+    /**
+     * @brief Numbers of each quality score at each position.
+     */
+    std::vector<std::array<std::uint64_t, QUALITIES>> quality_counts;
+
+    /**
+     * @brief Numbers of reads by rounded GC percentage of their ACGT bases.
+     */
+    std::array<std::uint64_t, 101> gc_histogram{};
+
+    /**
+     * @brief Numbers of reads by their mean quality, rounded down.
+     */
+    std::array<std::uint64_t, QUALITIES> mean_quality_histogram{};
+
+    /**
+     * @brief Numbers of reads by length.
+     */
+    std::vector<std::uint64_t> length_histogram;
+
+    /**
+     * @brief Mean quality at a position.
+     */
+    auto
+    mean_quality(std::size_t pos) const {
+      auto sum = 0.0, count = 0.0;
+      for (auto q = 0; q < QUALITIES; q++) {
+        sum += double(q) * quality_counts[pos][q];
+        count += quality_counts[pos][q];
+      }
+      return count == 0 ? 0.0 : sum / count;
+    }
+
+    /**
+     * @brief Smallest quality at a position of at least a fraction of the
+     * bases, e.g. 0.5 for the median.
+     */
+    auto
+    quality_quantile(std::size_t pos, double fraction) const {
+      auto total = std::uint64_t{};
+      for (const auto count : quality_counts[pos]) total += count;
+      auto count = std::uint64_t{};
+      for (auto q = 0; q < QUALITIES; q++)
+        if ((count += quality_counts[pos][q]) >= fraction * total && count)
+          return q;
+      return 0;
+    }
+
+    auto&
+    operator+=(const Stats& other) {
+      reads += other.reads;
+      bases += other.bases;
+      add(base_counts, other.base_counts);
+      add(quality_counts, other.quality_counts);
+      add(gc_histogram, other.gc_histogram);
+      add(mean_quality_histogram, other.mean_quality_histogram);
+      add(length_histogram, other.length_histogram);
+      return *this;
+    }
+
+   private:
+    template<class T>
+    static void
+    add(T& a, const T& b) {
+      if constexpr (requires { a.resize(0); }) {
+        if (a.size() < b.size())
+          a.resize(b.size());
+        for (auto i = 0u; i < b.size(); i++) add(a[i], b[i]);
+      } else if constexpr (requires { a.size(); }) {
+        for (auto i = 0u; i < b.size(); i++) add(a[i], b[i]);
+      } else
+        a += b;
+    }
+  };
+
+  /**
+   * @brief Statistics of the reads added so far.
+   */
+  Stats stats;
+
+  /**
+   * @brief Counts of the tracked sequences.
+   */
+  std::unordered_map<std::string, std::uint64_t> sequences;
+
+  /**
+   * @brief Number of reads added until DUPLICATION_SAMPLE sequences were
+   * tracked.
+   */
+  std::uint64_t sampled{};
+
+ private:
+  /*
+   * Statistics of one thread, with the base composition of the last reads
+   * pending in 8-bit counters, a row of width counters per base.
+   */
+  struct Accumulator {
+    Stats stats;
+    std::vector<std::uint8_t> pending;
+    std::size_t width{};
+    unsigned pending_reads{};
+
+    auto
+    flush() {
+      for (auto b = 0u; b < 5; b++)
+        for (auto i = 0u; i < stats.base_counts.size(); i++)
+          stats.base_counts[i][b] += pending[b * width + i];
+      std::ranges::fill(pending, 0);
+      pending_reads = 0;
+    }
+
+    auto
+    increment(std::size_t base, std::size_t pos, __m256i mask) {
+      const auto p
+        = reinterpret_cast<__m256i*>(pending.data() + base * width + pos);
+      _mm256_storeu_si256(p, _mm256_sub_epi8(_mm256_loadu_si256(p), mask));
+    }
+
+    /*
+     * Count the bases of 32 positions, the first valid of which are bases
+     * of the read, and return the number of G and C.
+     */
+    auto
+    count_bases(const char* seq, std::size_t pos, std::uint32_t valid) {
+      const auto s = _mm256_and_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(seq)),
+        _mm256_set1_epi8(~0x20));
+      const auto lanes = _mm256_cmpgt_epi8(
+        _mm256_set1_epi8(std::popcount(valid)),
+        _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                         16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28,
+                         29, 30, 31));
+      auto acgt = _mm256_setzero_si256();
+      auto gc = 0;
+      for (auto b = 0u; b < 4; b++) {
+        const auto match
+          = _mm256_cmpeq_epi8(s, _mm256_set1_epi8(Codec::to_char(b)));
+        acgt = _mm256_or_si256(acgt, match);
+        if (b == 1 || b == 2)
+          gc += std::popcount(std::uint32_t(_mm256_movemask_epi8(match)));
+        increment(b, pos, match);
+      }
+      increment(4, pos, _mm256_andnot_si256(acgt, lanes));
+      return gc;
+    }
+
+    auto
+    add(const FastqRecord<>& read) {
+      const auto size = read.seq.size();
+      if (size > width) {
+        if (pending_reads != 0)
+          flush();
+        width = (size + 31) / 32 * 32;
+        pending.assign(5 * width, 0);
+      }
+      if (stats.base_counts.size() < size) {
+        stats.base_counts.resize(size);
+        stats.quality_counts.resize(size);
+      }
+      if (stats.length_histogram.size() <= size)
+        stats.length_histogram.resize(size + 1);
+
+      auto gc = 0;
+      auto i = std::size_t{};
+      for (; i + 32 <= size; i += 32)
+        gc += count_bases(read.seq.data() + i, i, ~0u);
+      if (i < size) {
+        char tail[32]{};
+        std::memcpy(tail, read.seq.data() + i, size - i);
+        gc += count_bases(tail, i, (1ull << (size - i)) - 1);
+      }
+      if (++pending_reads == 255)
+        flush();
+
+      auto sum = std::uint64_t{};
+      for (auto j = 0u; j < std::min(size, read.qual.size()); j++) {
+        const auto q = std::clamp(read.qual[j] - QualityUtils::ASCII_OFFSET, 0,
+                                  QUALITIES - 1);
+        stats.quality_counts[j][q]++;
+        sum += q;
+      }
+      auto acgt = std::uint64_t{};
+      for (const auto c : read.seq) acgt += Codec::is_valid(c);
+      if (acgt != 0)
+        stats.gc_histogram[(200 * gc + acgt) / (2 * acgt)]++;
+      if (size != 0)
+        stats.mean_quality_histogram[sum / size]++;
+      stats.length_histogram[size]++;
+      stats.reads++;
+      stats.bases += size;
+    }
+  };
+
+  auto
+  track(const std::string& seq) {
+    auto key = seq.size() > 75 ? seq.substr(0, 50) : seq;
+    if (sequences.size() < DUPLICATION_SAMPLE) {
+      sequences[std::move(key)]++;
+      sampled++;
+    } else if (const auto it = sequences.find(key); it != sequences.end())
+      it->second++;
+  }
+
+ public:
+  /**
+   * @brief Add a read.
+   */
+  auto
+  add(const FastqRecord<>& read) {
+    auto accumulator = Accumulator{};
+    accumulator.add(read);
+    accumulator.flush();
+    stats += accumulator.stats;
+    track(read.seq);
+  }
+
+  /**
+   * @brief Add a batch of reads in parallel.
+   */
+  auto
+  add(const std::vector<FastqRecord<>>& reads) {
+    auto accumulators = tbb::enumerable_thread_specific<Accumulator>{};
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, reads.size()),
+                      [&](const auto& range) {
+                        auto& accumulator = accumulators.local();
+                        for (auto i = range.begin(); i != range.end(); i++)
+                          accumulator.add(reads[i]);
+                      });
+    for (auto& accumulator : accumulators) {
+      accumulator.flush();
+      stats += accumulator.stats;
+    }
+    for (const auto& read : reads) track(read.seq);
+  }
+
+  /**
+   * @brief Add every read of a FASTQ stream, BATCH_SIZE reads at a time.
+   */
+  auto
+  add(std::istream& is) {
+    auto batch = std::vector<FastqRecord<>>{};
+    for (;;) {
+      batch.clear();
+      for (auto read = FastqRecord<>{};
+           batch.size() < BATCH_SIZE && is >> read;)
+        batch.push_back(std::move(read));
+      if (batch.empty())
+        return;
+      add(batch);
+    }
+  }
+
+  /**
+   * @brief Tracked sequences of at least OVERREPRESENTED_FRACTION of the
+   * reads, in descending order of count.
+   */
+  auto
+  overrepresented() const {
+    auto result = std::vector<std::pair<std::string, std::uint64_t>>{};
+    for (const auto& [seq, count] : sequences)
+      if (count > OVERREPRESENTED_FRACTION * stats.reads)
+        result.emplace_back(seq, count);
+    std::ranges::sort(result, [](const auto& a, const auto& b) {
+      return std::tie(b.second, a.first) < std::tie(a.second, b.first);
+    });
+    return result;
+  }
+
+  /**
+   * @brief Numbers of tracked sequences seen 1, 2, ..., 9 and at least 10
+   * times, indexed from 0.
+   */
+  auto
+  duplication_levels() const {
+    auto levels = std::array<std::uint64_t, 10>{};
+    for (const auto& [seq, count] : sequences)
+      levels[std::min<std::uint64_t>(count, 10) - 1]++;
+    return levels;
+  }
+
+  /**
+   * @brief Estimated fraction of the reads left after removing duplicates,
+   * from the reads added until DUPLICATION_SAMPLE sequences were tracked.
+   */
+  auto
+  deduplicated_fraction() const {
+    return sampled == 0 ? 1.0 : double(sequences.size()) / sampled;
+  }
+};
+
+}  // namespace biovoltron
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/kmer_view.hpp>
+#include <cmath>
+#include <span>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Detector of the adapter sequences of a library from a sample of its
+ * first reads, e.g. to configure AdapterTrimmer.
+ *
+ * Only the first SAMPLE_SIZE reads are examined, so that the reads which are
+ * sampled can be kept in memory and trimmed with the rest of the stream,
+ * without reading the input twice.
+ *
+ * - Single-end: k-mers found in the last 2 * MAX_LENGTH bases of at least
+ *   MIN_FREQUENCY of the reads, which are not mostly one or two bases, seed
+ *   the candidates, most frequent first. A seed is extended in both directions with the consensus of the
+ *   reads containing it, while at least MIN_FREQUENCY of the reads cover a
+ *   base and MIN_AGREEMENT of them agree. Since an adapter follows inserts of
+ *   any sequence, extension to the left stops at the first base of the
+ *   adapter. Candidates sharing a k-mer with a more frequent one are dropped.
+ * - Paired-end: the insert size of each pair is found from the overlap of the
+ *   first read with the reverse complement of its mate alone, and the
+ *   adapters are the consensus of the bases past the insert. If too few pairs
+ *   overlap, each read is examined as a single-end read.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <biovoltron/algo/trim/adapter_detector.hpp>
+ * #include <biovoltron/algo/trim/adapter_trimmer.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   const auto detector = AdapterDetector{};
+ *   auto fin = std::ifstream{"sample.fq"};
+ *   auto fout = std::ofstream{"trimmed.fq"};
+ *   auto sample = std::vector<FastqRecord<>>{};
+ *   for (auto read = FastqRecord<>{};
+ *        sample.size() < detector.SAMPLE_SIZE && fin >> read;)
+ *     sample.push_back(read);
+ *
+ *   auto trimmer = AdapterTrimmer{};
+ *   if (const auto adapters = detector.detect(sample); !adapters.empty())
+ *     trimmer.ADAPTER1 = adapters.front().seq;
+ *   trimmer.trim(sample);
+ *   for (const auto& read : sample) fout << read << "\n";
+ *   trimmer.trim(fin, fout);
+ * }
+ * ```
+ */
+struct AdapterDetector {
+  /**
+   * @brief Number of reads or pairs examined from the start of the input.
+   */
+  std::size_t SAMPLE_SIZE = 100000;
+
+  /**
+   * @brief Length of the k-mers seeding the candidates, at most 32.
+   */
+  int K = 12;
+
+  /**
+   * @brief Minimum fraction of the reads which contain an adapter.
+   */
+  double MIN_FREQUENCY = 0.02;
+
+  /**
+   * @brief Minimum fraction of the reads agreeing on a base of an adapter.
+   */
+  double MIN_AGREEMENT = 0.7;
+
+  /**
+   * @brief Maximum length of a detected adapter.
+   */
+  std::size_t MAX_LENGTH = 64;
+
+  /**
+   * @brief Minimum overlap of the mates of a pair to find its insert size.
+   */
+  int MIN_INSERT = 20;
+
+  /**
+   * @brief Mismatches allowed per overlapping base of the mates of a pair.
+   */
+  double ERROR_RATE = 0.1;
+
+  /**
+   * @brief A detected adapter.
+   */
+  struct Candidate {
+    /**
+     * @brief Sequence of the adapter, from its first base.
+     */
+    std::string seq;
+
+    /**
+     * @brief Fraction of the sampled reads or pairs containing the adapter.
+     */
+    double frequency{};
+
+    friend bool
+    operator==(const Candidate&, const Candidate&) = default;
+  };
+
+ private:
+  using Reads = std::span<const FastqRecord<>>;
+
+  auto
+  sample(Reads reads) const {
+    return reads.first(std::min(reads.size(), SAMPLE_SIZE));
+  }
+
+  auto
+  min_support(std::size_t reads) const {
+    return std::max<std::size_t>(1, std::ceil(reads * MIN_FREQUENCY));
+  }
+
+  static auto
+  low_complexity(std::string_view kmer) {
+    auto counts = std::array<std::size_t, 4>{};
+    for (const auto c : kmer) counts[Codec::to_int(c) & 3]++;
+    return std::ranges::max(counts) * 2 > kmer.size()
+           || std::ranges::count(counts, 0) >= 2;
+  }
+
+  /*
+   * Consensus of sequences aligned at their first base, as long as at least
+   * min_support of them cover a base and MIN_AGREEMENT of those agree.
+   */
+  auto
+  consensus(const std::vector<std::string>& seqs,
+            std::size_t min_support) const {
+    auto result = std::string{};
+    for (auto i = 0u; result.size() < MAX_LENGTH; i++) {
+      auto votes = std::array<std::size_t, 4>{};
+      for (const auto& seq : seqs)
+        if (i < seq.size() && Codec::is_valid(seq[i]))
+          votes[Codec::to_int(seq[i])]++;
+      const auto total = votes[0] + votes[1] + votes[2] + votes[3];
+      const auto best = std::ranges::max_element(votes);
+      if (total < min_support || *best < total * MIN_AGREEMENT)
+        break;
+      result += Codec::to_char(best - votes.begin());
+    }
+    return result;
+  }
+
+  /*
+   * Insert size of a pair from the overlap of its mates, or npos if the mates
+   * do not overlap with an insert shorter than the reads.
+   */
+  auto
+  insert_size(std::string_view seq1, std::string_view seq2) const {
+    const auto size = std::min(seq1.size(), seq2.size());
+    const auto rev = Codec::rev_comp(seq2);
+    auto best_score = 0;
+    auto best = std::string_view::npos;
+    for (auto insert = size; insert-- > std::size_t(MIN_INSERT);) {
+      const auto a = seq1.substr(0, insert);
+      const auto b = std::string_view{rev}.substr(seq2.size() - insert);
+      const auto allowed = int(insert * ERROR_RATE);
+      auto mismatches = 0;
+      for (auto i = 0u; i < insert && mismatches <= allowed; i++)
+        mismatches += a[i] != b[i] && a[i] != 'N' && b[i] != 'N';
+      if (mismatches > allowed)
+        continue;
+      const auto score = int(insert) - 4 * mismatches;
+      if (score > best_score)
+        best_score = score, best = insert;
+    }
+    return best;
+  }
+
+ public:
+  /**
+   * @brief Detect the adapters of single-end reads.
+   *
+   * @return Candidates in descending order of frequency, empty if no
+   * sequence is over-represented.
+   */
+  auto
+  detect(Reads reads) const {
+    if (K < 1 || K > 32)
+      throw std::invalid_argument("AdapterDetector: K must be in [1, 32]");
+    reads = sample(reads);
+    const auto threshold = min_support(reads.size());
+    // Adapters are over-represented at the 3' end, so only the k-mers of the
+    // tail of each read are counted, once per read, in one sorted vector.
+    auto keys = std::vector<std::uint64_t>{};
+    for (const auto& read : reads) {
+      const auto seq = std::string_view{read.seq};
+      const auto tail
+        = seq.substr(seq.size() - std::min(seq.size(), 2 * MAX_LENGTH));
+      const auto begin = keys.size();
+      for (const auto& kmer : views::kmers(tail, K)) keys.push_back(kmer.fwd);
+      std::sort(keys.begin() + begin, keys.end());
+      keys.erase(std::unique(keys.begin() + begin, keys.end()), keys.end());
+    }
+    tbb::parallel_sort(keys.begin(), keys.end());
+
+    auto seeds = std::vector<std::pair<std::size_t, std::string>>{};
+    for (auto i = std::size_t{}, j = i; i < keys.size(); i = j) {
+      while (j < keys.size() && keys[j] == keys[i]) j++;
+      if (auto kmer = Codec::to_string(Codec::rhash(keys[i], K));
+          j - i >= threshold && !low_complexity(kmer))
+        seeds.emplace_back(j - i, std::move(kmer));
+    }
+    std::ranges::sort(seeds, std::greater{});
+
+    auto candidates = std::vector<Candidate>{};
+    auto known = [&](std::string_view seq) {
+      for (auto i = 0u; i + K <= seq.size(); i++)
+        for (const auto& candidate : candidates)
+          if (candidate.seq.find(seq.substr(i, K)) != std::string::npos)
+            return true;
+      return false;
+    };
+    for (const auto& [count, kmer] : seeds) {
+      if (known(kmer))
+        continue;
+      auto left = std::vector<std::string>{};
+      auto right = std::vector<std::string>{};
+      for (const auto& read : reads)
+        if (const auto pos = read.seq.find(kmer); pos != std::string::npos) {
+          left.emplace_back(read.seq.rend() - pos, read.seq.rend());
+          right.emplace_back(read.seq.substr(pos + K));
+        }
+      auto seq = consensus(left, threshold);
+      std::ranges::reverse(seq);
+      seq += kmer + consensus(right, threshold);
+      seq.resize(std::min(seq.size(), MAX_LENGTH));
+      if (!known(seq))
+        candidates.push_back({std::move(seq), double(count) / reads.size()});
+    }
+    return candidates;
+  }
+
+  /**
+   * @brief Detect the adapters of paired-end reads.
+   *
+   * @return Candidates of the first reads and of the second reads.
+   */
+  auto
+  detect(Reads reads1, Reads reads2) const {
+    if (reads1.size() != reads2.size())
+      throw std::invalid_argument("AdapterDetector: unpaired reads");
+    reads1 = sample(reads1);
+    reads2 = sample(reads2);
+    auto inserts = std::vector<std::size_t>(reads1.size());
+    tbb::parallel_for(std::size_t{}, reads1.size(), [&](auto i) {
+      inserts[i] = insert_size(reads1[i].seq, reads2[i].seq);
+    });
+    auto tails1 = std::vector<std::string>{};
+    auto tails2 = std::vector<std::string>{};
+    for (auto i = 0u; i < inserts.size(); i++)
+      if (inserts[i] != std::string_view::npos) {
+        tails1.push_back(reads1[i].seq.substr(inserts[i]));
+        tails2.push_back(reads2[i].seq.substr(inserts[i]));
+      }
+
+    const auto threshold = min_support(reads1.size());
+    if (tails1.size() >= threshold) {
+      const auto frequency = double(tails1.size()) / reads1.size();
+      auto adapter1 = consensus(tails1, threshold);
+      auto adapter2 = consensus(tails2, threshold);
+      if (adapter1.size() >= K && adapter2.size() >= K)
+        return std::pair{
+          std::vector{Candidate{std::move(adapter1), frequency}},
+          std::vector{Candidate{std::move(adapter2), frequency}}};
+    }
+    return std::pair{detect(reads1), detect(reads2)};
+  }
+};
+
+}  // namespace biovoltron
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <cstring>
+#include <immintrin.h>
+#include <span>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Adapter trimmer for single-end and paired-end FastqRecord.
+ *
+ * Sequences are compared 32 bases at a time with AVX2, and ambiguous bases
+ * match nothing and mismatch nothing.
+ *
+ * - Single-end: a read is cut at the leftmost position whose suffix matches
+ *   a prefix of the adapter over at least MIN_OVERLAP bases, with at most
+ *   ERROR_RATE mismatches per base.
+ * - Paired-end: both reads are cut at the insert size which best explains
+ *   the pair. For each insert size up to the read length, the first read is
+ *   compared to the reverse complement of its mate over the insert, and the
+ *   rest of both reads to the adapters. Matches score 1 and mismatches
+ *   -MISMATCH_PENALTY, and an insert size is only kept when the adapters
+ *   match with at most one mismatch more than ERROR_RATE allows. If the best
+ *   insert is not shorter than the reads, the pair is cut where either read
+ *   has an adapter of at least MIN_UNPAIRED_OVERLAP bases on its own.
+ *
+ * Reads are trimmed in place, and batches of reads are trimmed in parallel.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <biovoltron/algo/trim/adapter_trimmer.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   const auto trimmer = AdapterTrimmer{};
+ *   auto fin1 = std::ifstream{"sample_1.fq"};
+ *   auto fin2 = std::ifstream{"sample_2.fq"};
+ *   auto fout1 = std::ofstream{"trimmed_1.fq"};
+ *   auto fout2 = std::ofstream{"trimmed_2.fq"};
+ *   trimmer.trim(fin1, fin2, fout1, fout2);
+ * }
+ * ```
+ */
+struct AdapterTrimmer {
+  /**
+   * @brief Adapter at the 3' end of single-end reads and first reads.
+   */
+  std::string ADAPTER1 = "AGATCGGAAGAGCACACGTCTGAACTCCAGTCA";
+
+  /**
+   * @brief Adapter at the 3' end of second reads.
+   */
+  std::string ADAPTER2 = "AGATCGGAAGAGCGTCGTGTAGGGAAAGAGTGT";
+
+  /**
+   * @brief Minimum number of adapter bases to trim a single-end read.
+   */
+  int MIN_OVERLAP = 3;
+
+  /**
+   * @brief Minimum number of adapter bases to trim a pair by one read alone.
+   */
+  int MIN_UNPAIRED_OVERLAP = 10;
+
+  /**
+   * @brief Mismatches allowed per compared adapter base.
+   */
+  double ERROR_RATE = 0.1;
+
+  /**
+   * @brief Penalty of a mismatch when scoring the insert size of a pair.
+   */
+  int MISMATCH_PENALTY = 3;
+
+  /**
+   * @brief Number of reads read from a stream and trimmed at once.
+   */
+  std::size_t BATCH_SIZE = 1 << 14;
+
+ private:
+  struct Count {
+    int matches{};
+    int mismatches{};
+  };
+
+  /*
+   * Matches and mismatches of the common prefix of a and b, skipping Ns.
+   */
+  static auto
+  compare(std::string_view a, std::string_view b) noexcept {
+    const auto size = std::min(a.size(), b.size());
+    const auto n = _mm256_set1_epi8('N');
+    auto count = Count{};
+    auto block = [&](const char* x, const char* y, std::uint32_t valid) {
+      const auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x));
+      const auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y));
+      const auto eq = std::uint32_t(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+      const auto ambiguous = std::uint32_t(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(va, n), _mm256_cmpeq_epi8(vb, n))));
+      valid &= ~ambiguous;
+      count.matches += std::popcount(eq & valid);
+      count.mismatches += std::popcount(~eq & valid);
+    };
+    auto i = std::size_t{};
+    for (; i + 32 <= size; i += 32) block(a.data() + i, b.data() + i, ~0u);
+    if (i < size) {
+      char x[32]{}, y[32]{};
+      std::memcpy(x, a.data() + i, size - i);
+      std::memcpy(y, b.data() + i, size - i);
+      block(x, y, (1u << (size - i)) - 1);
+    }
+    return count;
+  }
+
+  auto
+  allowed(std::size_t size) const noexcept {
+    return int(size * ERROR_RATE);
+  }
+
+  /*
+   * Leftmost position where seq ends with a prefix of the adapter, or npos.
+   */
+  auto
+  find(std::string_view seq, std::string_view adapter,
+       int min_overlap) const noexcept {
+    for (auto pos = std::size_t{}; pos < seq.size(); pos++) {
+      const auto size = std::min(seq.size() - pos, adapter.size());
+      if (size < min_overlap)
+        break;
+      if (compare(seq.substr(pos), adapter).mismatches <= allowed(size))
+        return pos;
+    }
+    return std::string_view::npos;
+  }
+
+  /*
+   * Insert size of a pair, or npos if no adapter is found.
+   */
+  auto
+  insert_size(std::string_view seq1, std::string_view seq2) const {
+    const auto size = std::min(seq1.size(), seq2.size());
+    const auto rev2 = Codec::rev_comp(seq2);
+    const auto rev = std::string_view{rev2};
+    auto best_score = 0;
+    auto best = size;
+    for (auto insert = std::size_t{}; insert <= size; insert++) {
+      const auto adapter1 = compare(seq1.substr(insert), ADAPTER1);
+      const auto adapter2 = compare(seq2.substr(insert), ADAPTER2);
+      const auto compared
+        = std::min(seq1.size() - insert, ADAPTER1.size())
+          + std::min(seq2.size() - insert, ADAPTER2.size());
+      if (adapter1.mismatches + adapter2.mismatches > 1 + allowed(compared))
+        continue;
+      const auto overlap = compare(seq1.substr(0, insert),
+                                   rev.substr(seq2.size() - insert));
+      const auto score = overlap.matches + adapter1.matches + adapter2.matches
+                         - MISMATCH_PENALTY
+                             * (overlap.mismatches + adapter1.mismatches
+                                + adapter2.mismatches);
+      if (score > best_score)
+        best_score = score, best = insert;
+    }
+    if (best < size)
+      return best;
+    return std::min(find(seq1, ADAPTER1, MIN_UNPAIRED_OVERLAP),
+                    find(seq2, ADAPTER2, MIN_UNPAIRED_OVERLAP));
+  }
+
+  template<class R>
+  static auto
+  cut(R& read, std::size_t size) {
+    if (size < read.seq.size()) {
+      read.seq.resize(size);
+      read.qual.resize(std::min(size, read.qual.size()));
+    }
+  }
+
+  template<class F>
+  auto
+  for_each_batch(std::span<std::istream* const> is,
+                 std::span<std::ostream* const> os, F&& f) const {
+    auto batches = std::vector<std::vector<FastqRecord<>>>(is.size());
+    for (;;) {
+      for (auto i = 0u; i < is.size(); i++) {
+        batches[i].clear();
+        for (auto read = FastqRecord<>{};
+             batches[i].size() < BATCH_SIZE && *is[i] >> read;)
+          batches[i].push_back(std::move(read));
+      }
+      if (batches[0].empty())
+        return;
+      f(batches);
+      for (auto i = 0u; i < os.size(); i++)
+        for (const auto& read : batches[i]) *os[i] << read << "\n";
+    }
+  }
+
+ public:
+  /**
+   * @brief Trim the adapter of a single-end read.
+   *
+   * @return The number of trimmed bases.
+   */
+  auto
+  trim(FastqRecord<>& read) const {
+    const auto size = read.seq.size();
+    cut(read, find(read.seq, ADAPTER1, MIN_OVERLAP));
+    return size - read.seq.size();
+  }
+
+  /**
+   * @brief Trim the adapters of a pair of reads to their insert size.
+   *
+   * @return The number of trimmed bases of the first read.
+   */
+  auto
+  trim(FastqRecord<>& read1, FastqRecord<>& read2) const {
+    const auto size = read1.seq.size();
+    const auto insert = insert_size(read1.seq, read2.seq);
+    cut(read1, insert);
+    cut(read2, insert);
+    return size - read1.seq.size();
+  }
+
+  /**
+   * @brief Trim single-end reads in parallel.
+   */
+  auto
+  trim(std::vector<FastqRecord<>>& reads) const {
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, reads.size()),
+                      [&](const auto& range) {
+                        for (auto i = range.begin(); i != range.end(); i++)
+                          trim(reads[i]);
+                      });
+  }
+
+  /**
+   * @brief Trim pairs of reads in parallel.
+   */
+  auto
+  trim(std::vector<FastqRecord<>>& reads1,
+       std::vector<FastqRecord<>>& reads2) const {
+    if (reads1.size() != reads2.size())
+      throw std::invalid_argument("AdapterTrimmer: unpaired reads");
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, reads1.size()),
+                      [&](const auto& range) {
+                        for (auto i = range.begin(); i != range.end(); i++)
+                          trim(reads1[i], reads2[i]);
+                      });
+  }
+
+  /**
+   * @brief Trim a single-end FASTQ stream, BATCH_SIZE reads at a time.
+   */
+  auto
+  trim(std::istream& is, std::ostream& os) const {
+    const auto in = std::array{&is};
+    const auto out = std::array{&os};
+    for_each_batch(in, out, [&](auto& batches) { trim(batches[0]); });
+  }
+
+  /**
+   * @brief Trim a pair of FASTQ streams, BATCH_SIZE pairs at a time.
+   */
+  auto
+  trim(std::istream& is1, std::istream& is2, std::ostream& os1,
+       std::ostream& os2) const {
+    const auto in = std::array{&is1, &is2};
+    const auto out = std::array{&os1, &os2};
+    for_each_batch(in, out,
+                   [&](auto& batches) { trim(batches[0], batches[1]); });
+  }
+};
+
+}  // namespace biovoltron
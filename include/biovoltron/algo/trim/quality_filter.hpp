@@ -0,0 +1,399 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/read/quality_utils.hpp>
+#include <immintrin.h>
+#include <limits>
+#include <span>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup algo
+ * @brief Quality trimming and filtering of FastqRecord, in one pass per read.
+ *
+ * A read is first trimmed at its 3' end, then dropped if it fails a filter.
+ * Every step but MAX_N is disabled by a zero threshold, and MAX_N by
+ * std::numeric_limits<std::size_t>::max(). By default, only MIN_LENGTH and
+ * MAX_N are enabled.
+ *
+ * - TRIM_QUALITY: BWA-style trimming, which cuts the suffix maximizing the
+ *   sum of TRIM_QUALITY minus the quality of its bases.
+ * - WINDOW_QUALITY: sliding window trimming, which cuts at the first window
+ *   of WINDOW_SIZE bases whose mean quality is below WINDOW_QUALITY. Windows
+ *   of up to 16 bases are summed 16 at a time with AVX2.
+ * - MIN_LENGTH: minimum length after trimming.
+ * - MAX_N: maximum number of ambiguous bases.
+ * - MIN_MEAN_QUALITY: minimum mean quality.
+ * - MAX_DUST: maximum DUST score, the number of pairs of identical
+ *   trinucleotides over the number of trinucleotides minus one. Homopolymers
+ *   and short tandem repeats score high, random sequences below 1.
+ *
+ * Ambiguous bases and the quality sum are counted together 32 bases at a
+ * time with AVX2. Qualities are Phred+33, see QualityUtils::ASCII_OFFSET.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/algo/trim/quality_filter.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   const auto filter = QualityFilter{.WINDOW_QUALITY = 20, .MAX_DUST = 7};
+ *   auto fin = std::ifstream{"sample.fq"};
+ *   auto fout = std::ofstream{"filtered.fq"};
+ *   const auto counts = filter.filter(fin, fout);
+ *   std::cout << counts.passed << " passed, " << counts.too_short
+ *             << " too short\n";
+ * }
+ * ```
+ */
+struct QualityFilter {
+  /**
+   * @brief Quality threshold of BWA-style 3' trimming.
+   */
+  int TRIM_QUALITY = 0;
+
+  /**
+   * @brief Number of bases of a sliding window.
+   */
+  int WINDOW_SIZE = 4;
+
+  /**
+   * @brief Minimum mean quality of a sliding window.
+   */
+  int WINDOW_QUALITY = 0;
+
+  /**
+   * @brief Minimum length of a read after trimming.
+   */
+  std::size_t MIN_LENGTH = 15;
+
+  /**
+   * @brief Maximum number of ambiguous bases of a read, zero to drop any read
+   * with one.
+   */
+  std::size_t MAX_N = 5;
+
+  /**
+   * @brief Minimum mean quality of a read.
+   */
+  double MIN_MEAN_QUALITY = 0;
+
+  /**
+   * @brief Maximum DUST score of a read.
+   */
+  double MAX_DUST = 0;
+
+  /**
+   * @brief Number of reads read from a stream and filtered at once.
+   */
+  std::size_t BATCH_SIZE = 1 << 14;
+
+  /**
+   * @brief Number of reads, or pairs, kept and dropped by each filter.
+   */
+  struct Counts {
+    std::size_t passed{};
+    std::size_t too_short{};
+    std::size_t too_many_n{};
+    std::size_t low_quality{};
+    std::size_t low_complexity{};
+
+    auto&
+    operator+=(const Counts& other) noexcept {
+      passed += other.passed;
+      too_short += other.too_short;
+      too_many_n += other.too_many_n;
+      low_quality += other.low_quality;
+      low_complexity += other.low_complexity;
+      return *this;
+    }
+
+    friend bool
+    operator==(const Counts&, const Counts&) = default;
+  };
+
+  /**
+   * @brief Outcome of filtering a read, by the first filter it fails.
+   */
+  enum Result : std::uint8_t {
+    PASS,
+    TOO_SHORT,
+    TOO_MANY_N,
+    LOW_QUALITY,
+    LOW_COMPLEXITY
+  };
+
+ private:
+  constexpr static auto OFFSET = QualityUtils::ASCII_OFFSET;
+
+  /*
+   * Length of the read after BWA-style trimming. The scan stops at the
+   * first prefix of the 3' end whose sum is negative, which on most reads is
+   * within a few bases, so it stays scalar rather than summing 32 at a time.
+   */
+  auto
+  bwa_trim(std::string_view qual) const noexcept {
+    auto sum = 0, best_sum = 0;
+    auto best = qual.size();
+    for (auto i = qual.size(); i-- > 0;) {
+      sum += TRIM_QUALITY - (qual[i] - OFFSET);
+      if (sum < 0)
+        break;
+      if (sum > best_sum)
+        best_sum = sum, best = i;
+    }
+    return best;
+  }
+
+  /*
+   * Start of the first window whose quality sum is below WINDOW_QUALITY
+   * times WINDOW_SIZE, or the size of qual. Windows of up to 16 bases are
+   * summed 16 at a time in 16-bit lanes, which cannot overflow; longer ones
+   * with a running sum, which is as fast by then.
+   */
+  auto
+  window_trim(std::string_view qual) const noexcept {
+    const auto w = std::size_t(WINDOW_SIZE);
+    if (qual.size() < w)
+      return qual.size();
+    const auto min_sum = std::int64_t{WINDOW_QUALITY + OFFSET} * WINDOW_SIZE;
+    const auto windows = qual.size() - w + 1;
+    const auto data = reinterpret_cast<const std::uint8_t*>(qual.data());
+    auto i = std::size_t{};
+    if (w <= 16) {
+      constexpr auto max = std::numeric_limits<std::int16_t>::max();
+      const auto threshold
+        = _mm256_set1_epi16(std::min<std::int64_t>(min_sum, max));
+      for (; i + 16 <= windows; i += 16) {
+        auto sum = _mm256_setzero_si256();
+        for (auto j = 0u; j < w; j++)
+          sum = _mm256_add_epi16(
+            sum, _mm256_cvtepu8_epi16(_mm_loadu_si128(
+                   reinterpret_cast<const __m128i*>(data + i + j))));
+        const auto low = std::uint32_t(
+          _mm256_movemask_epi8(_mm256_cmpgt_epi16(threshold, sum)));
+        if (low != 0)
+          return i + std::countr_zero(low) / 2;
+      }
+      if (i == windows)
+        return qual.size();
+    }
+    auto sum = std::int64_t{};
+    for (auto j = 0u; j < w; j++) sum += data[i + j];
+    for (;; i++) {
+      if (sum < min_sum)
+        return i;
+      if (i + 1 == windows)
+        return qual.size();
+      sum += data[i + w] - data[i];
+    }
+  }
+
+  /*
+   * Number of ambiguous bases and sum of the qualities of a read.
+   */
+  static auto
+  statistics(std::string_view seq, std::string_view qual) noexcept {
+    const auto size = std::min(seq.size(), qual.size());
+    auto n = std::size_t{};
+    auto sum = std::uint64_t{};
+    const auto upper = _mm256_set1_epi8(~0x20);
+    const auto base_n = _mm256_set1_epi8('N');
+    const auto zero = _mm256_setzero_si256();
+    auto i = std::size_t{};
+    for (; i + 32 <= size; i += 32) {
+      const auto s = _mm256_and_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(seq.data() + i)),
+        upper);
+      const auto q
+        = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(qual.data() + i));
+      n += std::popcount(
+        std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(s, base_n))));
+      const auto sad = _mm256_sad_epu8(q, zero);
+      sum += _mm256_extract_epi64(sad, 0) + _mm256_extract_epi64(sad, 1)
+             + _mm256_extract_epi64(sad, 2) + _mm256_extract_epi64(sad, 3);
+    }
+    for (; i < size; i++) {
+      n += (seq[i] & ~0x20) == 'N';
+      sum += std::uint8_t(qual[i]);
+    }
+    return std::pair{n, sum - size * OFFSET};
+  }
+
+  /*
+   * Counting trinucleotides is a scatter into 64 counters, which AVX2 has
+   * no instruction for, so it stays scalar.
+   */
+  static auto
+  dust(std::string_view seq) noexcept {
+    if (seq.size() < 4)
+      return 0.0;
+    auto counts = std::array<std::uint32_t, 64>{};
+    auto pairs = std::uint64_t{};
+    auto code = 0u;
+    auto valid = 0u;
+    for (const auto c : seq) {
+      const auto base = Codec::to_int(c);
+      if (base == 4) {
+        valid = 0;
+        continue;
+      }
+      code = (code << 2 | base) & 63;
+      if (++valid >= 3)
+        pairs += counts[code]++;
+    }
+    return double(pairs) / (seq.size() - 3);
+  }
+
+  template<class R>
+  static auto
+  cut(R& read, std::size_t size) {
+    if (size < read.seq.size()) {
+      read.seq.resize(size);
+      read.qual.resize(std::min(size, read.qual.size()));
+    }
+  }
+
+  static auto
+  tally(Counts& counts, Result result) noexcept {
+    switch (result) {
+      case PASS: counts.passed++; break;
+      case TOO_SHORT: counts.too_short++; break;
+      case TOO_MANY_N: counts.too_many_n++; break;
+      case LOW_QUALITY: counts.low_quality++; break;
+      case LOW_COMPLEXITY: counts.low_complexity++; break;
+    }
+  }
+
+ public:
+  /**
+   * @brief Trim the 3' end of a read in place and test it against the
+   * filters.
+   */
+  auto
+  filter(FastqRecord<>& read) const {
+    auto size = std::min(read.seq.size(), read.qual.size());
+    if (TRIM_QUALITY > 0)
+      size = bwa_trim(std::string_view{read.qual}.substr(0, size));
+    if (WINDOW_QUALITY > 0 && WINDOW_SIZE > 0)
+      size = window_trim(std::string_view{read.qual}.substr(0, size));
+    cut(read, size);
+    if (read.seq.size() < MIN_LENGTH)
+      return TOO_SHORT;
+    const auto [n, sum] = statistics(read.seq, read.qual);
+    if (n > MAX_N)
+      return TOO_MANY_N;
+    if (sum < MIN_MEAN_QUALITY * read.seq.size())
+      return LOW_QUALITY;
+    if (MAX_DUST > 0 && dust(read.seq) > MAX_DUST)
+      return LOW_COMPLEXITY;
+    return PASS;
+  }
+
+  /**
+   * @brief Trim and filter single-end reads in parallel, keeping the reads
+   * which pass in their order.
+   */
+  auto
+  filter(std::vector<FastqRecord<>>& reads) const {
+    auto results = std::vector<Result>(reads.size());
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, reads.size()),
+                      [&](const auto& range) {
+                        for (auto i = range.begin(); i != range.end(); i++)
+                          results[i] = filter(reads[i]);
+                      });
+    auto counts = Counts{};
+    auto kept = std::size_t{};
+    for (auto i = 0u; i < reads.size(); i++) {
+      tally(counts, results[i]);
+      if (results[i] == PASS)
+        reads[kept++] = std::move(reads[i]);
+    }
+    reads.resize(kept);
+    return counts;
+  }
+
+  /**
+   * @brief Trim and filter pairs of reads in parallel. A pair is dropped by
+   * the first filter which either read fails.
+   */
+  auto
+  filter(std::vector<FastqRecord<>>& reads1,
+         std::vector<FastqRecord<>>& reads2) const {
+    if (reads1.size() != reads2.size())
+      throw std::invalid_argument("QualityFilter: unpaired reads");
+    auto results = std::vector<Result>(reads1.size());
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, reads1.size()),
+                      [&](const auto& range) {
+                        for (auto i = range.begin(); i != range.end(); i++) {
+                          const auto r1 = filter(reads1[i]);
+                          const auto r2 = filter(reads2[i]);
+                          results[i] = r1 != PASS ? r1 : r2;
+                        }
+                      });
+    auto counts = Counts{};
+    auto kept = std::size_t{};
+    for (auto i = 0u; i < reads1.size(); i++) {
+      tally(counts, results[i]);
+      if (results[i] == PASS) {
+        reads1[kept] = std::move(reads1[i]);
+        reads2[kept++] = std::move(reads2[i]);
+      }
+    }
+    reads1.resize(kept);
+    reads2.resize(kept);
+    return counts;
+  }
+
+  /**
+   * @brief Filter a single-end FASTQ stream, BATCH_SIZE reads at a time.
+   */
+  auto
+  filter(std::istream& is, std::ostream& os) const {
+    auto counts = Counts{};
+    auto batch = std::vector<FastqRecord<>>{};
+    for (;;) {
+      batch.clear();
+      for (auto read = FastqRecord<>{};
+           batch.size() < BATCH_SIZE && is >> read;)
+        batch.push_back(std::move(read));
+      if (batch.empty())
+        return counts;
+      counts += filter(batch);
+      for (const auto& read : batch) os << read << "\n";
+    }
+  }
+
+  /**
+   * @brief Filter a pair of FASTQ streams, BATCH_SIZE pairs at a time.
+   */
+  auto
+  filter(std::istream& is1, std::istream& is2, std::ostream& os1,
+         std::ostream& os2) const {
+    auto counts = Counts{};
+    auto batch1 = std::vector<FastqRecord<>>{};
+    auto batch2 = std::vector<FastqRecord<>>{};
+    for (;;) {
+      batch1.clear();
+      batch2.clear();
+      for (auto read = FastqRecord<>{};
+           batch1.size() < BATCH_SIZE && is1 >> read;)
+        batch1.push_back(std::move(read));
+      for (auto read = FastqRecord<>{};
+           batch2.size() < batch1.size() && is2 >> read;)
+        batch2.push_back(std::move(read));
+      if (batch1.empty())
+        return counts;
+      counts += filter(batch1, batch2);
+      for (const auto& read : batch1) os1 << read << "\n";
+      for (const auto& read : batch2) os2 << read << "\n";
+    }
+  }
+};
+
+}  // namespace biovoltron
@@ -4,7 +4,10 @@
  *  @defgroup file_io file_io
  */
 
+#include <biovoltron/file_io/bcf.hpp>
 #include <biovoltron/file_io/cigar.hpp>
 #include <biovoltron/file_io/fasta.hpp>
 #include <biovoltron/file_io/sam.hpp>
+#include <biovoltron/file_io/tabix.hpp>
 #include <biovoltron/file_io/vcf.hpp>
+#include <biovoltron/file_io/vcf_reader.hpp>
\ No newline at end of file
@@ -0,0 +1,560 @@
+#pragma once
+
+#include <biovoltron/file_io/vcf.hpp>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <htslib/hts.h>
+#include <htslib/kstring.h>
+#include <htslib/tbx.h>
+#include <htslib/vcf.h>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+namespace biovoltron {
+
+/**
+ * @brief Deleters of htslib handles.
+ */
+struct HtsDeleter {
+  auto
+  operator()(htsFile* file) const noexcept {
+    hts_close(file);
+  }
+
+  auto
+  operator()(bcf_hdr_t* header) const noexcept {
+    bcf_hdr_destroy(header);
+  }
+
+  auto
+  operator()(bcf1_t* record) const noexcept {
+    bcf_destroy(record);
+  }
+
+  auto
+  operator()(tbx_t* index) const noexcept {
+    tbx_destroy(index);
+  }
+
+  auto
+  operator()(hts_itr_t* iterator) const noexcept {
+    hts_itr_destroy(iterator);
+  }
+};
+
+/**
+ * @ingroup file_io
+ * @brief Reader of BCF, or of any VCF htslib can open, into VcfRecord.
+ *
+ * Records are decoded by htslib, with a pool of threads decompressing BGZF
+ * blocks. The fixed columns are read straight from the binary record, and
+ * get_info() and get_format() convert INFO and FORMAT values from the
+ * integers and floats BCF stores to the type asked for, so nothing is
+ * converted through strings. Only
+ * to_record() formats the INFO and sample columns as text, since VcfRecord
+ * holds them as strings.
+ *
+ * Example
+ * ```cpp
+ * #include <iostream>
+ * #include <biovoltron/file_io/bcf.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto reader = BcfReader{"cohort.bcf", 4};
+ *   while (reader.read())
+ *     if (reader.get_info<int>("DP").value_or(0) >= 10)
+ *       for (const auto& genotype : reader.get_format<std::string>("GT"))
+ *         std::cout << genotype.value_or(".") << "\n";
+ *
+ *   auto vcf = BcfReader{"cohort.bcf"};
+ *   for (auto record = VcfRecord{}; vcf.read(record);)
+ *     std::cout << record << "\n";
+ * }
+ * ```
+ */
+struct BcfReader {
+  /**
+   * @brief Header of the file, with its schema parsed.
+   */
+  VcfHeader header;
+
+ private:
+  std::unique_ptr<htsFile, HtsDeleter> file;
+  std::unique_ptr<bcf_hdr_t, HtsDeleter> hdr;
+  std::unique_ptr<bcf1_t, HtsDeleter> record{bcf_init()};
+  kstring_t text{0, 0, nullptr};
+
+  // Buffers htslib reallocates for the values of each call.
+  std::int32_t* ints = nullptr;
+  int n_ints = 0;
+  float* floats = nullptr;
+  int n_floats = 0;
+  char* chars = nullptr;
+  int n_chars = 0;
+
+  static auto
+  is_missing(std::int32_t value) {
+    return value == bcf_int32_missing;
+  }
+
+  static auto
+  is_missing(float value) {
+    return bcf_float_is_missing(value) != 0;
+  }
+
+  static auto
+  is_vector_end(std::int32_t value) {
+    return value == bcf_int32_vector_end;
+  }
+
+  static auto
+  is_vector_end(float value) {
+    return bcf_float_is_vector_end(value) != 0;
+  }
+
+  template<class T>
+  static auto
+  to_value(auto value) -> std::optional<T> {
+    if (is_missing(value) || is_vector_end(value))
+      return {};
+    return T(value);
+  }
+
+  /*
+   * Values of a sample, or of INFO, up to the first vector end, none if
+   * they are all missing.
+   */
+  template<class T>
+  static auto
+  to_values(const auto* values, int size) -> std::optional<T> {
+    using V = typename T::value_type;
+    auto converted = T{};
+    for (auto i = 0; i < size; i++) {
+      if (is_vector_end(values[i]))
+        break;
+      if (!is_missing(values[i]))
+        converted.push_back(V(values[i]));
+      else if constexpr (std::floating_point<V>)
+        converted.push_back(std::numeric_limits<V>::quiet_NaN());
+      else
+        converted.push_back(V(bcf_int32_missing));
+    }
+    if (converted.empty())
+      return {};
+    return converted;
+  }
+
+  /*
+   * Pass the INFO or FORMAT values of key to convert, as the ints or floats
+   * the header declares them, since htslib fails on any other type.
+   */
+  auto
+  fetch(std::string_view key, bool format, auto convert) {
+    const auto tag = std::string{key};
+    const auto get = format ? bcf_get_format_values : bcf_get_info_values;
+    const auto line = format ? BCF_HL_FMT : BCF_HL_INFO;
+    const auto id = bcf_hdr_id2int(hdr.get(), BCF_DT_ID, tag.c_str());
+    if (bcf_hdr_idinfo_exists(hdr.get(), line, id)
+        && bcf_hdr_id2type(hdr.get(), line, id) == BCF_HT_REAL) {
+      const auto size = get(hdr.get(), record.get(), tag.c_str(),
+                            reinterpret_cast<void**>(&floats), &n_floats,
+                            BCF_HT_REAL);
+      return convert(static_cast<const float*>(floats), size);
+    }
+    const auto size = get(hdr.get(), record.get(), tag.c_str(),
+                          reinterpret_cast<void**>(&ints), &n_ints,
+                          BCF_HT_INT);
+    return convert(static_cast<const std::int32_t*>(ints), size);
+  }
+
+  /*
+   * Genotypes formatted as in VCF, e.g. "0|1".
+   */
+  auto
+  genotypes() {
+    const auto samples = std::size_t(bcf_hdr_nsamples(hdr.get()));
+    auto result = std::vector<std::optional<std::string>>(samples);
+    const auto size
+      = bcf_get_genotypes(hdr.get(), record.get(), &ints, &n_ints);
+    if (size <= 0)
+      return result;
+    const auto ploidy = size / int(samples);
+    for (auto s = std::size_t{}; s < samples; s++) {
+      auto& genotype = result[s].emplace();
+      for (auto i = 0; i < ploidy; i++) {
+        const auto allele = ints[s * ploidy + i];
+        if (allele == bcf_int32_vector_end)
+          break;
+        if (i > 0)
+          genotype += bcf_gt_is_phased(allele) ? '|' : '/';
+        genotype += bcf_gt_is_missing(allele)
+                      ? "."
+                      : std::to_string(bcf_gt_allele(allele));
+      }
+    }
+    return result;
+  }
+
+ public:
+  /**
+   * @param path A BCF, VCF or bgzipped VCF file.
+   * @param threads Number of threads decompressing BGZF blocks.
+   */
+  explicit BcfReader(const std::filesystem::path& path, int threads = 1)
+  : file(hts_open(path.c_str(), "r")) {
+    if (!file)
+      throw std::runtime_error("BcfReader: cannot open " + path.string());
+    if (threads > 1)
+      hts_set_threads(file.get(), threads);
+    hdr.reset(bcf_hdr_read(file.get()));
+    if (!hdr)
+      throw std::runtime_error("BcfReader: " + path.string()
+                               + " has no VCF header");
+    text.l = 0;
+    bcf_hdr_format(hdr.get(), 0, &text);
+    auto lines = std::string_view{text.s, text.l};
+    while (!lines.empty()) {
+      const auto newline = std::min(lines.find('\n'), lines.size());
+      header.lines.emplace_back(lines.substr(0, newline));
+      lines.remove_prefix(std::min(newline + 1, lines.size()));
+    }
+    header.parse();
+  }
+
+  BcfReader(const BcfReader&) = delete;
+
+  ~BcfReader() {
+    std::free(text.s);
+    std::free(ints);
+    std::free(floats);
+    std::free(chars);
+  }
+
+  /**
+   * @brief Read the next record.
+   *
+   * @return false at the end of the file.
+   */
+  auto
+  read() {
+    const auto status = bcf_read(file.get(), hdr.get(), record.get());
+    if (status < -1)
+      throw std::runtime_error("BcfReader: corrupted record");
+    if (status == -1)
+      return false;
+    bcf_unpack(record.get(), BCF_UN_SHR);
+    return true;
+  }
+
+  auto
+  chrom() const -> std::string_view {
+    return bcf_hdr_id2name(hdr.get(), record->rid);
+  }
+
+  /**
+   * @brief 1-based POS, as in VcfRecord.
+   */
+  auto
+  pos() const {
+    return std::uint32_t(record->pos + 1);
+  }
+
+  auto
+  id() const -> std::string_view {
+    return record->d.id;
+  }
+
+  auto
+  ref() const -> std::string_view {
+    return record->d.allele[0];
+  }
+
+  /**
+   * @brief ALT alleles separated by commas, "." if there are none.
+   */
+  auto
+  alt() const {
+    if (record->n_allele < 2)
+      return std::string{"."};
+    auto alt = std::string{record->d.allele[1]};
+    for (auto i = 2u; i < record->n_allele; i++)
+      (alt += ',') += record->d.allele[i];
+    return alt;
+  }
+
+  /**
+   * @brief QUAL, NaN if it is missing.
+   */
+  auto
+  qual() const {
+    return bcf_float_is_missing(record->qual)
+             ? std::numeric_limits<double>::quiet_NaN()
+             : double(record->qual);
+  }
+
+  /**
+   * @brief Filters separated by semicolons, "." if there are none.
+   */
+  auto
+  filter() const {
+    if (record->d.n_flt == 0)
+      return std::string{"."};
+    auto filter = std::string{};
+    for (auto i = 0; i < record->d.n_flt; i++) {
+      if (i > 0)
+        filter += ';';
+      filter += bcf_hdr_int2id(hdr.get(), BCF_DT_ID, record->d.flt[i]);
+    }
+    return filter;
+  }
+
+  /**
+   * @brief Typed value of an INFO key, none if it is absent or missing.
+   *
+   * T is bool for a flag, std::string, std::string_view, an arithmetic type
+   * for the first value, or a std::vector of one for all of them. Numbers
+   * are read as the header declares them, Integer or Float, and converted
+   * to T. Missing items of a vector are NaN for floating point T, and
+   * bcf_int32_missing otherwise. A std::string_view points into a buffer of
+   * the reader, valid until the next string value is read or the reader is
+   * destroyed.
+   */
+  template<class T>
+    requires std::is_arithmetic_v<T> || std::same_as<T, std::string>
+             || std::same_as<T, std::string_view>
+             || (std::same_as<T, std::vector<typename T::value_type>>
+                 && std::is_arithmetic_v<typename T::value_type>)
+  auto
+  get_info(std::string_view key) -> std::optional<T> {
+    if constexpr (std::same_as<T, bool>) {
+      const auto tag = std::string{key};
+      if (bcf_get_info_flag(hdr.get(), record.get(), tag.c_str(), nullptr,
+                            nullptr)
+          == 1)
+        return true;
+      return {};
+    } else if constexpr (std::same_as<T, std::string>
+                         || std::same_as<T, std::string_view>) {
+      const auto tag = std::string{key};
+      const auto size = bcf_get_info_string(hdr.get(), record.get(),
+                                            tag.c_str(), &chars, &n_chars);
+      if (size < 0)
+        return {};
+      const auto value = std::string_view(chars, size);
+      return T{value.substr(0, value.find('\0'))};
+    } else if constexpr (requires { typename T::value_type; }) {
+      return fetch(key, false,
+                   [](const auto* values, int size) -> std::optional<T> {
+                     if (size <= 0)
+                       return {};
+                     return to_values<T>(values, size);
+                   });
+    } else {
+      return fetch(key, false,
+                   [](const auto* values, int size) -> std::optional<T> {
+                     if (size <= 0)
+                       return {};
+                     return to_value<T>(values[0]);
+                   });
+    }
+  }
+
+  /**
+   * @brief Typed values of a FORMAT key, one for each sample, none for the
+   * samples missing it.
+   *
+   * T is an arithmetic type for the first value of each sample, a
+   * std::vector of one for all of them, or std::string, which gives GT
+   * formatted as in VCF, e.g. "0|1". Unlike VcfRecord::get_format(), T
+   * cannot be std::string_view, as the strings are decoded for each call.
+   */
+  template<class T>
+    requires std::is_arithmetic_v<T> || std::same_as<T, std::string>
+             || (std::same_as<T, std::vector<typename T::value_type>>
+                 && std::is_arithmetic_v<typename T::value_type>)
+  auto
+  get_format(std::string_view key) {
+    const auto samples = std::size_t(bcf_hdr_nsamples(hdr.get()));
+    if constexpr (std::same_as<T, std::string>) {
+      if (key == "GT")
+        return genotypes();
+      auto result = std::vector<std::optional<T>>(samples);
+      auto strings = static_cast<char**>(nullptr);
+      auto size = 0;
+      const auto tag = std::string{key};
+      if (bcf_get_format_string(hdr.get(), record.get(), tag.c_str(),
+                                &strings, &size)
+          > 0) {
+        for (auto s = std::size_t{}; s < samples; s++)
+          if (std::string_view{strings[s]} != ".")
+            result[s] = strings[s];
+        std::free(strings[0]);
+      }
+      std::free(strings);
+      return result;
+    } else {
+      return fetch(key, true, [samples](const auto* values, int size) {
+        auto result = std::vector<std::optional<T>>(samples);
+        if (size <= 0)
+          return result;
+        const auto per_sample = size / int(samples);
+        for (auto s = std::size_t{}; s < samples; s++)
+          if constexpr (requires { typename T::value_type; })
+            result[s] = to_values<T>(values + s * per_sample, per_sample);
+          else
+            result[s] = to_value<T>(values[s * per_sample]);
+        return result;
+      });
+    }
+  }
+
+  /**
+   * @brief Copy the record out. INFO and the samples are formatted as text.
+   */
+  auto
+  to_record() {
+    auto vcf = VcfRecord{};
+    vcf.header = &header;
+    vcf.chrom = chrom();
+    vcf.pos = pos();
+    vcf.id = id();
+    vcf.ref = ref();
+    vcf.alt = alt();
+    vcf.qual = qual();
+    vcf.filter = filter();
+    text.l = 0;
+    vcf_format(hdr.get(), record.get(), &text);
+    auto line = std::string_view{text.s, text.l};
+    if (line.ends_with('\n'))
+      line.remove_suffix(1);
+    for (auto i = 0; i < 7; i++)
+      line.remove_prefix(std::min(line.find('\t') + 1, line.size()));
+    const auto column = [&line] {
+      const auto tab = std::min(line.find('\t'), line.size());
+      const auto value = line.substr(0, tab);
+      line.remove_prefix(std::min(tab + 1, line.size()));
+      return std::string{value};
+    };
+    vcf.info = column();
+    vcf.format = column();
+    while (!line.empty()) vcf.samples.push_back(column());
+    return vcf;
+  }
+
+  /**
+   * @brief Read the next record into a VcfRecord.
+   *
+   * @return false at the end of the file.
+   */
+  auto
+  read(VcfRecord& vcf) {
+    if (!read())
+      return false;
+    vcf = to_record();
+    return true;
+  }
+};
+
+/**
+ * @ingroup file_io
+ * @brief Writer of VcfRecord as BCF, or as VCF, through htslib.
+ *
+ * The header is written when the writer is constructed. Each record is
+ * encoded by htslib from its text, and BGZF blocks are compressed by a pool
+ * of threads.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <biovoltron/file_io/bcf.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto fin = std::ifstream{"cohort.vcf"};
+ *   auto header = VcfHeader{};
+ *   fin >> header;
+ *   auto writer = BcfWriter{"cohort.bcf", header, 4};
+ *   for (auto record = VcfRecord{}; fin >> record;) writer.write(record);
+ * }
+ * ```
+ */
+struct BcfWriter {
+ private:
+  std::unique_ptr<htsFile, HtsDeleter> file;
+  std::unique_ptr<bcf_hdr_t, HtsDeleter> hdr{bcf_hdr_init("r")};
+  std::unique_ptr<bcf1_t, HtsDeleter> record{bcf_init()};
+  kstring_t text{0, 0, nullptr};
+
+ public:
+  /**
+   * @param path File to write.
+   * @param header Header of the records, with a `#CHROM` line naming the
+   * samples.
+   * @param threads Number of threads compressing BGZF blocks.
+   * @param mode htslib mode, "wb" for BCF, "wz" for bgzipped VCF.
+   */
+  BcfWriter(const std::filesystem::path& path, const VcfHeader& header,
+            int threads = 1, const char* mode = "wb")
+  : file(hts_open(path.c_str(), mode)) {
+    if (!file)
+      throw std::runtime_error("BcfWriter: cannot open " + path.string());
+    if (threads > 1)
+      hts_set_threads(file.get(), threads);
+    auto lines = std::string{};
+    if (header.lines.empty()
+        || !header.lines.front().starts_with("##fileformat"))
+      lines += "##fileformat=VCFv4.2\n";
+    for (const auto& line : header.lines) (lines += line) += '\n';
+    if (header.lines.empty() || !header.lines.back().starts_with("#CHROM"))
+      lines += "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n";
+    if (bcf_hdr_parse(hdr.get(), lines.data()) < 0
+        || bcf_hdr_write(file.get(), hdr.get()) < 0)
+      throw std::runtime_error("BcfWriter: cannot write the header of "
+                               + path.string());
+  }
+
+  BcfWriter(const BcfWriter&) = delete;
+
+  ~BcfWriter() {
+    std::free(text.s);
+  }
+
+  /**
+   * @brief Encode and write a record. Contigs, filters and fields not in the
+   * header are added to it by htslib with a warning.
+   */
+  auto
+  write(const VcfRecord& vcf) {
+    auto line = std::ostringstream{};
+    line << vcf.chrom << '\t' << vcf.pos << '\t' << vcf.id << '\t' << vcf.ref
+         << '\t' << vcf.alt << '\t';
+    if (std::isnan(vcf.qual))
+      line << '.';
+    else {
+      // The shortest text which reads back as the same double.
+      char qual[32];
+      const auto end = std::to_chars(qual, qual + sizeof qual, vcf.qual).ptr;
+      line.write(qual, end - qual);
+    }
+    line << '\t' << vcf.filter << '\t' << vcf.info;
+    if (!vcf.format.empty()) {
+      line << '\t' << vcf.format;
+      for (const auto& sample : vcf.samples) line << '\t' << sample;
+    }
+    const auto str = line.str();
+    text.l = 0;
+    kputsn(str.data(), str.size(), &text);
+    if (vcf_parse(&text, hdr.get(), record.get()) < 0
+        || bcf_write(file.get(), hdr.get(), record.get()) < 0)
+      throw std::runtime_error("BcfWriter: cannot write record at "
+                               + vcf.chrom + ":" + std::to_string(vcf.pos));
+  }
+};
+
+}  // namespace biovoltron
@@ -1,9 +1,17 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <istream>
+#include <iterator>
+#include <memory>
 #include <ostream>
 #include <ranges>
+#include <string>
+#include <string_view>
+#include <utility>
 
 namespace biovoltron {
 
@@ -11,6 +19,26 @@ namespace biovoltron {
  * @ingroup file_io
  * @brief A format to represent an alignment of a sequence to a reference genome
  * by encoding a sequence of events.
+ *
+ * Elements are stored packed as in BAM, `size << 4 | op` in 32 bits with op
+ * indexing "MIDNSHP=X", and the first INLINE_SIZE of them are kept in `this`,
+ * so usual cigars such as `100M` or `50M2I48M` need no allocation. Elements
+ * are thus read by value: iterators yield Cigar::Element, and the mutable
+ * front(), back() and operator[] return a Cigar::Reference which converts to
+ * and is assigned from Cigar::Element.
+ *
+ * Code written against the former `std::vector<Element>` storage migrates
+ * as follows, since no Element lives in memory to point to:
+ * - `cigar[i].size` and `cigar[i].op` become `cigar[i].size()` and
+ *   `cigar[i].op()` on a mutable cigar; a const one still returns Element.
+ * - `cigar[i].op = 'S'` becomes `cigar[i].set_op('S')`, and likewise
+ *   set_size(), or assigning a whole Element.
+ * - `&cigar[0]` and `for (auto& element : cigar)` have no equivalent; use
+ *   data() for the packed elements, and `for (auto element : cigar)`.
+ *
+ * The reference, read and clip sizes are kept up to date as elements change,
+ * through a table of the residues each operation consumes, so ref_size(),
+ * read_size() and clip_size() cost nothing, e.g. in SamRecord::end().
  */
 struct Cigar {
   /**
@@ -69,18 +97,281 @@ struct Cigar {
       = default;
   };
 
+  /**
+   * @brief Operations in the order of their BAM codes. Unknown operations are
+   * stored with code 15 and read back as '?'.
+   */
+  constexpr static auto OPS = std::string_view{"MIDNSHP=X"};
+
+  /**
+   * @brief Number of elements stored without allocation.
+   */
+  constexpr static auto INLINE_SIZE = 6u;
+
+  /**
+   * @brief Pack an element as in BAM.
+   */
+  constexpr static auto
+  pack(Element element) noexcept {
+    return std::uint32_t{element.size << 4 | op_codes[element.op & 0x7f]};
+  }
+
+  /**
+   * @brief Unpack an element packed by pack().
+   */
+  constexpr static auto
+  unpack(std::uint32_t packed) noexcept {
+    const auto code = packed & 0xf;
+    return Element{packed >> 4, code < OPS.size() ? OPS[code] : '?'};
+  }
+
+  /**
+   * @brief Whether an operation consumes reference residues, i.e. it is `M`,
+   * `D`, `N`, `=` or `X`.
+   */
+  constexpr static auto
+  consumes_ref(char op) noexcept {
+    return bool(op_types[op_codes[op & 0x7f]] & REF);
+  }
+
+  /**
+   * @brief Whether an operation consumes read residues, i.e. it is `M`, `I`,
+   * `S`, `=` or `X`.
+   */
+  constexpr static auto
+  consumes_read(char op) noexcept {
+    return bool(op_types[op_codes[op & 0x7f]] & READ);
+  }
+
+  /**
+   * @brief Mutable access to an element, which is packed when assigned.
+   */
+  class Reference {
+    Cigar& cigar;
+    std::uint32_t& packed;
+
+   public:
+    Reference(Cigar& cigar, std::uint32_t& packed) noexcept
+    : cigar(cigar), packed(packed) { }
+
+    operator Element() const noexcept { return unpack(packed); }
+
+    operator std::string() const { return unpack(packed); }
+
+    /**
+     * @brief Size of the element.
+     */
+    auto
+    size() const noexcept {
+      return unpack(packed).size;
+    }
+
+    /**
+     * @brief Operation of the element.
+     */
+    auto
+    op() const noexcept {
+      return unpack(packed).op;
+    }
+
+    auto&
+    operator=(Element element) noexcept {
+      cigar.account(packed, -1);
+      packed = pack(element);
+      cigar.account(packed, 1);
+      return *this;
+    }
+
+    auto&
+    operator=(const Reference& other) noexcept {
+      return *this = Element(other);
+    }
+
+    /**
+     * @brief Replace the size of the element, keeping its operation.
+     */
+    auto&
+    set_size(unsigned size) noexcept {
+      return *this = Element{size, op()};
+    }
+
+    /**
+     * @brief Replace the operation of the element, keeping its size.
+     */
+    auto&
+    set_op(char op) noexcept {
+      return *this = Element{size(), op};
+    }
+  };
+
+  /**
+   * @brief Random access iterator over elements, yielding Cigar::Element by
+   * value.
+   */
+  class Iterator {
+    const std::uint32_t* ptr{};
+
+   public:
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Element;
+    using difference_type = std::ptrdiff_t;
+    using reference = Element;
+
+    Iterator() = default;
+
+    explicit Iterator(const std::uint32_t* ptr) noexcept : ptr(ptr) { }
+
+    auto
+    operator*() const noexcept {
+      return unpack(*ptr);
+    }
+
+    auto
+    operator[](difference_type n) const noexcept {
+      return unpack(ptr[n]);
+    }
+
+    auto&
+    operator++() noexcept {
+      ++ptr;
+      return *this;
+    }
+
+    auto
+    operator++(int) noexcept {
+      return Iterator{ptr++};
+    }
+
+    auto&
+    operator--() noexcept {
+      --ptr;
+      return *this;
+    }
+
+    auto
+    operator--(int) noexcept {
+      return Iterator{ptr--};
+    }
+
+    auto&
+    operator+=(difference_type n) noexcept {
+      ptr += n;
+      return *this;
+    }
+
+    auto&
+    operator-=(difference_type n) noexcept {
+      ptr -= n;
+      return *this;
+    }
+
+    friend auto
+    operator+(Iterator it, difference_type n) noexcept {
+      return it += n;
+    }
+
+    friend auto
+    operator+(difference_type n, Iterator it) noexcept {
+      return it += n;
+    }
+
+    friend auto
+    operator-(Iterator it, difference_type n) noexcept {
+      return it -= n;
+    }
+
+    friend auto
+    operator-(Iterator a, Iterator b) noexcept {
+      return a.ptr - b.ptr;
+    }
+
+    auto
+    operator<=>(const Iterator&) const noexcept = default;
+  };
+
  private:
-  std::vector<Element> elements;
-  static auto
-  to_elements(std::string_view cigar_string) {
-    auto elements = std::vector<Element>{};
-    for (auto i = 0u; i < cigar_string.size(); i++) {
-      auto size = cigar_string[i] - '0';
-      for (i++; std::isdigit(cigar_string[i]); i++)
-        size = size * 10 + cigar_string[i] - '0';
-      elements.emplace_back(size, cigar_string[i]);
+  constexpr static auto op_codes = [] {
+    auto codes = std::array<std::uint8_t, 128>{};
+    codes.fill(15);
+    for (auto i = 0u; i < OPS.size(); i++) codes[OPS[i]] = i;
+    return codes;
+  }();
+
+  enum : std::uint8_t { REF = 1, READ = 2, CLIP = 4 };
+
+  /*
+   * Residues consumed by each operation code, as in bam_cigar_type().
+   */
+  constexpr static auto op_types = std::array<std::uint8_t, 16>{
+    REF | READ, READ, REF, REF, READ | CLIP, CLIP, 0, REF | READ, REF | READ};
+
+  std::uint32_t count{};
+  std::uint32_t capacity = INLINE_SIZE;
+  std::array<std::uint32_t, INLINE_SIZE> local{};
+  std::unique_ptr<std::uint32_t[]> heap;
+  std::uint32_t ref_length{};
+  std::uint32_t read_length{};
+  std::uint32_t clip_length{};
+
+  /*
+   * Add the sizes of an element to, or with sign -1 remove them from, the
+   * cached sizes.
+   */
+  void
+  account(std::uint32_t packed, int sign) noexcept {
+    const auto size = sign * (packed >> 4);
+    const auto type = op_types[packed & 0xf];
+    ref_length += size * (type & REF);
+    read_length += size * (type >> 1 & 1);
+    clip_length += size * (type >> 2 & 1);
+  }
+
+  auto
+  elements() noexcept {
+    return heap ? heap.get() : local.data();
+  }
+
+  auto
+  reserve(std::uint32_t size) {
+    if (size <= capacity)
+      return;
+    capacity = std::max(size, capacity * 2);
+    auto buffer = std::make_unique_for_overwrite<std::uint32_t[]>(capacity);
+    std::copy_n(elements(), count, buffer.get());
+    heap = std::move(buffer);
+  }
+
+  auto
+  assign(const Cigar& other) {
+    count = 0;
+    reserve(other.count);
+    std::copy_n(other.data(), other.count, elements());
+    count = other.count;
+    ref_length = other.ref_length;
+    read_length = other.read_length;
+    clip_length = other.clip_length;
+  }
+
+  auto
+  parse(std::string_view cigar_string) {
+    count = ref_length = read_length = clip_length = 0;
+    if (cigar_string == "*")
+      return;
+    auto p = cigar_string.data();
+    const auto end = p + cigar_string.size();
+    while (p != end) {
+      auto size = 0u;
+      for (auto digit = 0u; p != end && (digit = *p - '0') < 10; p++)
+        size = size * 10 + digit;
+      if (p == end)
+        return;
+      if (count == capacity)
+        reserve(count + 1);
+      const auto packed = size << 4 | op_codes[*p++ & 0x7f];
+      elements()[count++] = packed;
+      account(packed, 1);
     }
-    return elements;
   }
 
  public:
@@ -89,13 +380,39 @@ struct Cigar {
    */
   Cigar() = default;
 
+  Cigar(const Cigar& other) { assign(other); }
+
+  Cigar(Cigar&& other) noexcept { *this = std::move(other); }
+
+  auto&
+  operator=(const Cigar& other) {
+    if (this != &other)
+      assign(other);
+    return *this;
+  }
+
+  auto
+  operator=(Cigar&& other) noexcept -> Cigar& {
+    if (this == &other)
+      return *this;
+    count = std::exchange(other.count, 0);
+    capacity = std::exchange(other.capacity, INLINE_SIZE);
+    local = other.local;
+    heap = std::move(other.heap);
+    ref_length = std::exchange(other.ref_length, 0);
+    read_length = std::exchange(other.read_length, 0);
+    clip_length = std::exchange(other.clip_length, 0);
+    return *this;
+  }
+
   /**
    * @brief Construct `this` from type convertible into *string_view*.
    *
    * @param cigar_string cigar string with type convertible into *string_view*
    */
-  Cigar(std::convertible_to<std::string_view> auto const& cigar_string)
-  : elements(to_elements(cigar_string)) { }
+  Cigar(std::convertible_to<std::string_view> auto const& cigar_string) {
+    parse(cigar_string);
+  }
 
   /**
    * @brief Overload assignent operator to build up Cigar::Element from type
@@ -106,31 +423,35 @@ struct Cigar {
    */
   auto&
   operator=(std::convertible_to<std::string_view> auto const& cigar_string) {
-    elements = to_elements(cigar_string);
+    parse(cigar_string);
     return *this;
   }
 
+  /**
+   * @brief Elements packed as in BAM, see pack().
+   */
+  auto
+  data() const noexcept -> const std::uint32_t* {
+    return heap ? heap.get() : local.data();
+  }
+
   /**
    * @brief Merge every continuous elements with identical Element::op into a
    * single element.
    */
   auto
   compact() {
-    if (elements.size() <= 1)
+    if (count <= 1)
       return;
-    auto res = std::vector<Element>{};
-    auto [last_size, last_op] = elements.front();
-    for (const auto [cur_size, cur_op] : elements | std::views::drop(1)) {
-      if (cur_op == last_op)
-        last_size += cur_size;
-      else {
-        res.emplace_back(last_size, last_op);
-        last_size = cur_size;
-        last_op = cur_op;
-      }
+    const auto packed = elements();
+    auto last = 0u;
+    for (auto i = 1u; i < count; i++) {
+      if ((packed[i] & 0xf) == (packed[last] & 0xf))
+        packed[last] += packed[i] & ~0xfu;
+      else
+        packed[++last] = packed[i];
     }
-    res.emplace_back(last_size, last_op);
-    elements.swap(res);
+    count = last + 1;
   }
 
   /**
@@ -138,7 +459,9 @@ struct Cigar {
    */
   auto
   emplace_back(unsigned size, char op) {
-    elements.emplace_back(size, op);
+    reserve(count + 1);
+    elements()[count++] = pack({size, op});
+    account(pack({size, op}), 1);
   }
 
   /**
@@ -146,7 +469,9 @@ struct Cigar {
    */
   auto
   push_back(Element element) {
-    elements.push_back(element);
+    reserve(count + 1);
+    elements()[count++] = pack(element);
+    account(pack(element), 1);
   }
 
   /**
@@ -154,7 +479,13 @@ struct Cigar {
    */
   auto
   append(const Cigar& other) {
-    for (const auto element : other.elements) elements.push_back(element);
+    const auto size = other.count;
+    reserve(count + size);
+    std::copy_n(other.data(), size, elements() + count);
+    count += size;
+    ref_length += other.ref_length;
+    read_length += other.read_length;
+    clip_length += other.clip_length;
   }
 
   /**
@@ -162,7 +493,7 @@ struct Cigar {
    */
   auto
   swap(Cigar& other) {
-    elements.swap(other.elements);
+    std::swap(*this, other);
   }
 
   /**
@@ -174,21 +505,7 @@ struct Cigar {
    */
   auto
   ref_size() const noexcept {
-    auto ref_size = 0;
-    for (auto [size, op] : elements) {
-      switch (op) {
-        case 'M':
-        case 'D':
-        case 'N':
-        case '=':
-        case 'X':
-          ref_size += size;
-          break;
-        default:
-          break;
-      }
-    }
-    return ref_size;
+    return int(ref_length);
   }
 
   /**
@@ -200,21 +517,7 @@ struct Cigar {
    */
   auto
   read_size() const noexcept {
-    auto read_size = 0;
-    for (auto [size, op] : elements) {
-      switch (op) {
-        case 'M':
-        case 'I':
-        case 'S':
-        case '=':
-        case 'X':
-          read_size += size;
-          break;
-        default:
-          break;
-      }
-    }
-    return read_size;
+    return int(read_length);
   }
 
   /**
@@ -226,18 +529,7 @@ struct Cigar {
    */
   auto
   clip_size() const noexcept {
-    auto clip_size = 0;
-    for (auto [size, op] : elements) {
-      switch (op) {
-        case 'S':
-        case 'H':
-          clip_size += size;
-          break;
-        default:
-          break;
-      }
-    }
-    return clip_size;
+    return int(clip_length);
   }
 
   /**
@@ -246,18 +538,8 @@ struct Cigar {
    * @return the *iterator* pointing to the first element of elements
    */
   auto
-  begin() {
-    return elements.begin();
-  }
-
-  /**
-   * @brief Get the first element of elements.
-   *
-   * @return the *const iterator* pointing to the first element of elements
-   */
-  auto
-  begin() const {
-    return elements.begin();
+  begin() const noexcept -> Iterator {
+    return Iterator{data()};
   }
 
   /**
@@ -266,18 +548,8 @@ struct Cigar {
    * @return the *iterator* pointing to the last element of elements
    */
   auto
-  end() {
-    return elements.end();
-  }
-
-  /**
-   * @brief Get the last element of elements.
-   *
-   * @return the *const iterator* pointing to the last element of elements
-   */
-  auto
-  end() const {
-    return elements.end();
+  end() const noexcept -> Iterator {
+    return Iterator{data() + count};
   }
 
   /**
@@ -285,19 +557,19 @@ struct Cigar {
    *
    * @return the *reference* to the first element of elements
    */
-  auto&
+  auto
   front() {
-    return elements.front();
+    return Reference{*this, elements()[0]};
   }
 
   /**
    * @brief Get the first element of elements.
    *
-   * @return the *const reference* to the first element of elements
+   * @return the first element of elements
    */
-  auto&
+  auto
   front() const {
-    return elements.front();
+    return unpack(data()[0]);
   }
 
   /**
@@ -305,19 +577,19 @@ struct Cigar {
    *
    * @return the *reference* to the last element of elements
    */
-  auto&
+  auto
   back() {
-    return elements.back();
+    return Reference{*this, elements()[count - 1]};
   }
 
   /**
    * @brief Get the last element of elements.
    *
-   * @return the *const reference* to the last element of elements
+   * @return the last element of elements
    */
-  auto&
+  auto
   back() const {
-    return elements.back();
+    return unpack(data()[count - 1]);
   }
 
   /**
@@ -326,20 +598,20 @@ struct Cigar {
    * @param i index of the accessed
    * @return the *reference* to the ith element of elements
    */
-  auto&
+  auto
   operator[](unsigned i) {
-    return elements[i];
+    return Reference{*this, elements()[i]};
   }
 
   /**
    * @brief Overload subscript operator to access the ith element of elements.
    *
    * @param i the index of the accessed
-   * @return the *const reference* to the ith element of elements
+   * @return the ith element of elements
    */
-  auto&
+  auto
   operator[](unsigned i) const {
-    return elements[i];
+    return unpack(data()[i]);
   }
 
   /**
@@ -349,7 +621,7 @@ struct Cigar {
    */
   operator std::string() const {
     auto cigar_string = std::string{};
-    for (const auto element : elements) cigar_string += element;
+    for (const auto element : *this) cigar_string += element;
     return cigar_string;
   }
 
@@ -358,7 +630,8 @@ struct Cigar {
    */
   auto
   pop_front() {
-    elements.erase(elements.begin());
+    account(elements()[0], -1);
+    std::copy_n(elements() + 1, --count, elements());
   }
 
   /**
@@ -366,7 +639,7 @@ struct Cigar {
    */
   auto
   pop_back() {
-    elements.pop_back();
+    account(elements()[--count], -1);
   }
 
   /**
@@ -374,7 +647,7 @@ struct Cigar {
    */
   auto
   reverse() {
-    std::ranges::reverse(elements);
+    std::reverse(elements(), elements() + count);
   }
 
   /**
@@ -385,10 +658,9 @@ struct Cigar {
    */
   auto
   contains(char key) const noexcept {
-    for (auto [size, op] : elements)
-      if (key == op)
-        return true;
-    return false;
+    const auto code = op_codes[key & 0x7f];
+    return std::any_of(data(), data() + count,
+                       [code](auto packed) { return (packed & 0xf) == code; });
   }
 
   /**
@@ -399,10 +671,9 @@ struct Cigar {
    */
   auto
   contains(std::string_view keys) const noexcept {
-    for (auto [size, op] : elements)
-      for (auto key : keys)
-        if (key == op)
-          return true;
+    for (auto key : keys)
+      if (contains(key))
+        return true;
     return false;
   }
 
@@ -413,12 +684,12 @@ struct Cigar {
    */
   auto
   size() const noexcept {
-    return elements.size();
+    return std::size_t{count};
   }
 
   auto
   clear() noexcept {
-    elements.clear();
+    count = ref_length = read_length = clip_length = 0;
   }
 
   /**
@@ -429,8 +700,10 @@ struct Cigar {
    * @return true if the two Cigar are the same, false otherwise
    */
   auto
-  operator==(const Cigar&) const noexcept -> bool
-    = default;
+  operator==(const Cigar& other) const noexcept -> bool {
+    return std::equal(data(), data() + count, other.data(),
+                      other.data() + other.count);
+  }
 
   /**
    * @brief Overload << operator to write the size and the op of each element in
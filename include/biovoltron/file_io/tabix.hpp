@@ -0,0 +1,305 @@
+#pragma once
+
+#include <biovoltron/file_io/bcf.hpp>
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+namespace biovoltron {
+
+/**
+ * @ingroup file_io
+ * @brief Region queries on a bgzipped VCF with a tabix (`.tbi`) or CSI
+ * (`.csi`) index, returning lazy ranges of VcfRecord.
+ *
+ * Only the BGZF blocks the index lists for a region are decompressed, so
+ * jobs touching a small part of the genome do not read the whole file.
+ * A query of many regions, e.g. all the exons of a BED file, sorts them in
+ * the order of the contigs of the index and merges the regions closer than
+ * MERGE_DISTANCE into one index query, so chunks shared by neighbouring
+ * regions are read once. Each record is reported once, in file order, if it
+ * overlaps a region, where a record spans its REF allele, or up to its INFO
+ * END, as in the conversion of VcfRecord to Interval and in tabix. Strands of
+ * regions are ignored.
+ *
+ * The ranges share the file of the reader, so only one of them can be
+ * iterated at a time.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/file_io/tabix.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto reader = TabixReader{"cohort.vcf.gz"};
+ *   for (const auto& record : reader.query(Interval{"chr1:3044000-3046000"}))
+ *     std::cout << record << "\n";
+ *
+ *   auto exons = std::vector<Interval>{};
+ *   auto bed = std::ifstream{"exons.bed"};
+ *   auto chrom = std::string{};
+ *   auto begin = std::uint32_t{}, end = std::uint32_t{};
+ *   for (auto line = std::string{}; bed >> chrom >> begin >> end;
+ *        std::getline(bed, line))
+ *     exons.emplace_back(chrom, begin, end);
+ *   for (const auto& record : reader.query(exons))
+ *     std::cout << record << "\n";
+ * }
+ * ```
+ */
+struct TabixReader {
+  /**
+   * @brief Maximum distance between regions queried together.
+   */
+  std::uint32_t MERGE_DISTANCE = 1 << 14;
+
+  /**
+   * @brief Header of the file, with its schema parsed.
+   */
+  VcfHeader header;
+
+ private:
+  std::unique_ptr<htsFile, HtsDeleter> file;
+  std::unique_ptr<tbx_t, HtsDeleter> index;
+
+  /*
+   * Parse a line into a record, reusing its strings.
+   */
+  auto
+  parse(std::string_view line, VcfRecord& record) {
+    const auto column = [&line] {
+      const auto tab = std::min(line.find('\t'), line.size());
+      const auto value = line.substr(0, tab);
+      line.remove_prefix(std::min(tab + 1, line.size()));
+      return value;
+    };
+    const auto number = [](std::string_view value, auto& number) {
+      std::from_chars(value.data(), value.data() + value.size(), number);
+    };
+    record.header = &header;
+    record.chrom = column();
+    record.pos = 0;
+    number(column(), record.pos);
+    record.id = column();
+    record.ref = column();
+    record.alt = column();
+    record.qual = std::numeric_limits<double>::quiet_NaN();
+    number(column(), record.qual);
+    record.filter = column();
+    record.info = column();
+    record.format = column();
+    record.samples.clear();
+    while (!line.empty()) record.samples.emplace_back(column());
+  }
+
+ public:
+  /**
+   * @brief Regions on one contig queried with one index query.
+   */
+  struct Chunk {
+    int tid{};
+    std::uint32_t begin{};
+    std::uint32_t end{};
+    std::vector<Interval> regions;
+  };
+
+  /**
+   * @brief Lazy input range of the records overlapping regions.
+   */
+  struct Query {
+    TabixReader* reader = nullptr;
+    std::vector<Chunk> chunks;
+
+   private:
+    std::size_t chunk{};
+    std::unique_ptr<hts_itr_t, HtsDeleter> iterator;
+    kstring_t text{0, 0, nullptr};
+    VcfRecord record;
+
+    auto
+    overlaps(const Chunk& chunk, const Interval& interval) const {
+      return std::ranges::any_of(chunk.regions, [&](const auto& region) {
+        return region.begin < interval.end && interval.begin < region.end;
+      });
+    }
+
+    /*
+     * Whether a record was reported with an earlier chunk, which it may
+     * overlap however long it is. Chunks of a contig are disjoint and
+     * sorted, so only those ending after the record begins are checked.
+     */
+    auto
+    reported(const Interval& interval) const {
+      for (auto i = chunk; i-- > 0 && chunks[i].tid == chunks[chunk].tid
+                           && chunks[i].end > interval.begin;)
+        if (overlaps(chunks[i], interval))
+          return true;
+      return false;
+    }
+
+   public:
+    Query() = default;
+
+    Query(TabixReader& reader, std::vector<Chunk> chunks)
+    : reader(&reader), chunks(std::move(chunks)) { }
+
+    Query(Query&& other) noexcept
+    : reader(other.reader),
+      chunks(std::move(other.chunks)),
+      chunk(other.chunk),
+      iterator(std::move(other.iterator)),
+      text(std::exchange(other.text, {0, 0, nullptr})),
+      record(std::move(other.record)) { }
+
+    ~Query() {
+      std::free(text.s);
+    }
+
+    /**
+     * @brief Move to the next record overlapping a region.
+     *
+     * @return false when there are no more.
+     */
+    auto
+    next() -> bool {
+      while (chunk < chunks.size()) {
+        const auto& current = chunks[chunk];
+        if (!iterator) {
+          iterator.reset(tbx_itr_queryi(reader->index.get(), current.tid,
+                                        current.begin, current.end));
+          if (!iterator) {
+            chunk++;
+            continue;
+          }
+        }
+        const auto status = tbx_itr_next(reader->file.get(),
+                                         reader->index.get(), iterator.get(),
+                                         &text);
+        if (status < -1)
+          throw std::runtime_error("TabixReader: corrupted record");
+        if (status == -1) {
+          iterator.reset();
+          chunk++;
+          continue;
+        }
+        reader->parse({text.s, text.l}, record);
+        const auto interval = Interval{record};
+        if (overlaps(current, interval) && !reported(interval))
+          return true;
+      }
+      return false;
+    }
+
+    struct Iterator {
+      using value_type = VcfRecord;
+      using difference_type = std::ptrdiff_t;
+
+      Query* query = nullptr;
+
+      auto
+      operator*() const -> const VcfRecord& {
+        return query->record;
+      }
+
+      auto
+      operator->() const {
+        return &query->record;
+      }
+
+      auto&
+      operator++() {
+        if (!query->next())
+          query = nullptr;
+        return *this;
+      }
+
+      auto
+      operator++(int) {
+        ++*this;
+      }
+
+      auto
+      operator==(std::default_sentinel_t) const noexcept {
+        return query == nullptr;
+      }
+    };
+
+    /**
+     * @brief Read the first record. A query can only be iterated once.
+     */
+    auto
+    begin() {
+      return ++Iterator{this};
+    }
+
+    auto
+    end() const noexcept {
+      return std::default_sentinel;
+    }
+  };
+
+  /**
+   * @param path A bgzipped VCF, indexed with `tabix` or `bcftools index`.
+   * @param threads Number of threads decompressing BGZF blocks.
+   */
+  explicit TabixReader(const std::filesystem::path& path, int threads = 1)
+  : file(hts_open(path.c_str(), "r")), index(tbx_index_load(path.c_str())) {
+    if (!file)
+      throw std::runtime_error("TabixReader: cannot open " + path.string());
+    if (!index)
+      throw std::runtime_error("TabixReader: " + path.string()
+                               + " has no tabix or CSI index");
+    if (threads > 1)
+      hts_set_threads(file.get(), threads);
+    auto text = kstring_t{0, 0, nullptr};
+    while (hts_getline(file.get(), KS_SEP_LINE, &text) >= 0
+           && text.l > 0 && text.s[0] == '#')
+      header.lines.emplace_back(text.s, text.l);
+    std::free(text.s);
+    header.parse();
+  }
+
+  TabixReader(const TabixReader&) = delete;
+
+  /**
+   * @brief Records overlapping regions, in file order.
+   */
+  auto
+  query(std::vector<Interval> regions) {
+    auto tids = std::vector<std::pair<int, Interval>>{};
+    for (auto& region : regions)
+      if (const auto tid = tbx_name2id(index.get(), region.chrom.c_str());
+          tid >= 0 && !region.empty()) {
+        region.strand = '+';
+        tids.emplace_back(tid, std::move(region));
+      }
+    std::ranges::sort(tids, [](const auto& a, const auto& b) {
+      return std::tie(a.first, a.second.begin, a.second.end)
+             < std::tie(b.first, b.second.begin, b.second.end);
+    });
+    auto chunks = std::vector<Chunk>{};
+    for (auto& [tid, region] : tids) {
+      if (chunks.empty() || chunks.back().tid != tid
+          || std::uint64_t{chunks.back().end} + MERGE_DISTANCE < region.begin)
+        chunks.push_back({tid, region.begin, region.end});
+      auto& chunk = chunks.back();
+      chunk.end = std::max(chunk.end, region.end);
+      chunk.regions.push_back(std::move(region));
+    }
+    return Query{*this, std::move(chunks)};
+  }
+
+  /**
+   * @brief Records overlapping a region, in file order.
+   */
+  auto
+  query(const Interval& region) {
+    return query(std::vector{region});
+  }
+};
+
+}  // namespace biovoltron
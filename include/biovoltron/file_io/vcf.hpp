@@ -3,6 +3,11 @@
 #include <biovoltron/file_io/core/header.hpp>
 #include <biovoltron/file_io/core/record.hpp>
 #include <biovoltron/utility/interval.hpp>
+#include <charconv>
+#include <map>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
 
 namespace biovoltron {
 /**
@@ -16,6 +21,11 @@ namespace biovoltron {
  * The header begins the file and provides metadata describing the body of the
  * file. Lines of header are denoted as starting with #.
  *
+ * Reading a VcfHeader also parses the `##INFO`, `##FORMAT`, `##FILTER` and
+ * `##contig` lines and the sample names of the `#CHROM` line into a schema,
+ * where each entry has an integer ID, its index in the list of its kind. PASS
+ * is always the filter 0. After changing lines, call parse() to rebuild it.
+ *
  * Example:
  * ```cpp
  * #include <iostream>
@@ -36,8 +46,205 @@ namespace biovoltron {
  */
 struct VcfHeader : Header {
   constexpr static auto START_SYMBOLS = std::array{"#"};
+
+  /**
+   * @brief Type of the values of an INFO or FORMAT field.
+   */
+  enum Type : std::uint8_t { INTEGER, FLOAT, FLAG, CHARACTER, STRING };
+
+  /**
+   * @brief Declaration of an INFO or FORMAT field.
+   */
+  struct Field {
+    std::string id;
+    /**
+     * @brief Number of values, a count or one of A, R, G and ".".
+     */
+    std::string number;
+    Type type = STRING;
+    std::string description;
+  };
+
+  struct Contig {
+    std::string id;
+    std::uint64_t length{};
+  };
+
+  std::vector<Field> infos;
+  std::vector<Field> formats;
+  std::vector<std::string> filters;
+  std::vector<Contig> contigs;
+  std::vector<std::string> samples;
+
+  /**
+   * @brief Hash of names, which allows looking up string_views.
+   */
+  struct NameHash {
+    using is_transparent = void;
+
+    auto
+    operator()(std::string_view name) const noexcept -> std::size_t {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
+
+  using Ids = std::unordered_map<std::string, int, NameHash, std::equal_to<>>;
+
+  /**
+   * @brief IDs of the entries of the schema by name.
+   */
+  Ids info_ids;
+  Ids format_ids;
+  Ids filter_ids;
+  Ids contig_ids;
+
+ private:
+  /*
+   * Key-value pairs of a structured line, e.g.
+   * `##INFO=<ID=DP,Number=1,Type=Integer,Description="Total Depth">`.
+   */
+  static auto
+  meta(std::string_view line) {
+    auto pairs = std::map<std::string, std::string, std::less<>>{};
+    line = line.substr(line.find('<') + 1);
+    while (!line.empty() && line.front() != '>') {
+      const auto equal = std::min(line.find('='), line.size());
+      auto& value = pairs[std::string{line.substr(0, equal)}];
+      auto i = std::min(equal + 1, line.size());
+      if (i < line.size() && line[i] == '"') {
+        for (i++; i < line.size() && line[i] != '"'; i++) {
+          if (line[i] == '\\' && i + 1 < line.size())
+            i++;
+          value += line[i];
+        }
+        i++;
+      } else
+        for (; i < line.size() && line[i] != ',' && line[i] != '>'; i++)
+          value += line[i];
+      line.remove_prefix(std::min(i + (i < line.size() && line[i] == ','),
+                                  line.size()));
+    }
+    return pairs;
+  }
+
+  static auto
+  get(const auto& pairs, std::string_view key) {
+    const auto it = pairs.find(key);
+    return it == pairs.end() ? std::string{} : it->second;
+  }
+
+  static auto
+  to_type(std::string_view type) {
+    if (type == "Integer")
+      return INTEGER;
+    if (type == "Float")
+      return FLOAT;
+    if (type == "Flag")
+      return FLAG;
+    if (type == "Character")
+      return CHARACTER;
+    return STRING;
+  }
+
+  static auto
+  id(const Ids& ids, std::string_view name) {
+    const auto it = ids.find(name);
+    return it == ids.end() ? -1 : it->second;
+  }
+
+ public:
+  /**
+   * @brief Rebuild the schema from the lines.
+   */
+  auto
+  parse() -> void {
+    infos.clear();
+    formats.clear();
+    filters = {"PASS"};
+    contigs.clear();
+    samples.clear();
+    info_ids.clear();
+    format_ids.clear();
+    filter_ids = {{"PASS", 0}};
+    contig_ids.clear();
+    for (const auto& line : lines) {
+      if (line.starts_with("#CHROM")) {
+        auto iss = std::istringstream{line};
+        for (auto column = std::string{}; std::getline(iss, column, '\t');)
+          samples.push_back(std::move(column));
+        samples.erase(samples.begin(),
+                      samples.begin() + std::min(samples.size(), std::size_t{9}));
+        continue;
+      }
+      const auto info = line.starts_with("##INFO=<");
+      if (info || line.starts_with("##FORMAT=<")) {
+        const auto pairs = meta(line);
+        auto& fields = info ? infos : formats;
+        auto& ids = info ? info_ids : format_ids;
+        auto field = Field{get(pairs, "ID"), get(pairs, "Number"),
+                           to_type(get(pairs, "Type")),
+                           get(pairs, "Description")};
+        if (ids.emplace(field.id, fields.size()).second)
+          fields.push_back(std::move(field));
+      } else if (line.starts_with("##FILTER=<")) {
+        auto filter = get(meta(line), "ID");
+        if (filter_ids.emplace(filter, filters.size()).second)
+          filters.push_back(std::move(filter));
+      } else if (line.starts_with("##contig=<")) {
+        const auto pairs = meta(line);
+        auto contig = Contig{get(pairs, "ID")};
+        const auto length = get(pairs, "length");
+        std::from_chars(length.data(), length.data() + length.size(),
+                        contig.length);
+        if (contig_ids.emplace(contig.id, contigs.size()).second)
+          contigs.push_back(std::move(contig));
+      }
+    }
+  }
+
+  /**
+   * @brief ID of an INFO field, -1 if it is not declared.
+   */
+  auto
+  info_id(std::string_view name) const {
+    return id(info_ids, name);
+  }
+
+  /**
+   * @brief ID of a FORMAT field, -1 if it is not declared.
+   */
+  auto
+  format_id(std::string_view name) const {
+    return id(format_ids, name);
+  }
+
+  /**
+   * @brief ID of a filter, -1 if it is not declared.
+   */
+  auto
+  filter_id(std::string_view name) const {
+    return id(filter_ids, name);
+  }
+
+  /**
+   * @brief ID of a contig, -1 if it is not declared.
+   */
+  auto
+  contig_id(std::string_view name) const {
+    return id(contig_ids, name);
+  }
 };
 
+/**
+ * @brief Read the lines of a VCF header and parse its schema.
+ */
+inline auto&
+operator>>(std::istream& is, VcfHeader& header) {
+  operator>><VcfHeader>(is, header);
+  header.parse();
+  return is;
+}
+
 /**
  * @ingroup file_io
  * @brief
@@ -191,6 +398,126 @@ struct VcfRecord : HeaderableRecord {
    */
   std::vector<std::string> samples;
 
+  /**
+   * @brief Parse a value of INFO or FORMAT, none if it is missing (".") or
+   * is not a T.
+   *
+   * T is an arithmetic type, parsed with std::from_chars, std::string or
+   * std::string_view, bool for flags, or a std::vector of these for lists
+   * separated by commas, e.g. `std::vector<double>` for AF.
+   */
+  template<class T>
+  static auto
+  to_value(std::string_view value) -> std::optional<T> {
+    if constexpr (std::same_as<T, bool>)
+      return true;
+    else {
+      if (value.empty() || value == ".")
+        return {};
+      if constexpr (std::same_as<T, std::string_view>)
+        return value;
+      else if constexpr (std::same_as<T, std::string>)
+        return T{value};
+      else if constexpr (requires { typename T::value_type; }) {
+        auto values = T{};
+        for (auto i = std::size_t{};; i++) {
+          const auto item = nth(value, i, ',');
+          if (!item)
+            return values;
+          auto converted = to_value<typename T::value_type>(*item);
+          if (!converted)
+            return {};
+          values.push_back(std::move(*converted));
+        }
+      } else {
+        auto converted = T{};
+        const auto last = value.data() + value.size();
+        const auto [ptr, ec] = std::from_chars(value.data(), last, converted);
+        if (ec != std::errc{} || ptr != last)
+          return {};
+        return converted;
+      }
+    }
+  }
+
+  /**
+   * @brief The ith item of a list, none if the list is shorter.
+   */
+  static auto
+  nth(std::string_view list, std::size_t i, char delimiter)
+    -> std::optional<std::string_view> {
+    for (auto begin = std::size_t{};; i--) {
+      const auto end = std::min(list.find(delimiter, begin), list.size());
+      if (i == 0)
+        return list.substr(begin, end - begin);
+      if (end == list.size())
+        return {};
+      begin = end + 1;
+    }
+  }
+
+  /**
+   * @brief Value of a key of an INFO column, empty for a flag, none if the
+   * key is absent.
+   */
+  static auto
+  info_value(std::string_view info, std::string_view key)
+    -> std::optional<std::string_view> {
+    for (auto rest = info; !rest.empty();) {
+      const auto semicolon = std::min(rest.find(';'), rest.size());
+      const auto entry = rest.substr(0, semicolon);
+      if (entry.starts_with(key)) {
+        if (entry.size() == key.size())
+          return std::string_view{};
+        if (entry[key.size()] == '=')
+          return entry.substr(key.size() + 1);
+      }
+      rest.remove_prefix(std::min(semicolon + 1, rest.size()));
+    }
+    return {};
+  }
+
+  /**
+   * @brief Typed value of an INFO key, none if it is absent.
+   *
+   * ```cpp
+   * const auto depth = record.get_info<int>("DP");
+   * const auto frequencies = record.get_info<std::vector<double>>("AF");
+   * const auto in_dbsnp = record.get_info<bool>("DB").has_value();
+   * ```
+   */
+  template<class T>
+  auto
+  get_info(std::string_view key) const -> std::optional<T> {
+    const auto value = info_value(info, key);
+    if (!value)
+      return {};
+    return to_value<T>(*value);
+  }
+
+  /**
+   * @brief Typed values of a FORMAT key, one for each sample, none for the
+   * samples missing it.
+   *
+   * ```cpp
+   * const auto genotypes = record.get_format<std::string_view>("GT");
+   * const auto qualities = record.get_format<int>("GQ");
+   * ```
+   */
+  template<class T>
+  auto
+  get_format(std::string_view key) const {
+    auto values = std::vector<std::optional<T>>(samples.size());
+    for (auto i = std::size_t{}; const auto item = nth(format, i, ':'); i++)
+      if (*item == key) {
+        for (auto s = std::size_t{}; s < samples.size(); s++)
+          if (const auto value = nth(samples[s], i, ':'))
+            values[s] = to_value<T>(*value);
+        break;
+      }
+    return values;
+  }
+
   /**
    * @brief Compare two samples in variant call format.
    *
@@ -206,8 +533,175 @@ struct VcfRecord : HeaderableRecord {
    *
    * Interval is a segment of sequence with name of chromosome,
    * start and end of position, and the strand of segment.
+   * The interval spans the REF allele, or up to the INFO END of a
+   * structural variant, as in tabix. Earlier versions spanned the first
+   * base only, which `Interval{record.chrom, record.pos - 1, record.pos,
+   * '+'}` still gives.
    */
-  operator auto() const { return Interval{chrom, pos - 1, pos, '+'}; }
+  operator auto() const {
+    const auto end = get_info<std::uint32_t>("END").value_or(0);
+    return Interval{
+      chrom, pos - 1,
+      end > pos - 1 ? end
+                    : pos - 1 + std::max(std::uint32_t(ref.size()), 1u),
+      '+'};
+  }
+};
+
+/**
+ * @ingroup file_io
+ * @brief Index of the INFO and FORMAT fields of a VcfRecord by the integer
+ * IDs of the schema of its VcfHeader.
+ *
+ * The INFO column is split once when a record is indexed, so each typed
+ * lookup after that is an array access and a std::from_chars, instead of a
+ * scan of the column as VcfRecord::get_info() does. An index reused for the
+ * records of a file remembers the IDs of the keys of the last one, so keys
+ * in the same order as in the previous record are not hashed again. Keys
+ * not declared in the header can still be looked up by name.
+ *
+ * The index holds views of the record, which must outlive its use.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/file_io/vcf.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto fin = std::ifstream{"cohort.vcf"};
+ *   auto header = VcfHeader{};
+ *   fin >> header;
+ *   const auto dp = header.info_id("DP");
+ *   const auto gq = header.format_id("GQ");
+ *   auto fields = VcfFields{header};
+ *   for (auto record = VcfRecord{}; fin >> record;) {
+ *     fields.assign(record);
+ *     if (fields.info<int>(dp).value_or(0) >= 10)
+ *       for (const auto quality : fields.format<int>(gq))
+ *         std::cout << quality.value_or(-1) << "\n";
+ *   }
+ * }
+ * ```
+ */
+struct VcfFields {
+  const VcfRecord* record = nullptr;
+  const VcfHeader* header = nullptr;
+
+  /**
+   * @brief Value of each INFO field by ID, empty for a flag, none if it is
+   * absent.
+   */
+  std::vector<std::optional<std::string_view>> infos;
+
+  /**
+   * @brief Position of each FORMAT field in the FORMAT column by ID, -1 if
+   * it is absent.
+   */
+  std::vector<int> formats;
+
+ private:
+  /*
+   * ID of the INFO key at each position of the last record indexed.
+   */
+  std::vector<int> info_order;
+
+ public:
+  VcfFields() = default;
+
+  explicit VcfFields(const VcfHeader& header)
+  : header(&header),
+    infos(header.infos.size()),
+    formats(header.formats.size(), -1) { }
+
+  VcfFields(const VcfRecord& record, const VcfHeader& header)
+  : VcfFields(header) {
+    assign(record);
+  }
+
+  /**
+   * @brief Index another record with the same header.
+   */
+  auto
+  assign(const VcfRecord& record) -> void {
+    this->record = &record;
+    std::ranges::fill(infos, std::nullopt);
+    std::ranges::fill(formats, -1);
+    auto position = std::size_t{};
+    for (auto rest = std::string_view{record.info}; !rest.empty(); position++) {
+      const auto semicolon = std::min(rest.find(';'), rest.size());
+      const auto entry = rest.substr(0, semicolon);
+      const auto equal = std::min(entry.find('='), entry.size());
+      const auto key = entry.substr(0, equal);
+      if (position == info_order.size())
+        info_order.push_back(-1);
+      auto& id = info_order[position];
+      if (id < 0 || header->infos[id].id != key)
+        id = header->info_id(key);
+      if (id >= 0)
+        infos[id] = entry.substr(std::min(equal + 1, entry.size()));
+      rest.remove_prefix(std::min(semicolon + 1, rest.size()));
+    }
+    for (auto i = 0; const auto item = VcfRecord::nth(record.format, i, ':');
+         i++)
+      if (const auto id = header->format_id(*item); id >= 0)
+        formats[id] = i;
+  }
+
+  /**
+   * @brief Typed value of an INFO field, none if it is absent.
+   */
+  template<class T>
+  auto
+  info(int id) const -> std::optional<T> {
+    if (id < 0 || std::size_t(id) >= infos.size() || !infos[id])
+      return {};
+    return VcfRecord::to_value<T>(*infos[id]);
+  }
+
+  template<class T>
+  auto
+  info(std::string_view key) const -> std::optional<T> {
+    if (const auto id = header->info_id(key); id >= 0)
+      return info<T>(id);
+    return record->get_info<T>(key);
+  }
+
+  /**
+   * @brief Typed value of a FORMAT field of a sample, none if it is absent.
+   */
+  template<class T>
+  auto
+  format(int id, std::size_t sample) const -> std::optional<T> {
+    if (id < 0 || std::size_t(id) >= formats.size() || formats[id] < 0)
+      return {};
+    const auto value = VcfRecord::nth(record->samples.at(sample), formats[id],
+                                      ':');
+    if (!value)
+      return {};
+    return VcfRecord::to_value<T>(*value);
+  }
+
+  /**
+   * @brief Typed values of a FORMAT field, one for each sample.
+   */
+  template<class T>
+  auto
+  format(int id) const {
+    auto values = std::vector<std::optional<T>>(record->samples.size());
+    for (auto s = std::size_t{}; s < values.size(); s++)
+      values[s] = format<T>(id, s);
+    return values;
+  }
+
+  template<class T>
+  auto
+  format(std::string_view key) const {
+    if (const auto id = header->format_id(key); id >= 0)
+      return format<T>(id);
+    return record->get_format<T>(key);
+  }
 };
 
 }  // namespace biovoltron
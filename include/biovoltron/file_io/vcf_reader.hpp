@@ -0,0 +1,316 @@
+#pragma once
+
+#include <biovoltron/file_io/vcf.hpp>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <immintrin.h>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+namespace biovoltron {
+
+/**
+ * @ingroup file_io
+ * @brief Fast reader of VCF records which parses columns only when they are
+ * accessed.
+ *
+ * The stream is read in large blocks into a buffer reused for every record,
+ * and each line is split at its tabs, found 32 bytes at a time with AVX2,
+ * into views of its first nine columns. The sample columns are kept as one
+ * view, which is only split when a sample is accessed, and POS and QUAL are
+ * parsed with std::from_chars when accessed. A scan of the sites of a VCF
+ * with thousands of samples thus only finds the end of each line.
+ *
+ * Views returned by the reader are valid until the next call of read().
+ * A record can be copied out as a VcfRecord with to_record().
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/file_io/vcf_reader.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto fin = std::ifstream{"cohort.vcf"};
+ *   auto reader = VcfReader{fin};
+ *   while (reader.read())
+ *     if (reader.filter() == "PASS")
+ *       std::cout << reader.chrom() << "\t" << reader.pos() << "\t"
+ *                 << reader.sample(0) << "\n";
+ * }
+ * ```
+ */
+struct VcfReader {
+  /**
+   * @brief Size of the blocks read from the stream.
+   */
+  constexpr static auto BLOCK_SIZE = std::size_t{1} << 20;
+
+  /**
+   * @brief Number of columns before the samples.
+   */
+  constexpr static auto FIXED_COLUMNS = 9u;
+
+  /**
+   * @brief Header lines read before the first record.
+   */
+  VcfHeader header;
+
+ private:
+  std::istream& is;
+  std::string buffer = std::string(BLOCK_SIZE, '\0');
+  std::size_t begin{};
+  std::size_t end{};
+  std::size_t line_end{};
+  std::string_view current;
+  std::vector<std::uint32_t> tabs;
+  std::array<std::string_view, FIXED_COLUMNS> columns;
+  std::string_view sample_columns;
+  std::vector<std::string_view> sample_views;
+  bool samples_split{};
+
+  /*
+   * Offsets of the first max tabs of a string, appended to tabs.
+   */
+  static auto
+  find_tabs(std::string_view s, std::size_t max, auto& tabs) {
+    const auto data = s.data();
+    auto found = std::size_t{};
+    auto i = std::size_t{};
+    for (; i + 32 <= s.size() && found < max; i += 32) {
+      auto mask = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)),
+        _mm256_set1_epi8('\t'))));
+      for (; mask != 0 && found < max; mask &= mask - 1, found++)
+        tabs.push_back(i + std::countr_zero(mask));
+    }
+    for (; i < s.size() && found < max; i++)
+      if (data[i] == '\t') {
+        tabs.push_back(i);
+        found++;
+      }
+  }
+
+  /*
+   * The next line, without consuming it, or none at the end of the stream.
+   */
+  auto
+  peek_line() -> std::optional<std::string_view> {
+    for (;;) {
+      const auto data = buffer.data();
+      if (const auto newline = static_cast<const char*>(
+            std::memchr(data + begin, '\n', end - begin))) {
+        auto line = std::string_view(data + begin, newline);
+        line_end = newline - data + 1;
+        if (line.ends_with('\r'))
+          line.remove_suffix(1);
+        return line;
+      }
+      if (!is) {
+        if (begin == end)
+          return {};
+        buffer[end] = '\n';
+        end++;
+        continue;
+      }
+      std::memmove(data, data + begin, end - begin);
+      end -= begin;
+      begin = 0;
+      if (end + 1 >= buffer.size())
+        buffer.resize(buffer.size() * 2);
+      is.read(buffer.data() + end, buffer.size() - end - 1);
+      end += is.gcount();
+    }
+  }
+
+  auto
+  consume() {
+    begin = line_end;
+  }
+
+ public:
+  /**
+   * @brief Read the header of a VCF stream.
+   */
+  explicit VcfReader(std::istream& is) : is(is) {
+    for (auto line = peek_line(); line && line->starts_with('#');
+         line = peek_line()) {
+      header.lines.emplace_back(*line);
+      consume();
+    }
+    header.parse();
+  }
+
+  /**
+   * @brief Read the next record.
+   *
+   * @return false at the end of the stream.
+   */
+  auto
+  read() {
+    for (;;) {
+      const auto line = peek_line();
+      if (!line)
+        return false;
+      consume();
+      if (line->empty())
+        continue;
+      current = *line;
+      break;
+    }
+    tabs.clear();
+    find_tabs(current, FIXED_COLUMNS, tabs);
+    auto first = std::size_t{};
+    for (auto c = 0u; c < FIXED_COLUMNS; c++) {
+      if (c > tabs.size()) {
+        columns[c] = {};
+        continue;
+      }
+      const auto last = c < tabs.size() ? tabs[c] : current.size();
+      columns[c] = current.substr(first, last - first);
+      first = last + 1;
+    }
+    sample_columns = tabs.size() == FIXED_COLUMNS
+                       ? current.substr(tabs.back() + 1)
+                       : std::string_view{};
+    samples_split = false;
+    return true;
+  }
+
+  /**
+   * @brief The whole line of the record.
+   */
+  auto
+  line() const noexcept {
+    return current;
+  }
+
+  auto
+  chrom() const noexcept {
+    return columns[0];
+  }
+
+  /**
+   * @brief POS, 0 if it is not a number.
+   */
+  auto
+  pos() const noexcept {
+    auto pos = std::uint32_t{};
+    std::from_chars(columns[1].data(), columns[1].data() + columns[1].size(),
+                    pos);
+    return pos;
+  }
+
+  auto
+  id() const noexcept {
+    return columns[2];
+  }
+
+  auto
+  ref() const noexcept {
+    return columns[3];
+  }
+
+  auto
+  alt() const noexcept {
+    return columns[4];
+  }
+
+  /**
+   * @brief QUAL, NaN if it is missing.
+   */
+  auto
+  qual() const noexcept {
+    auto qual = std::numeric_limits<double>::quiet_NaN();
+    std::from_chars(columns[5].data(), columns[5].data() + columns[5].size(),
+                    qual);
+    return qual;
+  }
+
+  auto
+  filter() const noexcept {
+    return columns[6];
+  }
+
+  auto
+  info() const noexcept {
+    return columns[7];
+  }
+
+  /**
+   * @brief Value of an INFO key, empty for a flag, none if it is absent.
+   */
+  auto
+  info(std::string_view key) const {
+    return VcfRecord::info_value(columns[7], key);
+  }
+
+  auto
+  format() const noexcept {
+    return columns[8];
+  }
+
+  /**
+   * @brief The sample columns, unsplit.
+   */
+  auto
+  samples() const noexcept {
+    return sample_columns;
+  }
+
+  /**
+   * @brief The sample columns, split when first accessed for a record.
+   */
+  auto
+  sample_list() -> const std::vector<std::string_view>& {
+    if (samples_split)
+      return sample_views;
+    samples_split = true;
+    sample_views.clear();
+    if (sample_columns.empty())
+      return sample_views;
+    tabs.clear();
+    find_tabs(sample_columns, sample_columns.size(), tabs);
+    auto first = std::size_t{};
+    for (const auto tab : tabs) {
+      sample_views.push_back(sample_columns.substr(first, tab - first));
+      first = tab + 1;
+    }
+    sample_views.push_back(sample_columns.substr(first));
+    return sample_views;
+  }
+
+  /**
+   * @brief Column of the ith sample.
+   */
+  auto
+  sample(std::size_t i) {
+    return sample_list().at(i);
+  }
+
+  /**
+   * @brief Copy the record out.
+   */
+  auto
+  to_record() {
+    auto record = VcfRecord{};
+    record.header = &header;
+    record.chrom = chrom();
+    record.pos = pos();
+    record.id = id();
+    record.ref = ref();
+    record.alt = alt();
+    record.qual = qual();
+    record.filter = filter();
+    record.info = info();
+    record.format = format();
+    for (const auto sample : sample_list()) record.samples.emplace_back(sample);
+    return record;
+  }
+};
+
+}  // namespace biovoltron
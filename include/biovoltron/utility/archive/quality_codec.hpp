@@ -0,0 +1,291 @@
+#pragma once
+
+#include <biovoltron/utility/archive/serializer.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <immintrin.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace biovoltron {
+
+/**
+ * @ingroup utility
+ * @brief Lossless compression of blocks of quality strings with an adaptive
+ * context model and a range coder.
+ *
+ * Each quality is coded with a frequency model chosen by the previous
+ * quality of the read and a coarse bucket of the one before, which adapts
+ * to the data as it is coded. Qualities are first mapped to the distinct
+ * characters of the block, so binned qualities (see QualityBinner) use a few
+ * small models and compress several times better than raw ones.
+ *
+ * Every block is self-contained, with its own models and read lengths, so a
+ * container of blocks can decode any of them alone.
+ *
+ * Example
+ * ```cpp
+ * #include <cassert>
+ * #include <biovoltron/utility/archive/quality_codec.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   const auto quals = std::vector<std::string>{"FFF:F", "FF,F"};
+ *   const auto block = QualityCodec::compress(quals);
+ *   assert(QualityCodec::decompress(block) == quals);
+ * }
+ * ```
+ */
+struct QualityCodec {
+ private:
+  constexpr static auto BUCKETS = 16u;
+  constexpr static auto STEP = 24u;
+  constexpr static auto MAX_TOTAL = 1u << 16;
+  constexpr static auto TOP = 1u << 24;
+
+  /*
+   * Adaptive frequencies of the symbols in each context, kept as cumulative
+   * frequencies with the total last, padded to whole AVX2 vectors. Encoding
+   * a symbol reads two of them, decoding counts those not above the target,
+   * and an update adds to those after the symbol, a few vectors each with no
+   * branch on the symbol.
+   */
+  struct Model {
+    unsigned symbols;
+    unsigned stride;
+    std::vector<std::uint16_t> cums;
+
+    Model(unsigned contexts, unsigned symbols)
+    : symbols(symbols),
+      stride((symbols + 16) / 16 * 16),
+      cums(std::size_t{contexts} * stride, 0xffff) {
+      for (auto ctx = 0u; ctx < contexts; ctx++)
+        for (auto s = 0u; s <= symbols; s++) cums[ctx * stride + s] = s;
+    }
+
+    auto
+    cum(unsigned context) noexcept {
+      return &cums[std::size_t{context} * stride];
+    }
+
+    /*
+     * The symbol whose range holds target, i.e. the number of cumulative
+     * frequencies not above it, minus the leading zero. Padding is 0xffff,
+     * above any target.
+     */
+    auto
+    find(const std::uint16_t* cum, std::uint32_t target) const noexcept {
+      const auto v_target = _mm256_set1_epi16(target);
+      auto count = 0;
+      for (auto i = 0u; i < stride; i += 16) {
+        const auto v
+          = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cum + i));
+        const auto le = _mm256_cmpeq_epi16(_mm256_min_epu16(v, v_target), v);
+        count += std::popcount(unsigned(_mm256_movemask_epi8(le)));
+      }
+      return unsigned(count / 2 - 1);
+    }
+
+    /*
+     * The total may wrap to 0 before it is halved, which only reads
+     * differences.
+     */
+    auto
+    update(unsigned context, unsigned symbol) {
+      const auto c = cum(context);
+      const auto total = c[symbols] + STEP;
+      const auto v_step = _mm256_set1_epi16(STEP);
+      const auto v_begin = _mm256_set1_epi16(symbol);
+      const auto v_end = _mm256_set1_epi16(symbols + 1);
+      const auto first = (symbol + 1) / 16 * 16;
+      auto v_index = _mm256_add_epi16(
+        _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+        _mm256_set1_epi16(first));
+      for (auto i = first; i < stride; i += 16) {
+        const auto p = reinterpret_cast<__m256i*>(c + i);
+        const auto in = _mm256_and_si256(_mm256_cmpgt_epi16(v_index, v_begin),
+                                         _mm256_cmpgt_epi16(v_end, v_index));
+        _mm256_storeu_si256(p, _mm256_add_epi16(_mm256_loadu_si256(p),
+                                                _mm256_and_si256(in, v_step)));
+        v_index = _mm256_add_epi16(v_index, _mm256_set1_epi16(16));
+      }
+      if (total > MAX_TOTAL - STEP) {
+        auto sum = std::uint16_t{};
+        auto prev = std::uint16_t{};
+        for (auto s = 1u; s <= symbols; s++) {
+          const auto freq = std::uint16_t(c[s] - prev);
+          prev = c[s];
+          c[s] = sum += (freq + 1) / 2;
+        }
+      }
+    }
+  };
+
+  /*
+   * Range coder with carry propagation, as in LZMA.
+   */
+  struct Encoder {
+    std::string& out;
+    std::uint64_t low{};
+    std::uint32_t range = ~0u;
+    std::uint8_t cache{};
+    std::uint64_t cache_size = 1;
+
+    auto
+    shift_low() {
+      if (std::uint32_t(low) < 0xff000000u || (low >> 32) != 0) {
+        const auto carry = std::uint8_t(low >> 32);
+        auto byte = cache;
+        do {
+          out += char(std::uint8_t(byte + carry));
+          byte = 0xff;
+        } while (--cache_size != 0);
+        cache = std::uint8_t(low >> 24);
+      }
+      cache_size++;
+      low = (low & 0x00ffffffu) << 8;
+    }
+
+    auto
+    encode(std::uint32_t cum, std::uint32_t freq, std::uint32_t total) {
+      const auto r = range / total;
+      low += std::uint64_t{r} * cum;
+      range = r * freq;
+      while (range < TOP) {
+        range <<= 8;
+        shift_low();
+      }
+    }
+
+    auto
+    flush() {
+      for (auto i = 0; i < 5; i++) shift_low();
+    }
+  };
+
+  struct Decoder {
+    std::string_view in;
+    std::size_t pos{};
+    std::uint32_t code{};
+    std::uint32_t range = ~0u;
+    std::uint32_t r{};
+
+    auto
+    next() noexcept {
+      return pos < in.size() ? std::uint8_t(in[pos++]) : std::uint8_t{};
+    }
+
+    explicit Decoder(std::string_view in) : in(in) {
+      for (auto i = 0; i < 5; i++) code = code << 8 | next();
+    }
+
+    auto
+    target(std::uint32_t total) noexcept {
+      r = range / total;
+      return std::min(code / r, total - 1);
+    }
+
+    auto
+    decode(std::uint32_t cum, std::uint32_t freq) noexcept {
+      code -= r * cum;
+      range = r * freq;
+      while (range < TOP) {
+        code = code << 8 | next();
+        range <<= 8;
+      }
+    }
+  };
+
+  static auto
+  context(unsigned prev1, unsigned prev2, unsigned symbols) noexcept {
+    return prev1 * BUCKETS + prev2 * BUCKETS / symbols;
+  }
+
+ public:
+  /**
+   * @brief Compress a block of quality strings.
+   *
+   * @param quals A range of strings, e.g. a std::vector<std::string>.
+   */
+  template<class Q>
+  static auto
+  compress(const Q& quals) {
+    auto block = std::string{};
+    auto present = std::array<bool, 256>{};
+    Serializer::put_varint(block, std::size(quals));
+    for (const auto& qual : quals) {
+      const auto view = std::string_view{qual};
+      Serializer::put_varint(block, view.size());
+      for (const auto c : view) present[std::uint8_t(c)] = true;
+    }
+    auto index = std::array<std::uint8_t, 256>{};
+    auto symbols = 0u;
+    auto table = std::string{};
+    for (auto c = 0u; c < 256; c++)
+      if (present[c]) {
+        index[c] = symbols++;
+        table += char(c);
+      }
+    Serializer::put_varint(block, symbols);
+    block += table;
+    if (symbols == 0)
+      return block;
+
+    auto model = Model{symbols * BUCKETS, symbols};
+    auto encoder = Encoder{block};
+    for (const auto& qual : quals) {
+      auto prev1 = 0u, prev2 = 0u;
+      for (const auto c : std::string_view{qual}) {
+        const auto symbol = index[std::uint8_t(c)];
+        const auto ctx = context(prev1, prev2, symbols);
+        const auto cum = model.cum(ctx);
+        encoder.encode(cum[symbol], cum[symbol + 1] - cum[symbol],
+                       cum[symbols]);
+        model.update(ctx, symbol);
+        prev2 = prev1;
+        prev1 = symbol;
+      }
+    }
+    encoder.flush();
+    return block;
+  }
+
+  /**
+   * @brief Decompress a block written by compress().
+   */
+  static auto
+  decompress(std::string_view block) {
+    auto pos = std::size_t{};
+    auto quals = std::vector<std::string>(Serializer::get_varint(block, pos));
+    for (auto& qual : quals) qual.resize(Serializer::get_varint(block, pos));
+    const auto symbols = Serializer::get_varint(block, pos);
+    if (symbols > 256 || pos + symbols > block.size())
+      throw std::runtime_error("QualityCodec: truncated block");
+    const auto table = block.substr(pos, symbols);
+    if (symbols == 0)
+      return quals;
+
+    auto model = Model{unsigned(symbols) * BUCKETS, unsigned(symbols)};
+    auto decoder = Decoder{block.substr(pos + symbols)};
+    for (auto& qual : quals) {
+      auto prev1 = 0u, prev2 = 0u;
+      for (auto& c : qual) {
+        const auto ctx = context(prev1, prev2, symbols);
+        const auto cum = model.cum(ctx);
+        const auto symbol = model.find(cum, decoder.target(cum[symbols]));
+        decoder.decode(cum[symbol], cum[symbol + 1] - cum[symbol]);
+        model.update(ctx, symbol);
+        c = table[symbol];
+        prev2 = prev1;
+        prev1 = symbol;
+      }
+    }
+    return quals;
+  }
+};
+
+}  // namespace biovoltron
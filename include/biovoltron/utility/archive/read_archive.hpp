@@ -0,0 +1,506 @@
+#pragma once
+
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/archive/quality_codec.hpp>
+#include <biovoltron/utility/archive/serializer.hpp>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <optional>
+#include <ranges>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include <zlib.h>
+
+namespace biovoltron {
+
+/**
+ * @ingroup utility
+ * @brief Compressed container of FastqRecord with random access by read
+ * number.
+ *
+ * Reads are stored in blocks of BLOCK_SIZE reads which are compressed and
+ * decompressed independently, in parallel. In a block,
+ *
+ * - names are split into runs of digits and of other characters, and each
+ *   run is coded as a match of the same run of the previous name, a numeric
+ *   delta, a number or a literal, and the codes of each run are grouped and
+ *   deflated;
+ * - sequences are packed with 2 bits per base, and deflated when it is
+ *   smaller, and runs of ambiguous bases are stored apart;
+ * - qualities are coded by QualityCodec.
+ *
+ * Bases other than A, C, G and T are all restored as N, and lower case bases
+ * as upper case. The index of blocks is written after them, so that a
+ * loaded archive is memory mapped and only the blocks which are read are
+ * decompressed.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <iostream>
+ * #include <biovoltron/utility/archive/read_archive.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   {
+ *     auto fin = std::ifstream{"sample.fq"};
+ *     auto fout = std::ofstream{"sample.fqa", std::ios::binary};
+ *     ReadArchive{}.save(fin, fout);
+ *   }
+ *   auto archive = ReadArchive{};
+ *   archive.load("sample.fqa");
+ *   std::cout << archive.size() << " reads\n";
+ *   std::cout << archive.get(archive.size() / 2) << "\n";
+ *   for (const auto& read : archive.read(100, 200)) std::cout << read << "\n";
+ * }
+ * ```
+ */
+struct ReadArchive {
+  /**
+   * @brief Number of reads of a block.
+   */
+  std::size_t BLOCK_SIZE = 1 << 16;
+
+  /**
+   * @brief The mapped archive, null until loaded.
+   */
+  std::shared_ptr<const MappedFile> file;
+
+  /**
+   * @brief Offset of each block in the file, and of the end of the last one.
+   */
+  MappedVector<std::uint64_t> block_offsets;
+
+  /**
+   * @brief Number of the first read of each block, and the number of reads.
+   */
+  MappedVector<std::uint64_t> block_reads;
+
+ private:
+  constexpr static auto MAGIC = std::uint64_t{0x31304146564f4942};  // BIOVFA01
+
+  constexpr static auto COLUMNS = std::size_t{16};
+
+  enum : std::uint8_t { MATCH, DELTA, NUMBER, LITERAL, END };
+
+  static auto
+  get_bytes(std::string_view in, std::size_t& pos, std::size_t size) {
+    if (pos + size > in.size())
+      throw std::runtime_error("ReadArchive: truncated block");
+    pos += size;
+    return in.substr(pos - size, size);
+  }
+
+  static auto
+  deflate(std::string_view data) {
+    auto size = compressBound(data.size());
+    auto deflated = std::string(size, '\0');
+    compress2(reinterpret_cast<Bytef*>(deflated.data()), &size,
+              reinterpret_cast<const Bytef*>(data.data()), data.size(),
+              Z_DEFAULT_COMPRESSION);
+    deflated.resize(size);
+    return deflated;
+  }
+
+  static auto
+  inflate(std::string_view deflated, std::size_t size, const char* section) {
+    auto data = std::string(size, '\0');
+    auto inflated = uLongf(size);
+    if (uncompress(reinterpret_cast<Bytef*>(data.data()), &inflated,
+                   reinterpret_cast<const Bytef*>(deflated.data()),
+                   deflated.size())
+          != Z_OK
+        || inflated != size)
+      throw std::runtime_error(std::string{"ReadArchive: corrupted "}
+                               + section);
+    return data;
+  }
+
+  static auto
+  is_digit(char c) noexcept {
+    return std::isdigit(std::uint8_t(c)) != 0;
+  }
+
+  /*
+   * Runs of digits and of other characters.
+   */
+  static auto
+  tokenize(std::string_view name) {
+    auto tokens = std::vector<std::string_view>{};
+    for (auto i = std::size_t{}; i < name.size();) {
+      const auto digit = is_digit(name[i]);
+      auto j = i + 1;
+      while (j < name.size() && is_digit(name[j]) == digit) j++;
+      tokens.push_back(name.substr(i, j - i));
+      i = j;
+    }
+    return tokens;
+  }
+
+  /*
+   * Value of a run of at most 18 digits without leading zeros, which is
+   * restored exactly by std::to_string.
+   */
+  static auto
+  number(std::string_view token) {
+    auto value = std::uint64_t{};
+    if (token.empty() || token.size() > 18 || !is_digit(token[0])
+        || (token[0] == '0' && token.size() > 1))
+      return std::optional<std::uint64_t>{};
+    std::from_chars(token.data(), token.data() + token.size(), value);
+    return std::optional{value};
+  }
+
+  static auto
+  encode_names(std::span<const FastqRecord<>> reads) {
+    // The codes of the i-th run of the names are kept together.
+    auto columns = std::array<std::string, COLUMNS>{};
+    auto prev = std::vector<std::string_view>{};
+    for (const auto& read : reads) {
+      const auto tokens = tokenize(read.name);
+      for (auto i = std::size_t{}; i <= tokens.size(); i++) {
+        auto& codes = columns[std::min(i, COLUMNS - 1)];
+        if (i == tokens.size()) {
+          codes += char(END);
+          break;
+        }
+        const auto value = number(tokens[i]);
+        const auto base = i < prev.size() ? number(prev[i]) : std::nullopt;
+        if (i < prev.size() && tokens[i] == prev[i])
+          codes += char(MATCH);
+        else if (value && base && *value >= *base) {
+          codes += char(DELTA);
+          Serializer::put_varint(codes, *value - *base);
+        } else if (value) {
+          codes += char(NUMBER);
+          Serializer::put_varint(codes, *value);
+        } else {
+          codes += char(LITERAL);
+          Serializer::put_varint(codes, tokens[i].size());
+          codes += tokens[i];
+        }
+      }
+      prev = tokens;
+    }
+    auto codes = std::string{};
+    for (const auto& column : columns)
+      Serializer::put_varint(codes, column.size());
+    for (const auto& column : columns) codes += column;
+    auto section = std::string{};
+    Serializer::put_varint(section, codes.size());
+    return section + deflate(codes);
+  }
+
+  static auto
+  decode_names(std::string_view section, std::vector<FastqRecord<>>& reads) {
+    auto pos = std::size_t{};
+    const auto size = Serializer::get_varint(section, pos);
+    const auto codes = inflate(section.substr(pos), size, "names");
+    pos = 0;
+    auto columns = std::array<std::string_view, COLUMNS>{};
+    for (auto& column : columns)
+      column = {{}, Serializer::get_varint(codes, pos)};
+    for (auto& column : columns)
+      column = get_bytes(codes, pos, column.size());
+    auto positions = std::array<std::size_t, COLUMNS>{};
+    auto prev = std::vector<std::string>{};
+    for (auto& read : reads) {
+      auto tokens = std::vector<std::string>{};
+      for (;;) {
+        const auto i = tokens.size();
+        const auto codes = columns[std::min(i, COLUMNS - 1)];
+        auto& pos = positions[std::min(i, COLUMNS - 1)];
+        const auto code = std::uint8_t(get_bytes(codes, pos, 1)[0]);
+        if (code == END)
+          break;
+        if ((code == MATCH || code == DELTA) && i >= prev.size())
+          throw std::runtime_error("ReadArchive: corrupted names");
+        if (code == MATCH)
+          tokens.push_back(prev[i]);
+        else if (code == DELTA)
+          tokens.push_back(
+            std::to_string(number(prev[i]).value_or(0)
+                           + Serializer::get_varint(codes, pos)));
+        else if (code == NUMBER)
+          tokens.push_back(std::to_string(Serializer::get_varint(codes, pos)));
+        else
+          tokens.emplace_back(
+            get_bytes(codes, pos, Serializer::get_varint(codes, pos)));
+      }
+      read.name.clear();
+      for (const auto& token : tokens) read.name += token;
+      prev = std::move(tokens);
+    }
+  }
+
+ public:
+  /**
+   * @brief Compress a block of reads.
+   */
+  static auto
+  compress_block(std::span<const FastqRecord<>> reads) {
+    auto block = std::string{};
+    Serializer::put_varint(block, reads.size());
+    for (const auto& read : reads)
+      Serializer::put_varint(block, read.seq.size());
+
+    auto packed = std::string{};
+    auto runs = std::vector<std::pair<std::uint64_t, std::uint64_t>>{};
+    auto pos = std::uint64_t{};
+    auto byte = 0u, bases = 0u;
+    for (const auto& read : reads)
+      for (const auto c : read.seq) {
+        const auto code = std::uint8_t(c) < 128 ? Codec::to_int(c) : 4;
+        if (code == 4) {
+          if (!runs.empty() && runs.back().first + runs.back().second == pos)
+            runs.back().second++;
+          else
+            runs.emplace_back(pos, 1);
+        }
+        byte |= (code & 3u) << 2 * bases;
+        if (++bases == 4) {
+          packed += char(byte);
+          byte = bases = 0;
+        }
+        pos++;
+      }
+    if (bases != 0)
+      packed += char(byte);
+    Serializer::put_varint(block, runs.size());
+    auto end = std::uint64_t{};
+    for (const auto& [start, size] : runs) {
+      Serializer::put_varint(block, start - end);
+      Serializer::put_varint(block, size);
+      end = start + size;
+    }
+    // Overlapping reads, as those of a sorted BAM, deflate well.
+    const auto deflated = deflate(packed);
+    if (deflated.size() < packed.size()) {
+      Serializer::put_varint(block, deflated.size());
+      block += deflated;
+    } else {
+      Serializer::put_varint(block, 0);
+      block += packed;
+    }
+
+    const auto names = encode_names(reads);
+    Serializer::put_varint(block, names.size());
+    block += names;
+    block += QualityCodec::compress(
+      reads | std::views::transform(&FastqRecord<>::qual));
+    return block;
+  }
+
+  /**
+   * @brief Decompress a block written by compress_block().
+   */
+  static auto
+  decompress_block(std::string_view block) {
+    auto pos = std::size_t{};
+    auto reads = std::vector<FastqRecord<>>(Serializer::get_varint(block, pos));
+    auto total = std::uint64_t{};
+    for (auto& read : reads) {
+      read.seq.resize(Serializer::get_varint(block, pos));
+      total += read.seq.size();
+    }
+
+    auto runs = std::vector<std::pair<std::uint64_t, std::uint64_t>>(
+      Serializer::get_varint(block, pos));
+    auto end = std::uint64_t{};
+    for (auto& [start, size] : runs) {
+      start = end + Serializer::get_varint(block, pos);
+      size = Serializer::get_varint(block, pos);
+      end = start + size;
+    }
+    if (end > total)
+      throw std::runtime_error("ReadArchive: corrupted sequences");
+    const auto deflated = Serializer::get_varint(block, pos);
+    const auto packed
+      = deflated == 0
+          ? std::string{get_bytes(block, pos, (total + 3) / 4)}
+          : inflate(get_bytes(block, pos, deflated), (total + 3) / 4,
+                    "sequences");
+    auto base = std::uint64_t{};
+    auto run = runs.begin();
+    for (auto& read : reads)
+      for (auto& c : read.seq) {
+        if (run != runs.end() && base >= run->first + run->second)
+          run++;
+        c = run != runs.end() && base >= run->first
+              ? 'N'
+              : Codec::to_char(std::uint8_t(packed[base / 4]) >> base % 4 * 2
+                               & 3);
+        base++;
+      }
+
+    decode_names(get_bytes(block, pos, Serializer::get_varint(block, pos)),
+                 reads);
+    auto quals = QualityCodec::decompress(block.substr(pos));
+    if (quals.size() != reads.size())
+      throw std::runtime_error("ReadArchive: corrupted qualities");
+    for (auto i = 0u; i < reads.size(); i++) reads[i].qual = std::move(quals[i]);
+    return reads;
+  }
+
+ private:
+  auto
+  write_blocks(Serializer::Writer& writer,
+               std::span<const FastqRecord<>> reads,
+               std::vector<std::uint64_t>& offsets,
+               std::vector<std::uint64_t>& firsts) const {
+    const auto blocks = (reads.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    auto compressed = std::vector<std::string>(blocks);
+    tbb::parallel_for(std::size_t{}, blocks, [&](auto b) {
+      compressed[b] = compress_block(reads.subspan(
+        b * BLOCK_SIZE, std::min(BLOCK_SIZE, reads.size() - b * BLOCK_SIZE)));
+    });
+    for (auto b = 0u; b < blocks; b++) {
+      writer.write(compressed[b].data(), compressed[b].size());
+      offsets.push_back(writer.offset);
+      firsts.push_back(
+        firsts.back() + std::min(BLOCK_SIZE, reads.size() - b * BLOCK_SIZE));
+    }
+  }
+
+  auto
+  write_index(Serializer::Writer& writer,
+              const std::vector<std::uint64_t>& offsets,
+              const std::vector<std::uint64_t>& firsts) const {
+    const auto index = std::uint64_t{writer.offset};
+    writer.save(offsets);
+    writer.save(firsts);
+    writer.save(index);
+  }
+
+ public:
+  /**
+   * @brief Write an archive of reads, compressing blocks in parallel. The
+   * stream has to start at the beginning of the archive.
+   */
+  auto
+  save(std::span<const FastqRecord<>> reads, std::ostream& os) const {
+    if (BLOCK_SIZE == 0)
+      throw std::invalid_argument("ReadArchive: BLOCK_SIZE must be > 0");
+    auto writer = Serializer::Writer{os};
+    writer.save(MAGIC);
+    auto offsets = std::vector<std::uint64_t>{writer.offset};
+    auto firsts = std::vector<std::uint64_t>{0};
+    write_blocks(writer, reads, offsets, firsts);
+    write_index(writer, offsets, firsts);
+  }
+
+  /**
+   * @brief Write an archive of the reads of a FASTQ stream, reading as many
+   * blocks at once as there are threads.
+   */
+  auto
+  save(std::istream& is, std::ostream& os) const {
+    if (BLOCK_SIZE == 0)
+      throw std::invalid_argument("ReadArchive: BLOCK_SIZE must be > 0");
+    auto writer = Serializer::Writer{os};
+    writer.save(MAGIC);
+    auto offsets = std::vector<std::uint64_t>{writer.offset};
+    auto firsts = std::vector<std::uint64_t>{0};
+    const auto batch_size
+      = BLOCK_SIZE * tbb::this_task_arena::max_concurrency();
+    auto batch = std::vector<FastqRecord<>>{};
+    do {
+      batch.clear();
+      for (auto read = FastqRecord<>{};
+           batch.size() < batch_size && is >> read;)
+        batch.push_back(std::move(read));
+      write_blocks(writer, batch, offsets, firsts);
+    } while (batch.size() == batch_size);
+    write_index(writer, offsets, firsts);
+  }
+
+  /**
+   * @brief Memory map an archive written by save().
+   */
+  auto
+  load(const std::filesystem::path& path) {
+    auto reader = Serializer::Reader{path};
+    if (reader.value<std::uint64_t>() != MAGIC)
+      throw std::runtime_error("ReadArchive: " + path.string()
+                               + " is not a read archive");
+    if (reader.file->size < 2 * sizeof(std::uint64_t))
+      throw std::runtime_error("ReadArchive: truncated archive");
+    reader.offset = reader.file->size - sizeof(std::uint64_t);
+    reader.offset = reader.value<std::uint64_t>();
+    block_offsets = reader.array<std::uint64_t>();
+    block_reads = reader.array<std::uint64_t>();
+    if (block_offsets.empty() || block_offsets.size() != block_reads.size()
+        || block_offsets[block_offsets.size() - 1] > reader.file->size)
+      throw std::runtime_error("ReadArchive: corrupted index");
+    file = reader.file;
+  }
+
+  /**
+   * @brief Number of reads.
+   */
+  auto
+  size() const noexcept {
+    return block_reads.empty() ? std::uint64_t{}
+                               : block_reads[block_reads.size() - 1];
+  }
+
+  /**
+   * @brief Number of blocks.
+   */
+  auto
+  blocks() const noexcept {
+    return block_reads.empty() ? std::size_t{} : block_reads.size() - 1;
+  }
+
+  /**
+   * @brief Decompress the reads of a block.
+   */
+  auto
+  block(std::size_t b) const {
+    const auto data = reinterpret_cast<const char*>(file->data);
+    return decompress_block(
+      {data + block_offsets[b], block_offsets[b + 1] - block_offsets[b]});
+  }
+
+  /**
+   * @brief Block holding a read.
+   */
+  auto
+  block_of(std::uint64_t read) const {
+    return std::size_t(std::ranges::upper_bound(block_reads, read)
+                       - block_reads.begin() - 1);
+  }
+
+  /**
+   * @brief Decompress the reads from first to last, excluding last, whose
+   * blocks are decompressed in parallel.
+   */
+  auto
+  read(std::uint64_t first, std::uint64_t last) const {
+    if (first > last || last > size())
+      throw std::out_of_range("ReadArchive: reads out of range");
+    auto reads = std::vector<FastqRecord<>>(last - first);
+    if (first == last)
+      return reads;
+    const auto begin = block_of(first), end = block_of(last - 1) + 1;
+    tbb::parallel_for(begin, end, [&](auto b) {
+      auto decoded = block(b);
+      const auto from = std::max(first, block_reads[b]);
+      const auto to = std::min(last, block_reads[b + 1]);
+      for (auto i = from; i < to; i++)
+        reads[i - first] = std::move(decoded[i - block_reads[b]]);
+    });
+    return reads;
+  }
+
+  /**
+   * @brief Decompress a single read.
+   */
+  auto
+  get(std::uint64_t i) const {
+    return std::move(read(i, i + 1).front());
+  }
+};
+
+}  // namespace biovoltron
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace biovoltron {
+
+/**
+ * @ingroup utility
+ * @brief Read-only memory mapping of a whole file.
+ */
+struct MappedFile {
+  const std::byte* data = nullptr;
+  std::size_t size{};
+
+  MappedFile() = default;
+
+  explicit MappedFile(const std::filesystem::path& path) {
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+      throw std::runtime_error("MappedFile: cannot open " + path.string());
+    struct stat st {};
+    ::fstat(fd, &st);
+    size = st.st_size;
+    if (size != 0) {
+      auto* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("MappedFile: cannot map " + path.string());
+      }
+      data = static_cast<const std::byte*>(addr);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile&
+  operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data != nullptr)
+      ::munmap(const_cast<std::byte*>(data), size);
+  }
+};
+
+/**
+ * @ingroup utility
+ * @brief A read-only array which either owns its elements or views them in a
+ * MappedFile, so that indexes can be used right after being mapped.
+ *
+ * @tparam T A trivially copyable element type.
+ */
+template<class T>
+struct MappedVector {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  std::vector<T> owned;
+  std::span<const T> mapped;
+  std::shared_ptr<const MappedFile> file;
+
+  MappedVector() = default;
+  MappedVector(std::vector<T> owned) : owned(std::move(owned)) { }
+  MappedVector(std::span<const T> mapped,
+               std::shared_ptr<const MappedFile> file)
+  : mapped(mapped), file(std::move(file)) { }
+
+  auto
+  data() const noexcept {
+    return file ? mapped.data() : owned.data();
+  }
+
+  auto
+  size() const noexcept {
+    return file ? mapped.size() : owned.size();
+  }
+
+  auto
+  empty() const noexcept {
+    return size() == 0;
+  }
+
+  auto&
+  operator[](std::size_t i) const noexcept {
+    return data()[i];
+  }
+
+  auto
+  begin() const noexcept {
+    return data();
+  }
+
+  auto
+  end() const noexcept {
+    return data() + size();
+  }
+
+  operator std::span<const T>() const noexcept { return {data(), size()}; }
+};
+
+/**
+ * @ingroup utility
+ * @brief Binary archive for values and random access ranges.
+ *
+ * Ranges are written as their size followed by their elements, which are
+ * padded to start at a multiple of ALIGNMENT from the beginning of the
+ * archive. Offsets are counted from the bytes written or read, so archives
+ * go through pipes as well, and may start anywhere in a stream. An archive
+ * can either be loaded back from a stream, or memory mapped with
+ * Serializer::Reader and used in place when it starts the file.
+ * Serializer::save() and Serializer::load() write and read a single value as
+ * an archive of its own.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <biovoltron/utility/archive/serializer.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   {
+ *     auto fout = std::ofstream{"data.bin", std::ios::binary};
+ *     auto writer = Serializer::Writer{fout};
+ *     writer.save(42u);
+ *     writer.save(std::vector{1, 2, 3});
+ *   }
+ *   {
+ *     auto fin = std::ifstream{"data.bin", std::ios::binary};
+ *     auto loader = Serializer::Loader{fin};
+ *     auto value = 0u;
+ *     auto array = std::vector<int>{};
+ *     loader.load(value);
+ *     loader.load(array);
+ *   }
+ *   auto reader = Serializer::Reader{"data.bin"};
+ *   auto value = reader.value<unsigned>();  // 42
+ *   auto array = reader.array<int>();       // MappedVector{1, 2, 3}
+ * }
+ * ```
+ */
+struct Serializer {
+  constexpr static auto ALIGNMENT = std::size_t{64};
+
+ private:
+  static auto
+  padding(std::size_t pos) noexcept {
+    return (ALIGNMENT - pos % ALIGNMENT) % ALIGNMENT;
+  }
+
+ public:
+  /**
+   * @brief Sequential writer of an archive to a stream.
+   */
+  struct Writer {
+    std::ostream& os;
+
+    /**
+     * @brief Bytes written from the beginning of the archive.
+     */
+    std::size_t offset{};
+
+    /**
+     * @brief Write raw bytes, which are not padded.
+     */
+    auto
+    write(const void* data, std::size_t size) {
+      os.write(static_cast<const char*>(data), size);
+      if (!os)
+        throw std::runtime_error("Serializer: cannot write archive");
+      offset += size;
+    }
+
+    /**
+     * @brief Write a trivially copyable value.
+     */
+    template<class T>
+      requires std::is_trivially_copyable_v<T> && (!std::ranges::range<T>)
+    auto
+    save(const T& value) {
+      write(&value, sizeof(T));
+    }
+
+    /**
+     * @brief Write a random access range of trivially copyable elements.
+     */
+    template<std::ranges::random_access_range R>
+    auto
+    save(const R& range) {
+      using T = std::ranges::range_value_t<R>;
+      save(std::uint64_t(std::ranges::size(range)));
+      const auto zeros = std::array<char, ALIGNMENT>{};
+      write(zeros.data(), padding(offset));
+      if constexpr (std::ranges::contiguous_range<R>)
+        write(std::ranges::data(range), std::ranges::size(range) * sizeof(T));
+      else
+        for (const T value : range) save(value);
+    }
+  };
+
+  /**
+   * @brief Sequential loader of an archive from a stream, which throws if
+   * the archive ends early.
+   */
+  struct Loader {
+    std::istream& is;
+
+    /**
+     * @brief Bytes read from the beginning of the archive.
+     */
+    std::size_t offset{};
+
+    /**
+     * @brief Read raw bytes.
+     */
+    auto
+    read(void* data, std::size_t size) {
+      is.read(static_cast<char*>(data), size);
+      if (!is)
+        throw std::runtime_error("Serializer: unexpected end of archive");
+      offset += size;
+    }
+
+    /**
+     * @brief Read a trivially copyable value.
+     */
+    template<class T>
+      requires std::is_trivially_copyable_v<T> && (!std::ranges::range<T>)
+    auto
+    load(T& value) {
+      read(&value, sizeof(T));
+    }
+
+    /**
+     * @brief Read a random access range written by Writer::save().
+     */
+    template<std::ranges::random_access_range R>
+    auto
+    load(R& range) {
+      using T = std::ranges::range_value_t<R>;
+      auto size = std::uint64_t{};
+      load(size);
+      auto zeros = std::array<char, ALIGNMENT>{};
+      read(zeros.data(), padding(offset));
+      if constexpr (requires { range.resize(size); })
+        range.resize(size);
+      else if (size != std::ranges::size(range))
+        throw std::runtime_error("Serializer: size mismatch");
+      if constexpr (std::ranges::contiguous_range<R>)
+        read(std::ranges::data(range), size * sizeof(T));
+      else
+        for (auto i = 0u; i < size; i++) {
+          auto value = T{};
+          load(value);
+          range[i] = value;
+        }
+    }
+  };
+
+  /**
+   * @brief Append an unsigned integer to a byte string as a varint, seven
+   * bits per byte with the high bit set on all but the last.
+   */
+  static auto
+  put_varint(std::string& out, std::uint64_t value) {
+    for (; value >= 0x80; value >>= 7) out += char((value & 0x7f) | 0x80);
+    out += char(value);
+  }
+
+  /**
+   * @brief Read a varint written by put_varint() at pos, and move pos past
+   * it.
+   */
+  static auto
+  get_varint(std::string_view in, std::size_t& pos) {
+    auto value = std::uint64_t{};
+    for (auto shift = 0;; shift += 7) {
+      if (pos >= in.size() || shift > 63)
+        throw std::runtime_error("Serializer: truncated varint");
+      const auto byte = std::uint8_t(in[pos++]);
+      value |= std::uint64_t{byte & 0x7fu} << shift;
+      if (byte < 0x80)
+        return value;
+    }
+  }
+
+  /**
+   * @brief Write a value or a range as an archive of its own.
+   */
+  static auto
+  save(std::ostream& os, const auto& value) {
+    Writer{os}.save(value);
+  }
+
+  /**
+   * @brief Read a value or a range written by save().
+   */
+  static auto
+  load(std::istream& is, auto& value) {
+    Loader{is}.load(value);
+  }
+
+  /**
+   * @brief Sequential reader over a memory mapped archive.
+   */
+  struct Reader {
+    std::shared_ptr<const MappedFile> file;
+    std::size_t offset{};
+
+    explicit Reader(const std::filesystem::path& path)
+    : file(std::make_shared<const MappedFile>(path)) { }
+
+    template<class T>
+    auto
+    value() {
+      auto value = T{};
+      if (offset + sizeof(T) > file->size)
+        throw std::runtime_error("Serializer: unexpected end of archive");
+      std::memcpy(&value, file->data + offset, sizeof(T));
+      offset += sizeof(T);
+      return value;
+    }
+
+    template<class T>
+    auto
+    array() {
+      const auto size = value<std::uint64_t>();
+      offset += padding(offset);
+      if (offset + size * sizeof(T) > file->size)
+        throw std::runtime_error("Serializer: unexpected end of archive");
+      const auto* begin = reinterpret_cast<const T*>(file->data + offset);
+      offset += size * sizeof(T);
+      return MappedVector<T>{std::span{begin, size}, file};
+    }
+  };
+};
+
+}  // namespace biovoltron
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace biovoltron {
+
+/**
+ * @ingroup utility
+ * @brief Hash functions of integer keys.
+ */
+struct HashUtils {
+  /**
+   * @brief Finalizer of MurmurHash3, a bijection of 64-bit integers which
+   * spreads every bit of the key over the whole hash.
+   */
+  constexpr static auto
+  fmix64(std::uint64_t key) noexcept {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    return key ^ key >> 33;
+  }
+};
+
+}  // namespace biovoltron
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <biovoltron/utility/istring.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+
+namespace biovoltron {
+
+/**
+ * @ingroup utility
+ * @brief A k-mer of a sequence with its 2-bit keys, as produced by KmerView.
+ */
+struct Kmer {
+  /**
+   * @brief Key of the k-mer, equal to Codec::hash.
+   */
+  std::uint64_t fwd{};
+
+  /**
+   * @brief Key of the reverse complement of the k-mer.
+   */
+  std::uint64_t rev{};
+
+  /**
+   * @brief Offset of the first base of the k-mer in the sequence.
+   */
+  std::size_t pos{};
+
+  /**
+   * @brief Strand independent key, the smaller of fwd and rev.
+   */
+  constexpr auto
+  canonical() const noexcept {
+    return std::min(fwd, rev);
+  }
+
+  friend constexpr bool
+  operator==(const Kmer&, const Kmer&) = default;
+};
+
+/**
+ * @ingroup utility
+ * @brief View of the k-mers of a sequence of bases, whose keys are rolled in
+ * O(1) per base.
+ *
+ * The sequence may be a std::string or an istring. K-mers containing an
+ * ambiguous base are skipped. K must be in [1, 32], otherwise the view is
+ * empty.
+ *
+ * Example
+ * ```cpp
+ * #include <iostream>
+ * #include <biovoltron/utility/kmer_view.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   for (const auto kmer : std::string{"ACGTNACG"} | views::kmers(3))
+ *     std::cout << kmer.pos << " " << kmer.fwd << " " << kmer.rev << "\n";
+ *   // Output:
+ *   // 0 6 27
+ *   // 1 27 6
+ *   // 5 6 27
+ * }
+ * ```
+ *
+ * @tparam V A view of char or ichar.
+ */
+template<std::ranges::view V>
+  requires std::ranges::input_range<V>
+struct KmerView : std::ranges::view_interface<KmerView<V>> {
+ private:
+  V base_ = V{};
+  unsigned k_{};
+
+  struct sentinel { };
+
+  struct iterator {
+    using iterator_concept
+      = std::conditional_t<std::ranges::forward_range<V>,
+                           std::forward_iterator_tag, std::input_iterator_tag>;
+    using value_type = Kmer;
+    using difference_type = std::ptrdiff_t;
+
+    std::ranges::iterator_t<V> cur{};
+    std::ranges::sentinel_t<V> end{};
+    unsigned k{};
+    std::uint64_t mask{};
+    std::size_t size{};
+    unsigned valid{};
+    bool done{};
+    Kmer kmer;
+
+    constexpr auto
+    next() {
+      for (; cur != end; ++cur) {
+        const auto c = [](auto c) {
+          if constexpr (std::same_as<decltype(c), char>)
+            return Codec::to_int(c);
+          else
+            return ichar(c);
+        }(*cur);
+        size++;
+        if (c < 0 || c > 3) {
+          valid = 0;
+          continue;
+        }
+        kmer.fwd = (kmer.fwd << 2 | c) & mask;
+        kmer.rev = kmer.rev >> 2 | std::uint64_t(3 - c) << 2 * (k - 1);
+        if (++valid >= k) {
+          kmer.pos = size - k;
+          ++cur;
+          return;
+        }
+      }
+      done = true;
+    }
+
+    constexpr const auto&
+    operator*() const noexcept {
+      return kmer;
+    }
+
+    constexpr auto&
+    operator++() {
+      next();
+      return *this;
+    }
+
+    constexpr auto
+    operator++(int) {
+      if constexpr (std::ranges::forward_range<V>) {
+        auto tmp = *this;
+        next();
+        return tmp;
+      } else
+        next();
+    }
+
+    friend constexpr bool
+    operator==(const iterator& a, const iterator& b)
+      requires std::ranges::forward_range<V>
+    {
+      return a.done == b.done && a.cur == b.cur;
+    }
+
+    friend constexpr bool
+    operator==(const iterator& it, sentinel) noexcept {
+      return it.done;
+    }
+  };
+
+ public:
+  KmerView() = default;
+
+  constexpr KmerView(V base, unsigned k) : base_(std::move(base)), k_(k) { }
+
+  constexpr auto
+  begin() {
+    auto it = iterator{std::ranges::begin(base_), std::ranges::end(base_), k_,
+                       k_ >= 32 ? ~0ull : (1ull << 2 * k_) - 1};
+    if (k_ == 0 || k_ > 32)
+      it.done = true;
+    else
+      it.next();
+    return it;
+  }
+
+  constexpr auto
+  end() const noexcept {
+    return sentinel{};
+  }
+};
+
+template<class R>
+KmerView(R&&, unsigned) -> KmerView<std::views::all_t<R>>;
+
+namespace views {
+
+struct KmersClosure {
+  unsigned k;
+
+  template<std::ranges::viewable_range R>
+  friend constexpr auto
+  operator|(R&& seq, KmersClosure self) {
+    return KmerView{std::forward<R>(seq), self.k};
+  }
+};
+
+/**
+ * @ingroup utility
+ * @brief Range adaptor of KmerView, `seq | views::kmers(k)` or
+ * `views::kmers(seq, k)`.
+ */
+inline constexpr struct {
+  template<std::ranges::viewable_range R>
+  constexpr auto
+  operator()(R&& seq, unsigned k) const {
+    return KmerView{std::forward<R>(seq), k};
+  }
+
+  constexpr auto
+  operator()(unsigned k) const {
+    return KmersClosure{k};
+  }
+} kmers;
+
+}  // namespace views
+
+}  // namespace biovoltron
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <biovoltron/file_io/cigar.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace biovoltron {
+
+/**
+ * @ingroup utility
+ * @brief Projection of positions between a read and the reference through
+ * the Cigar of its alignment.
+ *
+ * The read and reference offsets at which each element of the Cigar begins
+ * are computed once, so a position is projected by a binary search over the
+ * elements instead of a walk. Read offsets count every base of the SEQ,
+ * soft clipped ones included, and hard clipped bases are not part of the
+ * read. Reads bases in `I` and `S` have no reference position, and
+ * reference positions in `D` and `N` have no read offset.
+ *
+ * Example
+ * ```cpp
+ * #include <iostream>
+ * #include <biovoltron/file_io/sam.hpp>
+ * #include <biovoltron/utility/read/cigar_projection.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto record = SamRecord<>{};
+ *   record.pos = 101;
+ *   record.cigar = "2S3M1I2M4D3M";
+ *   record.seq = "AACGTTCAGGG";
+ *   const auto projection = CigarProjection{record.cigar, record.begin()};
+ *   std::cout << *projection.ref_pos(2) << "\n";
+ *   // Output: 100
+ *   std::cout << projection.ref_pos(5).has_value() << "\n";
+ *   // Output: 0
+ *   std::cout << projection.project(record.seq, '-') << "\n";
+ *   // Output: CGTCA----GGG
+ * }
+ * ```
+ */
+struct CigarProjection {
+  /**
+   * @brief An element of the Cigar with the offsets at which it begins.
+   */
+  struct Segment {
+    std::uint32_t read_begin{};
+    std::uint32_t ref_begin{};
+    Cigar::Element element;
+  };
+
+  /**
+   * @brief Segments in the order of the Cigar.
+   */
+  std::vector<Segment> segments;
+
+  /**
+   * @brief Number of bases of the read, soft clipped ones included.
+   */
+  std::uint32_t read_size{};
+
+  /**
+   * @brief Reference position of the first aligned base.
+   */
+  std::uint32_t ref_begin{};
+
+  /**
+   * @brief Reference position past the last aligned base.
+   */
+  std::uint32_t ref_end{};
+
+  CigarProjection() = default;
+
+  /**
+   * @param cigar Cigar of the alignment.
+   * @param ref_begin Reference position of the first aligned base, e.g.
+   * SamRecord::begin().
+   */
+  CigarProjection(const Cigar& cigar, std::uint32_t ref_begin = 0)
+  : read_size(cigar.read_size()), ref_begin(ref_begin) {
+    segments.reserve(cigar.size());
+    auto read_pos = 0u, ref_pos = ref_begin;
+    for (const auto element : cigar) {
+      segments.push_back({read_pos, ref_pos, element});
+      if (Cigar::consumes_read(element.op))
+        read_pos += element.size;
+      if (Cigar::consumes_ref(element.op))
+        ref_pos += element.size;
+    }
+    ref_end = ref_pos;
+  }
+
+  /**
+   * @brief Reference position aligned with a read offset, none if the base is
+   * inserted, soft clipped or beyond the read.
+   */
+  auto
+  ref_pos(std::uint32_t read_offset) const -> std::optional<std::uint32_t> {
+    // The last segment beginning at or before the offset is the one
+    // consuming it, since segments which do not consume read bases have the
+    // same read_begin as the next one.
+    const auto it = std::ranges::upper_bound(segments, read_offset,
+                                             std::less{}, &Segment::read_begin);
+    if (it == segments.begin())
+      return {};
+    const auto& [read_begin, ref_begin, element] = *std::prev(it);
+    if (read_offset - read_begin >= element.size
+        || !Cigar::consumes_read(element.op)
+        || !Cigar::consumes_ref(element.op))
+      return {};
+    return ref_begin + (read_offset - read_begin);
+  }
+
+  /**
+   * @brief Read offset aligned with a reference position, none if the
+   * position is deleted, skipped or outside of the alignment.
+   */
+  auto
+  read_offset(std::uint32_t ref_pos) const -> std::optional<std::uint32_t> {
+    const auto it = std::ranges::upper_bound(segments, ref_pos, std::less{},
+                                             &Segment::ref_begin);
+    if (it == segments.begin())
+      return {};
+    const auto& [read_begin, ref_begin, element] = *std::prev(it);
+    if (ref_pos - ref_begin >= element.size
+        || !Cigar::consumes_ref(element.op)
+        || !Cigar::consumes_read(element.op))
+      return {};
+    return read_begin + (ref_pos - ref_begin);
+  }
+
+  /**
+   * @brief Reference position of each read offset, -1 for inserted and soft
+   * clipped bases.
+   */
+  auto
+  ref_positions() const {
+    auto positions = std::vector<std::int64_t>(read_size, -1);
+    for (const auto& [read_begin, ref_begin, element] : segments)
+      if (Cigar::consumes_read(element.op) && Cigar::consumes_ref(element.op))
+        for (auto i = 0u; i < element.size; i++)
+          positions[read_begin + i] = ref_begin + i;
+    return positions;
+  }
+
+  /**
+   * @brief Read offset of each reference position from ref_begin to
+   * ref_end, -1 for deleted and skipped positions.
+   */
+  auto
+  read_offsets() const {
+    auto offsets = std::vector<std::int64_t>(ref_end - ref_begin, -1);
+    for (const auto& [read_begin, ref_begin, element] : segments)
+      if (Cigar::consumes_read(element.op) && Cigar::consumes_ref(element.op))
+        for (auto i = 0u; i < element.size; i++)
+          offsets[ref_begin - this->ref_begin + i] = read_begin + i;
+    return offsets;
+  }
+
+  /**
+   * @brief Lay a read, e.g. SamRecord::seq or SamRecord::qual, along the
+   * reference from ref_begin to ref_end. Inserted and clipped bases are
+   * dropped, and deleted and skipped positions are filled with gap.
+   *
+   * @param read A string as long as the read.
+   */
+  template<class R>
+  auto
+  project(const R& read, typename R::value_type gap) const {
+    auto projected = R(ref_end - ref_begin, gap);
+    for (const auto& [read_begin, ref_begin, element] : segments)
+      if (Cigar::consumes_read(element.op) && Cigar::consumes_ref(element.op))
+        std::copy_n(read.begin() + read_begin, element.size,
+                    projected.begin() + (ref_begin - this->ref_begin));
+    return projected;
+  }
+};
+
+}  // namespace biovoltron
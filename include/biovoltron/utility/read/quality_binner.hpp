@@ -0,0 +1,124 @@
+#pragma once
+
+#include <biovoltron/utility/read/quality_utils.hpp>
+#include <algorithm>
+#include <immintrin.h>
+#include <span>
+#include <string>
+
+namespace biovoltron {
+
+/**
+ * @ingroup utility
+ * @brief Lossy binning of Phred+33 quality strings, e.g. FastqRecord::qual
+ * or SamRecord::qual, to a few levels which compress much better.
+ *
+ * Qualities are mapped in place through a table of ASCII characters, 32 at a
+ * time with AVX2: the low nibble of a character indexes a 16-entry shuffle
+ * of the row of its high nibble. Characters outside of the table, and the
+ * "*" of a SamRecord without qualities, are left unchanged.
+ *
+ * Example
+ * ```cpp
+ * #include <fstream>
+ * #include <biovoltron/utility/read/quality_binner.hpp>
+ * #include <biovoltron/file_io/fasta.hpp>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   const auto binner = QualityBinner::illumina8();
+ *   auto fin = std::ifstream{"sample.fq"};
+ *   auto fout = std::ofstream{"binned.fq"};
+ *   for (auto read = FastqRecord<>{}; fin >> read;) {
+ *     binner.bin(read);
+ *     fout << read << "\n";
+ *   }
+ * }
+ * ```
+ */
+struct QualityBinner {
+  /**
+   * @brief Binned character of each ASCII character.
+   */
+  std::array<char, 128> table = [] {
+    auto table = std::array<char, 128>{};
+    for (auto c = 0; c < table.size(); c++) table[c] = c;
+    return table;
+  }();
+
+  /**
+   * @brief Binner mapping the Phred scores from each lower bound up to the
+   * next one to a value, and the scores below the first bound to themselves.
+   *
+   * @param bounds Ascending lower bounds of the bins.
+   * @param values Phred score of each bin.
+   */
+  static auto
+  from_bins(std::span<const int> bounds, std::span<const int> values) {
+    if (bounds.size() != values.size()
+        || !std::ranges::is_sorted(bounds, std::less_equal{}))
+      throw std::invalid_argument("QualityBinner: invalid bins");
+    auto binner = QualityBinner{};
+    constexpr auto offset = QualityUtils::ASCII_OFFSET;
+    for (auto c = int(offset); c < binner.table.size(); c++) {
+      const auto bin = std::ranges::upper_bound(bounds, c - offset);
+      if (bin != bounds.begin())
+        binner.table[c] = offset + values[bin - bounds.begin() - 1];
+    }
+    return binner;
+  }
+
+  /**
+   * @brief The 8-level binning of Illumina: 2-9 to 6, 10-19 to 15, 20-24 to
+   * 22, 25-29 to 27, 30-34 to 33, 35-39 to 37 and 40 and above to 40.
+   */
+  static auto
+  illumina8() {
+    constexpr auto bounds = std::array{2, 10, 20, 25, 30, 35, 40};
+    constexpr auto values = std::array{6, 15, 22, 27, 33, 37, 40};
+    return from_bins(bounds, values);
+  }
+
+  /**
+   * @brief Bin a quality string in place.
+   */
+  auto
+  bin(std::string& qual) const {
+    if (qual == "*")
+      return;
+    auto rows = std::array<__m256i, 8>{};
+    for (auto r = 0; r < 8; r++)
+      rows[r] = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&table[r * 16])));
+    const auto data = reinterpret_cast<std::uint8_t*>(qual.data());
+    const auto nibble = _mm256_set1_epi8(0x0f);
+    auto i = std::size_t{};
+    for (; i + 32 <= qual.size(); i += 32) {
+      const auto p = reinterpret_cast<__m256i*>(data + i);
+      auto v = _mm256_loadu_si256(p);
+      const auto lo = _mm256_and_si256(v, nibble);
+      const auto hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+      // Rows 0 and 1 are control characters, which are not qualities.
+      for (auto r = 2; r < 8; r++)
+        v = _mm256_blendv_epi8(
+          v, _mm256_shuffle_epi8(rows[r], lo),
+          _mm256_cmpeq_epi8(hi, _mm256_set1_epi8(r)));
+      _mm256_storeu_si256(p, v);
+    }
+    for (; i < qual.size(); i++)
+      if (data[i] < table.size())
+        data[i] = table[data[i]];
+  }
+
+  /**
+   * @brief Bin the qualities of a record, e.g. a FastqRecord or a SamRecord.
+   */
+  template<class R>
+    requires requires(R r) { r.qual; }
+  auto
+  bin(R& record) const {
+    bin(record.qual);
+  }
+};
+
+}  // namespace biovoltron
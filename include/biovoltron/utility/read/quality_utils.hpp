@@ -2,25 +2,144 @@
 
 #include <array>
 #include <cmath>
+#include <cstdint>
+#include <immintrin.h>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+#include <string_view>
 
 namespace biovoltron {
 
+/**
+ * @ingroup utility
+ * @brief Conversions between Phred quality scores and probabilities.
+ *
+ * Scalar conversions take a Phred score, e.g. qual[i] - ASCII_OFFSET, and are
+ * lookups in tables computed at compile time. Batch conversions take a whole
+ * Phred+33 quality string, e.g. FastqRecord::qual, and gather 8 floats at a
+ * time with AVX2.
+ */
 struct QualityUtils {
   static constexpr char ASCII_OFFSET = '!';
 
-  static double
-  qual_to_error_prob(char qual) {
-    return qual_to_error_prob_cache[qual];
+ private:
+  constexpr static auto make_table = [](auto f) {
+    auto table = std::array<double, 256>{};
+    for (auto qual = 0; qual < table.size(); qual++) table[qual] = f(qual);
+    return table;
+  };
+
+  constexpr static auto error_prob = [](int qual) {
+    return std::pow(10.0, qual / -10.0);
+  };
+
+  /*
+   * log(1 - 10^(-qual / 10)), with log1p to keep precision at high quality.
+   */
+  constexpr static auto prob_ln = [](int qual) {
+    return qual == 0 ? -std::numeric_limits<double>::infinity()
+                     : std::log1p(-error_prob(qual));
+  };
+
+  constexpr static auto error_prob_cache = make_table(error_prob);
+
+  constexpr static auto prob_cache
+    = make_table([](int qual) { return 1 - error_prob(qual); });
+
+  constexpr static auto error_prob_log10_cache
+    = make_table([](int qual) { return qual / -10.0; });
+
+  constexpr static auto prob_log10_cache = make_table(
+    [](int qual) { return prob_ln(qual) / std::numbers::ln10; });
+
+  constexpr static auto error_prob_ln_cache = make_table(
+    [](int qual) { return qual / -10.0 * std::numbers::ln10; });
+
+  constexpr static auto prob_ln_cache = make_table(prob_ln);
+
+  /*
+   * Tables of floats by ASCII character, for the batch conversions.
+   */
+  constexpr static auto make_ascii_table = [](auto f) {
+    auto table = std::array<float, 256>{};
+    for (auto c = 0; c < table.size(); c++)
+      table[c] = f(std::max(c - ASCII_OFFSET, 0));
+    return table;
+  };
+
+  constexpr static auto ascii_error_prob_cache = make_ascii_table(error_prob);
+
+  constexpr static auto ascii_error_prob_log10_cache
+    = make_ascii_table([](int qual) { return qual / -10.0; });
+
+  constexpr static auto ascii_prob_log10_cache = make_ascii_table(
+    [](int qual) { return prob_ln(qual) / std::numbers::ln10; });
+
+  static auto
+  convert(std::string_view qual, std::span<float> out,
+          const std::array<float, 256>& table) {
+    if (out.size() < qual.size())
+      throw std::invalid_argument("QualityUtils: output is too small");
+    const auto data = reinterpret_cast<const std::uint8_t*>(qual.data());
+    auto i = std::size_t{};
+    for (; i + 8 <= qual.size(); i += 8) {
+      const auto index = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + i)));
+      _mm256_storeu_ps(out.data() + i,
+                       _mm256_i32gather_ps(table.data(), index, 4));
+    }
+    for (; i < qual.size(); i++) out[i] = table[data[i]];
+  }
+
+ public:
+  /**
+   * @brief Probability that a base of a Phred score is wrong.
+   */
+  static auto
+  qual_to_error_prob(std::uint8_t qual) noexcept {
+    return error_prob_cache[qual];
   }
 
+  /**
+   * @brief Probability that a base of a Phred score is right.
+   */
   static auto
-  qual_to_error_prob_log10(double qual) {
-    return qual / -10.0;
+  qual_to_prob(std::uint8_t qual) noexcept {
+    return prob_cache[qual];
   }
 
+  /**
+   * @brief log10 of qual_to_error_prob().
+   */
   static auto
-  qual_to_prob_log10(double qual) {
-    return std::log10(1 - qual_to_error_prob(qual));
+  qual_to_error_prob_log10(std::uint8_t qual) noexcept {
+    return error_prob_log10_cache[qual];
+  }
+
+  /**
+   * @brief log10 of qual_to_prob(), -inf for a Phred score of 0.
+   */
+  static auto
+  qual_to_prob_log10(std::uint8_t qual) noexcept {
+    return prob_log10_cache[qual];
+  }
+
+  /**
+   * @brief Natural logarithm of qual_to_error_prob().
+   */
+  static auto
+  qual_to_error_prob_ln(std::uint8_t qual) noexcept {
+    return error_prob_ln_cache[qual];
+  }
+
+  /**
+   * @brief Natural logarithm of qual_to_prob(), -inf for a Phred score of 0.
+   */
+  static auto
+  qual_to_prob_ln(std::uint8_t qual) noexcept {
+    return prob_ln_cache[qual];
   }
 
   static auto
@@ -28,13 +147,33 @@ struct QualityUtils {
     return -10.0 * std::log10(error_rate);
   }
 
- private:
-  constexpr static auto qual_to_error_prob_cache = [] {
-    auto qual_to_error_prob_cache = std::array<double, 128>{};
-    for (auto qual = 0; qual < qual_to_error_prob_cache.size(); qual++)
-      qual_to_error_prob_cache[qual] = std::pow(10, qual / -10.0);
-    return qual_to_error_prob_cache;
-  }();
+  /**
+   * @brief qual_to_error_prob() of each base of a Phred+33 quality string.
+   * Characters below ASCII_OFFSET are taken as a Phred score of 0.
+   *
+   * @param out At least as long as qual.
+   */
+  static auto
+  quals_to_error_probs(std::string_view qual, std::span<float> out) {
+    convert(qual, out, ascii_error_prob_cache);
+  }
+
+  /**
+   * @brief qual_to_error_prob_log10() of each base of a Phred+33 quality
+   * string.
+   */
+  static auto
+  quals_to_error_prob_log10(std::string_view qual, std::span<float> out) {
+    convert(qual, out, ascii_error_prob_log10_cache);
+  }
+
+  /**
+   * @brief qual_to_prob_log10() of each base of a Phred+33 quality string.
+   */
+  static auto
+  quals_to_prob_log10(std::string_view qual, std::span<float> out) {
+    convert(qual, out, ascii_prob_log10_cache);
+  }
 };
 
 }  // namespace biovoltron
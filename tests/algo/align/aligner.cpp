@@ -0,0 +1,185 @@
+#include <biovoltron/algo/align/aligner.hpp>
+#include <catch.hpp>
+#include <random>
+#include <tbb/global_control.h>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+simulate(std::mt19937& gen, istring_view ref, std::uint32_t pos,
+         std::uint32_t size, bool reverse) {
+  auto seq = istring{ref.substr(pos, size)};
+  for (auto& c : seq)
+    if (gen() % 100 == 0)
+      c = (c + 1 + gen() % 3) % 4;
+  auto read = FastqRecord<true>{};
+  read.seq = reverse ? Codec::rev_comp(seq) : seq;
+  read.qual = std::string(size, 'I');
+  return read;
+}
+
+}  // namespace
+
+TEST_CASE("Aligner") {
+  auto gen = std::mt19937{};
+  auto ref = FastaRecord<true>{"chr"};
+  for (auto i = 0; i < 50000; i++) ref.seq += gen() % 4;
+  // A duplicated segment, which reads should map ambiguously.
+  ref.seq.replace(40000, 500, ref.seq.substr(10000, 500));
+  auto index = FMIndex{.LOOKUP_LEN = 8};
+  index.build(ref);
+  const auto aligner = Aligner{.ref = ref, .index = std::move(index)};
+
+  SECTION("Single-end") {
+    auto reads = std::vector<FastqRecord<true>>{};
+    auto truth = std::vector<std::pair<std::uint32_t, bool>>{};
+    for (auto i = 0; i < 1000; i++) {
+      const auto pos = gen() % (ref.seq.size() - 100);
+      const auto reverse = gen() % 2 == 1;
+      reads.push_back(simulate(gen, ref.seq, pos, 100, reverse));
+      reads.back().name = "r" + std::to_string(i);
+      truth.emplace_back(pos, reverse);
+    }
+    // An indel, ending in a soft clip and a random read.
+    auto indel = simulate(gen, ref.seq, 20000, 100, false);
+    indel.seq.erase(50, 3);
+    reads.push_back(indel);
+    reads.push_back(simulate(gen, istring(100, 0) + ref.seq.substr(0, 40), 0,
+                             140, false));
+    reads.back().seq.erase(0, 60);
+    auto random = FastqRecord<true>{};
+    for (auto i = 0; i < 100; i++) random.seq += gen() % 4;
+    reads.push_back(random);
+
+    const auto records = aligner.align(reads);
+    REQUIRE(records.size() == reads.size());
+    auto correct = 0;
+    for (auto i = 0u; i < truth.size(); i++) {
+      const auto& record = records[i];
+      CHECK(record.qname == reads[i].name);
+      // Ends may be soft clipped at mismatches.
+      if (std::abs(std::int64_t(record.pos) - truth[i].first - 1) <= 10
+          && record.read_reverse_strand() == truth[i].second)
+        correct++;
+      if (!record.read_unmapped()) {
+        CHECK(record.cigar.read_size() == 100);
+        CHECK(record.seq
+              == (truth[i].second ? Codec::rev_comp(reads[i].seq)
+                                  : reads[i].seq));
+      }
+      const auto pos = truth[i].first;
+      const auto repeat = (pos >= 10000 && pos <= 10400)
+                          || (pos >= 40000 && pos <= 40400);
+      if (repeat)
+        CHECK(record.mapq == 0);
+      if (!repeat && record.pos == truth[i].first + 1)
+        CHECK(record.mapq > 20);
+    }
+    CHECK(correct >= 990);
+
+    const auto& deletion = records[truth.size()];
+    CHECK(deletion.pos == 20001);
+    CHECK(deletion.cigar.ref_size() == 100);
+    CHECK(deletion.cigar.read_size() == 97);
+    const auto& clipped = records[truth.size() + 1];
+    CHECK(clipped.pos == 1);
+    CHECK(clipped.cigar.clip_size() == 40);
+    CHECK(records.back().read_unmapped());
+    CHECK(records.back().rname == "*");
+
+    const auto control
+      = tbb::global_control{tbb::global_control::max_allowed_parallelism, 1};
+    const auto serial = Aligner{.ref = ref, .index = aligner.index,
+                                .BATCH_SIZE = 7}.align(reads);
+    for (auto i = 0u; i < reads.size(); i++) {
+      REQUIRE(serial[i].pos == records[i].pos);
+      REQUIRE(serial[i].flag == records[i].flag);
+      REQUIRE(serial[i].mapq == records[i].mapq);
+      REQUIRE(serial[i].cigar == records[i].cigar);
+    }
+  }
+
+  SECTION("Paired-end") {
+    auto reads1 = std::vector<FastqRecord<true>>{};
+    auto reads2 = std::vector<FastqRecord<true>>{};
+    auto truth = std::vector<std::pair<std::uint32_t, std::uint32_t>>{};
+    for (auto i = 0; i < 500; i++) {
+      const auto insert = 200 + gen() % 300;
+      const auto pos = gen() % (ref.seq.size() - insert);
+      const auto pos2 = pos + insert - 100;
+      reads1.push_back(simulate(gen, ref.seq, pos, 100, false));
+      reads2.push_back(simulate(gen, ref.seq, pos2, 100, true));
+      if (i % 2)
+        std::swap(reads1.back(), reads2.back());
+      truth.emplace_back(pos, pos2);
+    }
+    // The second mate is unmappable alone and has to be rescued.
+    reads1.push_back(simulate(gen, ref.seq, 30000, 100, false));
+    reads2.push_back(simulate(gen, ref.seq, 30250, 100, true));
+    for (auto i = 5; i < 100; i += 10) reads2.back().seq[i] ^= 1;
+
+    const auto records = aligner.align(reads1, reads2);
+    REQUIRE(records.size() == reads1.size() * 2);
+    auto proper = 0;
+    for (auto i = 0u; i < truth.size(); i++) {
+      const auto& r1 = records[i * 2];
+      const auto& r2 = records[i * 2 + 1];
+      CHECK(r1.first_of_pair());
+      CHECK(r2.second_of_pair());
+      const auto& fwd = r1.read_reverse_strand() ? r2 : r1;
+      const auto& rev = r1.read_reverse_strand() ? r1 : r2;
+      if (r1.proper_pair()
+          && std::abs(std::int64_t(fwd.pos) - truth[i].first - 1) <= 10
+          && std::abs(std::int64_t(rev.pos) - truth[i].second - 1) <= 10) {
+        proper++;
+        CHECK(r1.pnext == r2.pos);
+        CHECK(r1.rnext == "=");
+        CHECK(std::abs(fwd.tlen - std::int32_t(truth[i].second + 100
+                                               - truth[i].first))
+              <= 20);
+        CHECK(rev.tlen == -fwd.tlen);
+      }
+    }
+    CHECK(proper >= 490);
+
+    const auto& anchor = records[truth.size() * 2];
+    const auto& rescued = records[truth.size() * 2 + 1];
+    CHECK(anchor.proper_pair());
+    CHECK(rescued.pos == 30251);
+    CHECK(rescued.read_reverse_strand());
+    CHECK(anchor.mate_reverse_strand());
+    CHECK(anchor.tlen == 350);
+
+    // The first end lies in the duplicated segment, its mate outside of it.
+    auto dup1 = simulate(gen, ref.seq, 10100, 100, false);
+    auto dup2 = simulate(gen, ref.seq, 10700, 100, true);
+    // An unmappable mate is placed at its mapped end.
+    auto lone1 = simulate(gen, ref.seq, 20000, 100, false);
+    auto lone2 = FastqRecord<true>{};
+    lone2.seq = istring(100, 0);
+    lone2.qual = std::string(100, 'I');
+    const auto pairs
+      = aligner.align(std::vector{dup1, lone1}, std::vector{dup2, lone2});
+    REQUIRE(pairs.size() == 4);
+    CHECK(pairs[0].proper_pair());
+    CHECK(pairs[0].pos == 10101);
+    CHECK(pairs[0].mapq > 20);
+    CHECK(pairs[1].mapq > 20);
+
+    const auto& mapped = pairs[2];
+    const auto& unmapped = pairs[3];
+    CHECK(unmapped.read_unmapped());
+    CHECK(mapped.mate_unmapped());
+    CHECK(unmapped.rname == mapped.rname);
+    CHECK(unmapped.pos == mapped.pos);
+    CHECK(mapped.rnext == "=");
+    CHECK(mapped.pnext == mapped.pos);
+    CHECK(unmapped.rnext == "=");
+    CHECK(unmapped.pnext == mapped.pos);
+
+    CHECK_THROWS_AS(aligner.align(reads1, std::span{reads2}.first(1)),
+                    std::invalid_argument);
+  }
+}
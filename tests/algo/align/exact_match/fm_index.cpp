@@ -0,0 +1,117 @@
+#include <biovoltron/algo/align/exact_match/fm_index.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+naive_offsets(istring_view ref, istring_view seed) {
+  auto offsets = std::vector<std::uint32_t>{};
+  for (auto i = ref.find(seed); i != istring_view::npos;
+       i = ref.find(seed, i + 1))
+    offsets.push_back(i);
+  return offsets;
+}
+
+auto
+sorted_offsets(const FMIndex& index, istring_view seed) {
+  const auto [beg, end, offset] = index.get_range(seed);
+  auto offsets = index.get_offsets(beg, end);
+  std::ranges::sort(offsets);
+  return offsets;
+}
+
+}  // namespace
+
+TEST_CASE("FMIndex") {
+  SECTION("Small reference") {
+    auto index = FMIndex{.SA_INTERVAL = 4, .LOOKUP_LEN = 2};
+    index.build(0123012301_s);
+    CHECK(index.bwt_size == 11);
+    CHECK(sorted_offsets(index, 2301_s) == std::vector<std::uint32_t>{2, 6});
+    CHECK(sorted_offsets(index, 0_s)
+          == std::vector<std::uint32_t>{0, 4, 8});
+    CHECK(sorted_offsets(index, 33_s).empty());
+    CHECK(sorted_offsets(index, 014_s).empty());
+
+    const auto [beg, end, offset] = index.get_range(3012301_s, 2);
+    CHECK(offset == 4);
+    CHECK(end - beg == 2);
+  }
+
+  SECTION("Random reference against naive search") {
+    auto gen = std::mt19937{};
+    auto base = std::uniform_int_distribution<int>{0, 3};
+    auto ref = istring{};
+    for (auto i = 0; i < 5000; i++) ref += base(gen);
+    // Repeats give SA-IS a reduced problem to recurse on.
+    ref += ref.substr(1000, 300);
+    ref += ref.substr(1000, 300);
+
+    for (const auto lookup_len : {0, 4}) {
+      auto index = FMIndex{.SA_INTERVAL = 8, .LOOKUP_LEN = lookup_len};
+      index.build(FastaRecord<true>{"chr", ref});
+      for (auto t = 0; t < 300; t++) {
+        const auto len = 1 + gen() % 20;
+        const auto seed = t % 2 ? ref.substr(gen() % (ref.size() - len), len)
+                                : [&] {
+                                    auto seed = istring{};
+                                    for (auto i = 0u; i < len; i++)
+                                      seed += base(gen);
+                                    return seed;
+                                  }();
+        REQUIRE(sorted_offsets(index, seed) == naive_offsets(ref, seed));
+      }
+    }
+  }
+
+  SECTION("Periodic reference") {
+    auto ref = istring{};
+    for (auto i = 0; i < 3000; i++) ref += i % 7 == 3 ? 2 : i % 3 == 1;
+    ref += istring(500, 0);
+    auto index = FMIndex{.SA_INTERVAL = 4, .LOOKUP_LEN = 3};
+    index.build(ref);
+    for (auto len = 1u; len <= 30; len++)
+      for (const auto begin : {0u, 1000u, 2990u, 3200u}) {
+        const auto seed = ref.substr(begin, len);
+        REQUIRE(sorted_offsets(index, seed) == naive_offsets(ref, seed));
+      }
+  }
+
+  SECTION("Save and load") {
+    auto gen = std::mt19937{};
+    auto base = std::uniform_int_distribution<int>{0, 3};
+    auto ref = istring{};
+    for (auto i = 0; i < 3000; i++) ref += base(gen);
+    auto index = FMIndex{.SA_INTERVAL = 4, .LOOKUP_LEN = 3};
+    index.build(ref);
+
+    const auto path
+      = std::filesystem::temp_directory_path() / "biovoltron_fm_index.fmi";
+    {
+      auto fout = std::ofstream{path, std::ios::binary};
+      index.save(fout);
+    }
+    auto mapped = FMIndex{};
+    mapped.load(path);
+    CHECK(mapped.bwt_size == index.bwt_size);
+    CHECK(mapped.primary == index.primary);
+    CHECK(mapped.cnt == index.cnt);
+    auto loaded = FMIndex{};
+    {
+      auto fin = std::ifstream{path, std::ios::binary};
+      loaded.load(fin);
+    }
+    CHECK(loaded.LOOKUP_LEN == 3);
+    for (auto i = 0; i < 100; i++) {
+      const auto seed = ref.substr(i * 20, 12);
+      CHECK(sorted_offsets(mapped, seed) == sorted_offsets(index, seed));
+      CHECK(sorted_offsets(loaded, seed) == sorted_offsets(index, seed));
+    }
+    std::filesystem::remove(path);
+  }
+}
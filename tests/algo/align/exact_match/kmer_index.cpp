@@ -0,0 +1,95 @@
+#include <biovoltron/algo/align/exact_match/kmer_index.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+naive_offsets(istring_view ref, istring_view kmer) {
+  auto offsets = std::vector<std::uint32_t>{};
+  for (auto i = ref.find(kmer); i != istring_view::npos;
+       i = ref.find(kmer, i + 1))
+    offsets.push_back(i);
+  return offsets;
+}
+
+auto
+to_vector(std::span<const std::uint32_t> offsets) {
+  return std::vector(offsets.begin(), offsets.end());
+}
+
+}  // namespace
+
+TEST_CASE("KmerIndex") {
+  SECTION("Small reference") {
+    auto index = KmerIndex{.K = 4, .BUCKET_LEN = 2};
+    index.build(01230123401230_s);
+    CHECK(index.keys.size() == 7);
+    CHECK(to_vector(index.get_offsets(0123_s))
+          == std::vector<std::uint32_t>{0, 4, 9});
+    CHECK(to_vector(index.get_offsets(2301_s))
+          == std::vector<std::uint32_t>{2});
+    CHECK(index.get_offsets(3012_s).size() == 1);
+    CHECK(index.get_offsets(1234_s).empty());
+    CHECK(index.get_offsets(3333_s).empty());
+    CHECK(index.get_offsets(012_s).empty());
+    CHECK(index.get_offsets(01230_s).empty());
+    CHECK(index.get_offsets(std::uint64_t{1} << 8).empty());
+    CHECK(KmerIndex{}.get_offsets(std::uint64_t{}).empty());
+    CHECK_THROWS_AS(KmerIndex{.K = 33}.build(0123_s), std::invalid_argument);
+  }
+
+  SECTION("Random reference against naive search") {
+    auto gen = std::mt19937{};
+    auto ref = istring{};
+    for (auto i = 0; i < 200000; i++) ref += gen() % 50 ? gen() % 4 : 4;
+    for (const auto [k, bucket_len] :
+         {std::pair{8, 10}, std::pair{13, 8}, std::pair{32, 12}}) {
+      auto index = KmerIndex{.K = k, .BUCKET_LEN = bucket_len};
+      index.build(FastaRecord<true>{"chr", ref});
+      REQUIRE(std::ranges::is_sorted(index.keys));
+      for (auto t = 0; t < 300; t++) {
+        const auto kmer = ref.substr(gen() % (ref.size() - k), k);
+        const auto expect = kmer.find(4) == istring::npos
+                            ? naive_offsets(ref, kmer)
+                            : std::vector<std::uint32_t>{};
+        REQUIRE(to_vector(index.get_offsets(kmer)) == expect);
+      }
+    }
+  }
+
+  SECTION("Save and load") {
+    auto gen = std::mt19937{};
+    auto ref = istring{};
+    for (auto i = 0; i < 5000; i++) ref += gen() % 4;
+    auto index = KmerIndex{.K = 11, .BUCKET_LEN = 6};
+    index.build(ref);
+
+    const auto path
+      = std::filesystem::temp_directory_path() / "biovoltron_kmer_index.kmi";
+    {
+      auto fout = std::ofstream{path, std::ios::binary};
+      index.save(fout);
+    }
+    auto mapped = KmerIndex{};
+    mapped.load(path);
+    auto loaded = KmerIndex{};
+    {
+      auto fin = std::ifstream{path, std::ios::binary};
+      loaded.load(fin);
+    }
+    CHECK(mapped.K == 11);
+    CHECK(loaded.BUCKET_LEN == 6);
+    for (auto i = 0; i < 100; i++) {
+      const auto kmer = ref.substr(i * 40, 11);
+      const auto expect = naive_offsets(ref, kmer);
+      CHECK(to_vector(mapped.get_offsets(kmer)) == expect);
+      CHECK(to_vector(loaded.get_offsets(kmer)) == expect);
+    }
+    std::filesystem::remove(path);
+  }
+}
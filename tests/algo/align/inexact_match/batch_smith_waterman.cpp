@@ -0,0 +1,88 @@
+#include <biovoltron/algo/align/inexact_match/batch_smith_waterman.hpp>
+#include <catch.hpp>
+#include <random>
+
+using namespace biovoltron;
+using namespace std::string_literals;
+
+TEST_CASE("BatchSmithWaterman") {
+  SECTION("Semi-global") {
+    const auto aligner = BatchSmithWaterman{.SEMI_GLOBAL = true};
+    const auto reads = std::vector{0123_s, 30123_s, 0012_s};
+    const auto alns = aligner.align(001230123_s, reads);
+    REQUIRE(alns.size() == 3);
+    CHECK(alns[0].ref_begin == 1);
+    CHECK(alns[0].cigar == "4M"s);
+    CHECK(alns[1].ref_begin == 4);
+    CHECK(alns[1].cigar == "5M"s);
+    CHECK(alns[2].ref_begin == 0);
+    CHECK(alns[2].cigar == "4M"s);
+  }
+
+  SECTION("Agree with SmithWaterman") {
+    auto gen = std::mt19937{};
+    auto base = std::uniform_int_distribution<int>{0, 3};
+    auto target = istring{};
+    for (auto i = 0; i < 300; i++) target += base(gen);
+
+    auto reads = std::vector<istring>{};
+    for (auto r = 0; r < 100; r++) {
+      const auto begin = gen() % 200;
+      auto read = target.substr(begin, 30 + gen() % 70);
+      for (auto& c : read)
+        if (gen() % 20 == 0)
+          c = base(gen);
+      if (r % 3 == 0)
+        read.erase(gen() % read.size(), 1 + gen() % 3);
+      if (r % 5 == 0)
+        read.insert(gen() % read.size(), 2, 1);
+      reads.push_back(read);
+    }
+
+    for (const auto semi_global : {false, true}) {
+      const auto batch = BatchSmithWaterman{.SEMI_GLOBAL = semi_global};
+      const auto single = SmithWaterman{.SEMI_GLOBAL = semi_global};
+      const auto alns = batch.align(target, reads);
+      REQUIRE(alns.size() == reads.size());
+      for (auto r = 0u; r < reads.size(); r++) {
+        const auto expect = single.align(target, reads[r]);
+        REQUIRE(alns[r].score == expect.score);
+        REQUIRE(alns[r].cigar.read_size() == reads[r].size());
+        REQUIRE(alns[r].cigar.ref_size()
+                == alns[r].ref_end - alns[r].ref_begin);
+      }
+    }
+  }
+
+  SECTION("Long target") {
+    // Columns past 32767 do not fit the 16-bit lanes.
+    auto gen = std::mt19937{};
+    auto base = std::uniform_int_distribution<int>{0, 3};
+    auto target = istring{};
+    for (auto i = 0; i < 40000; i++) target += base(gen);
+    const auto reads = std::vector{target.substr(35000, 100)};
+    for (const auto semi_global : {false, true}) {
+      const auto alns
+        = BatchSmithWaterman{.SEMI_GLOBAL = semi_global}.align(target, reads);
+      CHECK(alns[0].score == 100);
+      CHECK(alns[0].ref_begin == 35000);
+      CHECK(alns[0].cigar == "100M"s);
+    }
+  }
+
+  SECTION("Realign SamRecord") {
+    auto records = std::vector<SamRecord<>>(2);
+    records[0].seq = "CGTACG";
+    records[0].cigar = "6M";
+    records[1].seq = "ACGTTTTACG";
+    records[1].cigar = "10M";
+    const auto ref = Codec::to_istring("TTACGTACGTACGTTTTTACGTA");
+    const auto alns = BatchSmithWaterman{.SEMI_GLOBAL = true}.realign(
+      ref, 100, std::span{records});
+    CHECK(records[0].pos == 100 + 3 + 1);
+    CHECK(records[0].cigar == "6M"s);
+    CHECK(records[1].pos == 100 + 10 + 1);
+    CHECK(records[1].cigar == "3M1D7M"s);
+    CHECK(alns[1].score == 10 - 7);
+  }
+}
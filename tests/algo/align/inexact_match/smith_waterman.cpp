@@ -0,0 +1,176 @@
+#include <biovoltron/algo/align/inexact_match/smith_waterman.hpp>
+#include <catch.hpp>
+#include <random>
+
+using namespace biovoltron;
+using namespace std::string_literals;
+
+namespace {
+
+auto
+random_seq(std::mt19937& gen, std::size_t size) {
+  auto seq = istring{};
+  auto dist = std::uniform_int_distribution<int>{0, 3};
+  for (auto i = 0u; i < size; i++) seq += dist(gen);
+  return seq;
+}
+
+auto
+mutate(std::mt19937& gen, istring_view seq) {
+  auto res = istring{};
+  auto dist = std::uniform_int_distribution<int>{0, 99};
+  for (const auto c : seq) {
+    const auto r = dist(gen);
+    if (r < 3)
+      res += (c + 1) % 4;
+    else if (r < 5)
+      continue;
+    else if (r < 7)
+      res += c, res += dist(gen) % 4;
+    else
+      res += c;
+  }
+  return res;
+}
+
+auto
+rescore(const SmithWaterman& sw, istring_view ref, istring_view read,
+        const SmithWaterman::Alignment& aln) {
+  auto score = 0;
+  auto i = 0u;
+  auto j = aln.ref_begin;
+  for (const auto [size, op] : aln.cigar) {
+    if (op == 'S')
+      i += size;
+    else if (op == 'M') {
+      for (auto k = 0u; k < size; k++, i++, j++)
+        score += read[i] == ref[j] && read[i] < 4 ? sw.MATCH : -sw.MISMATCH;
+    } else if (op == 'I') {
+      score -= sw.GAP_OPEN + sw.GAP_EXTEND * size;
+      i += size;
+    } else if (op == 'D') {
+      score -= sw.GAP_OPEN + sw.GAP_EXTEND * size;
+      j += size;
+    }
+  }
+  return score;
+}
+
+}  // namespace
+
+TEST_CASE("SmithWaterman") {
+  SECTION("Exact match") {
+    const auto sw = SmithWaterman{};
+    const auto aln = sw.align(0123012301230123_s, 23012301_s);
+    CHECK(aln.score == 8);
+    CHECK(aln.cigar == "8M"s);
+    CHECK(aln.ref_begin == 2);
+    CHECK(aln.ref_end == 10);
+  }
+
+  SECTION("Local soft clip") {
+    const auto sw = SmithWaterman{};
+    const auto aln = sw.align(0000000000123012300000000_s, 3333123012333_s);
+    CHECK(aln.score == 7);
+    CHECK(aln.cigar == "4S7M2S"s);
+    CHECK(aln.read_begin == 4);
+    CHECK(aln.read_end == 11);
+    CHECK(aln.ref_begin == 10);
+  }
+
+  SECTION("Affine gap") {
+    const auto sw = SmithWaterman{.MATCH = 2};
+    const auto ref = 01230123012301230000011112222333301230123_s;
+    const auto read = 01230123012301230000022223333012301_s;
+    const auto aln = sw.align(ref, read);
+    CHECK(aln.cigar == "21M4D14M"s);
+    CHECK(aln.score == 35 * 2 - 6 - 4);
+  }
+
+  SECTION("Semi-global") {
+    const auto sw = SmithWaterman{.SEMI_GLOBAL = true};
+    const auto aln = sw.align(0000000000123012300000000_s, 3333123012333_s);
+    CHECK(aln.read_begin == 0);
+    CHECK(aln.read_end == 13);
+    CHECK(aln.cigar.read_size() == 13);
+    CHECK(aln.score == rescore(sw, 0000000000123012300000000_s,
+                               3333123012333_s, aln));
+  }
+
+  SECTION("No alignment") {
+    const auto sw = SmithWaterman{};
+    const auto aln = sw.align(0000_s, 1111_s);
+    CHECK(aln.score == 0);
+    CHECK(aln.cigar == "4S"s);
+  }
+
+  SECTION("Random sequences against scalar kernel") {
+    auto gen = std::mt19937{};
+    // A zero GAP_OPEN gives linear gaps.
+    for (const auto [semi_global, gap_open] :
+         {std::pair{false, 6}, {true, 6}, {false, 0}, {true, 0}}) {
+      for (auto t = 0; t < 200; t++) {
+        const auto ref = random_seq(gen, 50 + gen() % 300);
+        const auto begin = gen() % (ref.size() - 40);
+        const auto read = mutate(gen, ref.substr(begin, 20 + gen() % 180));
+        const auto sw = SmithWaterman{.MATCH = 1 + int(gen() % 3),
+                                      .MISMATCH = 1 + int(gen() % 8),
+                                      .GAP_OPEN = gap_open,
+                                      .GAP_EXTEND = 1 + int(gen() % 4),
+                                      .SEMI_GLOBAL = semi_global};
+        const auto aln = sw.align(ref, read);
+        const auto expect = [&] {
+          auto h
+            = std::vector(read.size() + 1, std::vector<int>(ref.size() + 1));
+          auto e = h, f = h;
+          auto best = semi_global ? std::numeric_limits<int>::min() : 0;
+          for (auto i = 0u; i <= read.size(); i++) {
+            for (auto j = 0u; j <= ref.size(); j++) {
+              e[i][j] = f[i][j] = -1'000'000;
+              if (i == 0) {
+                h[i][j] = 0;
+                continue;
+              }
+              if (j == 0) {
+                h[i][j]
+                  = semi_global ? -(sw.GAP_OPEN + sw.GAP_EXTEND * int(i)) : 0;
+                continue;
+              }
+              const auto gap_oe = sw.GAP_OPEN + sw.GAP_EXTEND;
+              e[i][j] = std::max(e[i][j - 1] - sw.GAP_EXTEND,
+                                 h[i][j - 1] - gap_oe);
+              f[i][j] = std::max(f[i - 1][j] - sw.GAP_EXTEND,
+                                 h[i - 1][j] - gap_oe);
+              const auto s
+                = read[i - 1] == ref[j - 1] ? sw.MATCH : -sw.MISMATCH;
+              h[i][j] = std::max({h[i - 1][j - 1] + s, e[i][j], f[i][j]});
+              if (!semi_global)
+                h[i][j] = std::max(h[i][j], 0);
+              if (!semi_global || i == read.size())
+                best = std::max(best, h[i][j]);
+            }
+          }
+          return best;
+        }();
+        REQUIRE(aln.score == expect);
+        REQUIRE(aln.cigar.read_size() == read.size());
+        REQUIRE(aln.cigar.ref_size() == aln.ref_end - aln.ref_begin);
+        REQUIRE(rescore(sw, ref, read, aln) == aln.score);
+      }
+    }
+  }
+
+  SECTION("16-bit and scalar fallback") {
+    auto gen = std::mt19937{};
+    const auto ref = random_seq(gen, 2000);
+    const auto read = ref.substr(100, 1500);
+    const auto aln = SmithWaterman{}.align(ref, read);
+    CHECK(aln.score == 1500);
+    CHECK(aln.cigar == "1500M"s);
+    CHECK(aln.ref_begin == 100);
+
+    const auto big = SmithWaterman{.MATCH = 30}.align(ref, read);
+    CHECK(big.score == 1500 * 30);
+    CHECK(big.cigar == "1500M"s);
+  }
+}
@@ -0,0 +1,108 @@
+#include <biovoltron/algo/align/junction_counter.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace biovoltron;
+const auto gtf_path
+  = std::filesystem::path{DATA_PATH} / "tailor/mmu_gencode_main.gtf";
+
+namespace {
+
+auto
+make_record(std::string chrom, std::uint32_t pos, std::string_view cigar,
+            std::uint16_t flag = 0) {
+  auto record = SamRecord<>{};
+  record.rname = std::move(chrom);
+  record.pos = pos;
+  record.cigar = cigar;
+  record.flag = flag;
+  record.mapq = 60;
+  return record;
+}
+
+}  // namespace
+
+TEST_CASE("JunctionCounter") {
+  using Junction = JunctionCounter::Junction;
+
+  SECTION("Junctions of a cigar") {
+    const auto counter = JunctionCounter{};
+    const auto record = make_record("ref", 16, "6M14N1I5M");
+    CHECK(counter.junctions(record)
+          == std::vector<Junction>{{"ref", 21, 35, '.'}});
+    CHECK(counter.junctions(make_record("ref", 1, "3S5M10N5M2D3M20N4M1S"))
+          == std::vector<Junction>{{"ref", 5, 15, '.'}, {"ref", 25, 45, '.'}});
+    CHECK(counter.junctions(make_record("ref", 16, "6M14N1I5M", 4)).empty());
+    CHECK(counter.junctions(make_record("ref", 16, "6M14N1I5M", 256)).empty());
+    CHECK(counter.junctions(make_record("ref", 16, "20M")).empty());
+
+    const auto anchored = JunctionCounter{.MIN_OVERHANG = 6};
+    CHECK(anchored.junctions(make_record("ref", 1, "6M10N6M")).size() == 1);
+    CHECK(anchored.junctions(make_record("ref", 1, "6M10N2I5M")).empty());
+  }
+
+  SECTION("Strand") {
+    auto record = make_record("ref", 1, "5M10N5M");
+    const auto unstranded = JunctionCounter{};
+    const auto first
+      = JunctionCounter{.LIBRARY = JunctionCounter::FIRST_STRAND};
+    const auto second
+      = JunctionCounter{.LIBRARY = JunctionCounter::SECOND_STRAND};
+    CHECK(unstranded.strand(record) == '.');
+    CHECK(first.strand(record) == '-');
+    CHECK(second.strand(record) == '+');
+
+    record.flag = SamUtil::READ_PAIRED | SamUtil::SECOND_OF_PAIR;
+    CHECK(first.strand(record) == '+');
+    record.flag |= SamUtil::READ_REVERSE_STRAND;
+    CHECK(first.strand(record) == '-');
+    CHECK(second.strand(record) == '+');
+
+    record.optionals = {"NH:i:1", "XS:A:+"};
+    CHECK(first.strand(record) == '+');
+    CHECK(unstranded.strand(record) == '+');
+  }
+
+  SECTION("Counting and annotation") {
+    auto counter = JunctionCounter{};
+    auto gtf = std::ifstream{gtf_path};
+    counter.annotate(gtf);
+    CHECK(counter.introns.contains({"chr2", 58447673, 58448313, '-'}));
+    CHECK(counter.known({"chr2", 58447673, 58448313, '.'}));
+    CHECK_FALSE(counter.known({"chr2", 58447673, 58448313, '+'}));
+
+    auto records = std::vector<SamRecord<>>{};
+    for (auto i = 0; i < 1000; i++) {
+      records.push_back(make_record("chr2", 58447664, "10M640N10M"));
+      records.push_back(make_record("chr2", 58447664 + i % 5, "10M100N10M"));
+    }
+    counter.add(records);
+    const auto junctions = counter.junctions();
+    REQUIRE(junctions.size() == 6);
+    CHECK(junctions[1].junction == Junction{"chr2", 58447673, 58448313, '.'});
+    CHECK(junctions[1].count == 1000);
+    CHECK(junctions[1].known);
+    for (auto i = 0u; i < 5; i++) {
+      const auto& [junction, count, known] = junctions[i == 0 ? 0 : i + 1];
+      CHECK(junction == Junction{"chr2", 58447673 + i, 58447773 + i, '.'});
+      CHECK(count == 200);
+      CHECK_FALSE(known);
+    }
+  }
+
+  SECTION("SAM stream") {
+    auto counter = JunctionCounter{.BATCH_SIZE = 2};
+    auto ss = std::stringstream{
+      "@HD\tVN:1.6\n"
+      "r1\t0\tref\t16\t30\t6M14N1I5M\t*\t0\t0\tATAGCTCTCAGC\t*\n"
+      "r2\t16\tref\t16\t30\t6M14N1I5M\t*\t0\t0\tATAGCTCTCAGC\t*\tXS:A:-\n"
+      "r3\t0\tref\t10\t30\t12M\t*\t0\t0\tATAGCTCTCAGC\t*\n"};
+    counter.add(ss);
+    const auto junctions = counter.junctions();
+    REQUIRE(junctions.size() == 2);
+    CHECK(junctions[0].junction == Junction{"ref", 21, 35, '-'});
+    CHECK(junctions[1].junction == Junction{"ref", 21, 35, '.'});
+  }
+}
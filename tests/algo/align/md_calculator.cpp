@@ -0,0 +1,149 @@
+#include <biovoltron/algo/align/md_calculator.hpp>
+#include <catch.hpp>
+#include <random>
+
+using namespace biovoltron;
+
+TEST_CASE("MdCalculator") {
+  SECTION("Mismatches, insertions and deletions") {
+    const auto refs
+      = std::vector<FastaRecord<>>{{"chr1", "ACGTACGTACGTACGTAC"}};
+    const auto calculator = MdCalculator<>{.refs = refs};
+    auto record = SamRecord<>{};
+    record.rname = "chr1";
+    record.pos = 3;
+    record.cigar = "2S4M1I3M2D3M";
+    record.seq = "TTGTTCGGTATAC";
+    record.optionals = {"NM:i:0", "XT:A:U"};
+
+    const auto tags = calculator.compute(record);
+    REQUIRE(tags);
+    CHECK(tags->md == "2A4^CG3");
+    CHECK(tags->nm == 4);
+
+    CHECK_FALSE(calculator.validate(record));
+    CHECK(calculator.fix(record));
+    CHECK(record.optionals
+          == std::vector<std::string>{"NM:i:4", "XT:A:U", "MD:Z:2A4^CG3"});
+    CHECK(calculator.validate(record));
+    CHECK_FALSE(calculator.fix(record));
+  }
+
+  SECTION("Soft masked reference, N and skipped regions") {
+    const auto refs = std::vector<FastaRecord<>>{{"chr2", "acgtNcgtacgtacgt"}};
+    const auto calculator = MdCalculator<>{.refs = refs};
+    auto record = SamRecord<>{};
+    record.rname = "chr2";
+    record.pos = 1;
+    record.cigar = "5M6N3M";
+    record.seq = "ACGTNa=G";
+    const auto tags = calculator.compute(record);
+    REQUIRE(tags);
+    CHECK(tags->md == "4N0T1C0");
+    CHECK(tags->nm == 3);
+  }
+
+  SECTION("Records which are left as they are") {
+    const auto refs = std::vector<FastaRecord<>>{{"chr1", "ACGTACGT"}};
+    const auto calculator = MdCalculator<>{.refs = refs};
+    auto record = SamRecord<>{};
+    record.rname = "chr1";
+    record.pos = 5;
+    record.cigar = "5M";
+    record.seq = "ACGTA";
+    CHECK_FALSE(calculator.compute(record));
+    record.pos = 1;
+    record.rname = "chr2";
+    CHECK_FALSE(calculator.compute(record));
+    record.rname = "chr1";
+    record.flag = SamUtil::READ_UNMAPPED;
+    CHECK_FALSE(calculator.fix(record));
+    CHECK(record.optionals.empty());
+  }
+
+  SECTION("Agrees with a base by base walk") {
+    auto gen = std::mt19937{};
+    const auto random_seq = [&gen](std::size_t size) {
+      auto seq = std::string{};
+      for (auto i = 0u; i < size; i++)
+        seq += "ACGTN"[gen() % 100 ? gen() % 4 : 4];
+      return seq;
+    };
+    const auto refs = std::vector<FastaRecord<>>{{"chr1", random_seq(10000)},
+                                                 {"chr2", random_seq(5000)}};
+    auto records = std::vector<SamRecord<>>{};
+    auto expected = std::vector<MdCalculator<>::Tags>{};
+    for (auto n = 0; n < 2000; n++) {
+      const auto& ref = refs[gen() % 2];
+      auto record = SamRecord<>{};
+      record.rname = ref.name;
+      record.pos = 1 + gen() % (ref.seq.size() - 500);
+      auto ref_pos = record.begin();
+      auto tags = MdCalculator<>::Tags{};
+      auto matched = 0u;
+      if (gen() % 2) {
+        record.cigar.emplace_back(3, 'S');
+        record.seq += random_seq(3);
+      }
+      for (auto k = 1 + gen() % 6; k-- > 0;) {
+        const auto size = 1 + gen() % 80;
+        const auto op = "MMMMID"[gen() % 6];
+        record.cigar.emplace_back(size, op);
+        if (op == 'M')
+          for (auto i = 0u; i < size; i++, ref_pos++) {
+            auto base = ref.seq[ref_pos];
+            if (gen() % 20 == 0)
+              base = "ACGTN"[gen() % 5];
+            record.seq += base;
+            if (base == ref.seq[ref_pos] && base != 'N')
+              matched++;
+            else {
+              tags.md += std::to_string(matched) + ref.seq[ref_pos];
+              tags.nm++;
+              matched = 0;
+            }
+          }
+        else if (op == 'I') {
+          record.seq += random_seq(size);
+          tags.nm += size;
+        } else {
+          tags.md += std::to_string(matched) + '^'
+                     + ref.seq.substr(ref_pos, size);
+          tags.nm += size;
+          matched = 0;
+          ref_pos += size;
+        }
+      }
+      tags.md += std::to_string(matched);
+      records.push_back(record);
+      expected.push_back(tags);
+    }
+
+    const auto calculator = MdCalculator<>{.refs = refs};
+    for (auto i = 0u; i < records.size(); i++)
+      REQUIRE(calculator.compute(records[i]) == expected[i]);
+    CHECK(calculator.fix(records) == records.size());
+    for (auto i = 0u; i < records.size(); i++) {
+      REQUIRE(calculator.validate(records[i]));
+      REQUIRE(records[i].optionals
+              == std::vector<std::string>{"MD:Z:" + expected[i].md,
+                                          "NM:i:"
+                                            + std::to_string(expected[i].nm)});
+    }
+
+    auto encoded_refs = std::vector<FastaRecord<true>>{};
+    for (const auto& ref : refs) encoded_refs.push_back(ref);
+    const auto encoded_calculator = MdCalculator<true>{.refs = encoded_refs};
+    for (auto i = 0u; i < records.size(); i++) {
+      auto record = SamRecord<true>{};
+      record.rname = records[i].rname;
+      record.pos = records[i].pos;
+      record.cigar = records[i].cigar;
+      record.seq = Codec::to_istring(records[i].seq);
+      const auto tags = encoded_calculator.compute(record);
+      REQUIRE(tags);
+      REQUIRE(tags->md == expected[i].md);
+      REQUIRE(tags->nm == expected[i].nm);
+    }
+  }
+}
@@ -0,0 +1,102 @@
+#include <biovoltron/algo/kmer/bloom_filter.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+random_seq(std::mt19937& gen, std::size_t len) {
+  auto seq = std::string{};
+  for (auto i = 0u; i < len; i++) seq += "ACGT"[gen() % 4];
+  return seq;
+}
+
+auto
+canonical_keys(const std::string& seq, int k) {
+  auto keys = std::vector<std::uint64_t>{};
+  for (const auto& kmer : views::kmers(seq, k)) keys.push_back(kmer.canonical());
+  return keys;
+}
+
+}  // namespace
+
+TEST_CASE("BloomFilter") {
+  auto gen = std::mt19937{};
+  const auto refs = std::vector{FastaRecord<>{"chr1", random_seq(gen, 300000)},
+                                FastaRecord<>{"chr2", random_seq(gen, 1000)}};
+  const auto other = random_seq(gen, 100000);
+
+  SECTION("Membership") {
+    auto filter = BloomFilter{.K = 21};
+    filter.build(refs);
+    auto false_negatives = 0;
+    for (const auto& ref : refs)
+      for (const auto key : canonical_keys(ref.seq, 21))
+        false_negatives += !filter.contains(key);
+    CHECK(false_negatives == 0);
+    auto false_positives = 0;
+    for (const auto key : canonical_keys(other, 21))
+      false_positives += filter.contains(key);
+    CHECK(false_positives < 100000 * 0.01);
+
+    const auto read = refs[0].seq.substr(1000, 100);
+    CHECK(filter.count_hits(read) == 80);
+    CHECK(filter.count_hits(Codec::to_istring(Codec::rev_comp(read))) == 80);
+    CHECK(filter.count_hits(read.substr(0, 20)) == 0);
+    CHECK(filter.count_hits(other.substr(0, 100)) < 5);
+    CHECK_THROWS_AS(BloomFilter{.K = 0}.build(refs), std::invalid_argument);
+
+    const auto empty = BloomFilter{.K = 21};
+    CHECK(!empty.contains(0));
+    CHECK(empty.count_hits(read) == 0);
+  }
+
+  SECTION("Counting") {
+    auto repeat = random_seq(gen, 50);
+    auto seq = random_seq(gen, 100000);
+    for (auto i = 0; i < 20; i++) seq += repeat + random_seq(gen, 100);
+    auto filter = BloomFilter<true>{.K = 25};
+    filter.build(std::vector{FastaRecord<>{"chr", seq}});
+    const auto key = canonical_keys(repeat, 25).front();
+    CHECK(filter.count(key) >= 20);
+    CHECK(filter.contains(key, 20));
+    auto under = 0;
+    for (const auto key : canonical_keys(seq.substr(0, 10000), 25))
+      under += filter.count(key) == 0;
+    CHECK(under == 0);
+    CHECK(filter.count_hits(repeat, 20) == 26);
+    CHECK(filter.count_hits(seq.substr(0, 1000), 5) < 10);
+    CHECK(BloomFilter<true>{}.count(key) == 0);
+  }
+
+  SECTION("Save and load") {
+    auto filter = BloomFilter{.K = 15, .HASHES = 4};
+    filter.build(refs);
+    const auto path
+      = std::filesystem::temp_directory_path() / "biovoltron_bloom_filter.bf";
+    {
+      auto fout = std::ofstream{path, std::ios::binary};
+      filter.save(fout);
+    }
+    auto mapped = BloomFilter{};
+    mapped.load(path);
+    auto loaded = BloomFilter{};
+    {
+      auto fin = std::ifstream{path, std::ios::binary};
+      loaded.load(fin);
+    }
+    CHECK(mapped.K == 15);
+    CHECK(loaded.HASHES == 4);
+    for (const auto& seq : {refs[1].seq, other.substr(0, 1000)}) {
+      CHECK(mapped.count_hits(seq) == filter.count_hits(seq));
+      CHECK(loaded.count_hits(seq) == filter.count_hits(seq));
+    }
+    CHECK_THROWS_AS(BloomFilter<true>{}.load(path), std::runtime_error);
+    std::filesystem::remove(path);
+  }
+}
@@ -0,0 +1,100 @@
+#include <biovoltron/algo/kmer/kmer_counter.hpp>
+#include <catch.hpp>
+#include <map>
+#include <random>
+#include <sstream>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+random_reads(std::size_t n, std::size_t len) {
+  auto gen = std::mt19937{};
+  auto reads = std::vector<FastqRecord<>>{};
+  for (auto i = 0u; i < n; i++) {
+    auto read = FastqRecord<>{};
+    read.name = "r" + std::to_string(i);
+    for (auto j = 0u; j < len; j++)
+      read.seq += gen() % 100 ? "ACGT"[gen() % 4] : 'N';
+    read.qual = std::string(len, 'I');
+    reads.push_back(read);
+  }
+  return reads;
+}
+
+auto
+naive_counts(const std::vector<FastqRecord<>>& reads, int k) {
+  auto counts = std::map<std::uint64_t, std::uint64_t>{};
+  for (const auto& read : reads)
+    for (auto i = 0u; i + k <= read.seq.size(); i++) {
+      const auto kmer = Codec::to_istring(read.seq.substr(i, k));
+      if (kmer.find(4) == istring::npos)
+        counts[std::min(Codec::hash(kmer), Codec::hash(Codec::rev_comp(kmer)))]++;
+    }
+  return counts;
+}
+
+auto
+collect(KmerCounter& counter) {
+  auto counts = std::map<std::uint64_t, std::uint64_t>{};
+  counter.for_each([&](auto key, auto count) { counts[key] += count; });
+  return counts;
+}
+
+}  // namespace
+
+TEST_CASE("KmerCounter") {
+  SECTION("Small reads") {
+    auto counter = KmerCounter{.K = 3, .MEMORY_BUDGET = 1 << 10};
+    counter.count(std::vector{FastaRecord<>{"r1", "ACGTNACG"},
+                              FastaRecord<>{"r2", "CGT"}});
+    CHECK(counter.get_count("ACG") == 4);
+    CHECK(counter.get_count("CGT") == 4);
+    CHECK(counter.get_count("AAA") == 0);
+    CHECK(counter.get_count("ANG") == 0);
+    CHECK(counter.get_count("AC") == 0);
+    CHECK(!counter.spilled());
+    CHECK(counter.histogram() == std::vector<std::uint64_t>{0, 0, 0, 0, 1});
+    CHECK_THROWS_AS(KmerCounter{.K = 33}.count(std::vector<FastaRecord<>>{}),
+                    std::invalid_argument);
+  }
+
+  SECTION("In memory against naive counting") {
+    const auto reads = random_reads(2000, 100);
+    auto counter = KmerCounter{.K = 9, .MEMORY_BUDGET = 1 << 22};
+    counter.count(reads);
+    CHECK(!counter.spilled());
+    const auto expect = naive_counts(reads, 9);
+    CHECK(collect(counter) == expect);
+    for (auto i = 0; i < 100; i++) {
+      const auto kmer = Codec::to_istring(reads[i].seq.substr(0, 9));
+      const auto key = expect.find(
+        std::min(Codec::hash(kmer), Codec::hash(Codec::rev_comp(kmer))));
+      CHECK(counter.get_count(reads[i].seq.substr(0, 9))
+            == (kmer.find(4) != istring::npos ? 0 : key->second));
+    }
+  }
+
+  SECTION("Spill to disk") {
+    const auto reads = random_reads(3000, 150);
+    auto ss = std::stringstream{};
+    for (const auto& read : reads) ss << read << "\n";
+    auto counter = KmerCounter{.K = 21,
+                               .MEMORY_BUDGET = 1 << 19,
+                               .MINIMIZER_LEN = 7,
+                               .BATCH_SIZE = 100};
+    counter.count(ss);
+    REQUIRE(counter.spilled());
+    const auto expect = naive_counts(reads, 21);
+    CHECK(counter.get_count(expect.begin()->first) == expect.begin()->second);
+    auto histogram = std::vector<std::uint64_t>{};
+    for (const auto& [key, count] : expect) {
+      if (histogram.size() <= count)
+        histogram.resize(count + 1);
+      histogram[count]++;
+    }
+    CHECK(counter.histogram() == histogram);
+    CHECK(collect(counter) == expect);
+  }
+}
@@ -0,0 +1,134 @@
+#include <biovoltron/algo/kmer/minhash.hpp>
+#include <catch.hpp>
+#include <random>
+#include <set>
+#include <sstream>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+random_seq(std::mt19937& gen, std::size_t len) {
+  auto seq = std::string{};
+  for (auto i = 0u; i < len; i++) seq += "ACGT"[gen() % 4];
+  return seq;
+}
+
+auto
+mutate(std::mt19937& gen, std::string seq, double rate) {
+  for (auto& c : seq)
+    if (gen() % 10000 < rate * 10000)
+      c = "ACGT"[(Codec::to_int(c) + 1 + gen() % 3) % 4];
+  return seq;
+}
+
+auto
+exact_kmers(const std::string& seq, int k) {
+  auto kmers = std::set<std::uint64_t>{};
+  for (const auto& kmer : views::kmers(seq, k)) kmers.insert(kmer.canonical());
+  return kmers;
+}
+
+}  // namespace
+
+TEST_CASE("MinHash") {
+  auto gen = std::mt19937{};
+
+  SECTION("Intersection") {
+    for (auto t = 0; t < 50; t++) {
+      auto a = std::vector<std::uint64_t>{};
+      auto b = std::vector<std::uint64_t>{};
+      for (auto i = 0u; i < 300; i++) {
+        if (gen() % 3 == 0)
+          a.push_back(i);
+        if (gen() % (t % 5 + 2) == 0)
+          b.push_back(i);
+      }
+      auto expect = std::vector<std::uint64_t>{};
+      std::ranges::set_intersection(a, b, std::back_inserter(expect));
+      REQUIRE(MinHash::intersect_size(a, b) == expect.size());
+      REQUIRE(MinHash::intersect_size(b, a) == expect.size());
+    }
+  }
+
+  SECTION("Bottom-k sketch") {
+    const auto seq = random_seq(gen, 20000);
+    const auto minhash = MinHash{.K = 15, .SKETCH_SIZE = 200};
+    const auto sketch = minhash.sketch(std::vector{FastaRecord<>{"s", seq}});
+    auto expect = std::vector<std::uint64_t>{};
+    for (const auto key : exact_kmers(seq, 15))
+      expect.push_back(MinHash::hash(key));
+    std::ranges::sort(expect);
+    expect.resize(200);
+    CHECK(sketch.hashes == expect);
+    CHECK(sketch.size == 200);
+
+    // Reverse complement gives the same sketch.
+    const auto rev = minhash.sketch(
+      std::vector{FastaRecord<>{"s", Codec::rev_comp(seq)}});
+    CHECK(rev.hashes == sketch.hashes);
+    CHECK(MinHash::jaccard(sketch, rev) == 1.0);
+    CHECK(MinHash::distance(sketch, rev) == 0.0);
+  }
+
+  SECTION("Similarity") {
+    const auto seq = random_seq(gen, 50000);
+    const auto mutant = mutate(gen, seq, 0.01);
+    const auto other = random_seq(gen, 50000);
+    const auto minhash = MinHash{.K = 21, .SKETCH_SIZE = 2000};
+    const auto a = minhash.sketch(std::vector{FastaRecord<>{"a", seq}});
+    const auto b = minhash.sketch(std::vector{FastaRecord<>{"b", mutant}});
+    const auto c = minhash.sketch(std::vector{FastaRecord<>{"c", other}});
+
+    const auto x = exact_kmers(seq, 21), y = exact_kmers(mutant, 21);
+    auto common = std::vector<std::uint64_t>{};
+    std::ranges::set_intersection(x, y, std::back_inserter(common));
+    const auto jaccard
+      = double(common.size()) / (x.size() + y.size() - common.size());
+    CHECK(MinHash::jaccard(a, b) == Approx(jaccard).margin(0.03));
+    CHECK(MinHash::distance(a, b) == Approx(0.01).margin(0.003));
+    CHECK(MinHash::jaccard(a, c) < 0.01);
+
+    const auto sketches = std::vector{a, b, c};
+    const auto matrix = MinHash::distances(sketches);
+    REQUIRE(matrix.size() == 9);
+    CHECK(matrix[0] == 0);
+    CHECK(matrix[1] == matrix[3]);
+    CHECK(matrix[1] == float(MinHash::distance(a, b)));
+    CHECK(matrix[2 * 3 + 0] == float(MinHash::distance(c, a)));
+  }
+
+  SECTION("FracMinHash containment") {
+    const auto ref = random_seq(gen, 200000);
+    const auto part = ref.substr(50000, 20000);
+    const auto minhash = MinHash{.K = 21, .SCALE = 20};
+    const auto a = minhash.sketch(std::vector{FastaRecord<>{"ref", ref}});
+    const auto b = minhash.sketch(std::vector{FastaRecord<>{"part", part}});
+    CHECK(a.size == 0);
+    CHECK(a.hashes.size() == Approx(200000 / 20).epsilon(0.1));
+    CHECK(MinHash::containment(b, a) == 1.0);
+    CHECK(MinHash::containment(a, b) == Approx(0.1).margin(0.02));
+    CHECK_THROWS_AS(
+      MinHash::jaccard(a, MinHash{.K = 21}.sketch(std::vector{
+                            FastaRecord<>{"ref", ref}})),
+      std::invalid_argument);
+  }
+
+  SECTION("Stream and serialization") {
+    auto ss = std::stringstream{};
+    for (auto i = 0; i < 100; i++)
+      ss << FastqRecord<>{{"r", random_seq(gen, 100)}, std::string(100, 'I')}
+         << "\n";
+    const auto sketch = MinHash{.SKETCH_SIZE = 500}.sketch(ss, "sample");
+    CHECK(sketch.hashes.size() == 500);
+    CHECK(std::ranges::is_sorted(sketch.hashes));
+
+    auto archive = std::stringstream{};
+    sketch.save(archive);
+    auto loaded = Sketch{};
+    loaded.load(archive);
+    CHECK(loaded == sketch);
+    CHECK(loaded.name == "sample");
+  }
+}
@@ -0,0 +1,133 @@
+#include <biovoltron/algo/qc/fastq_qc.hpp>
+#include <catch.hpp>
+#include <random>
+#include <sstream>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+random_reads(std::size_t n) {
+  auto gen = std::mt19937{};
+  auto reads = std::vector<FastqRecord<>>{};
+  for (auto i = 0u; i < n; i++) {
+    auto read = FastqRecord<>{};
+    read.name = "r" + std::to_string(i);
+    const auto len = 20 + gen() % 120;
+    for (auto j = 0u; j < len; j++) {
+      read.seq += "ACGTNacgt"[gen() % 9];
+      read.qual += char('!' + gen() % 42);
+    }
+    reads.push_back(read);
+  }
+  return reads;
+}
+
+auto
+naive_stats(const std::vector<FastqRecord<>>& reads) {
+  auto stats = FastqQc::Stats{};
+  for (const auto& read : reads) {
+    const auto size = read.seq.size();
+    if (stats.base_counts.size() < size) {
+      stats.base_counts.resize(size);
+      stats.quality_counts.resize(size);
+    }
+    if (stats.length_histogram.size() <= size)
+      stats.length_histogram.resize(size + 1);
+    auto gc = 0, acgt = 0, sum = 0;
+    for (auto i = 0u; i < size; i++) {
+      const auto base = std::string_view{"ACGT"}.find(std::toupper(read.seq[i]));
+      stats.base_counts[i][std::min<std::size_t>(base, 4)]++;
+      acgt += base < 4;
+      gc += base == 1 || base == 2;
+      stats.quality_counts[i][read.qual[i] - '!']++;
+      sum += read.qual[i] - '!';
+    }
+    stats.gc_histogram[std::lround(100.0 * gc / acgt)]++;
+    stats.mean_quality_histogram[sum / size]++;
+    stats.length_histogram[size]++;
+    stats.reads++;
+    stats.bases += size;
+  }
+  return stats;
+}
+
+auto
+same_stats(const FastqQc::Stats& a, const FastqQc::Stats& b) {
+  return a.reads == b.reads && a.bases == b.bases
+         && a.base_counts == b.base_counts
+         && a.quality_counts == b.quality_counts
+         && a.gc_histogram == b.gc_histogram
+         && a.mean_quality_histogram == b.mean_quality_histogram
+         && a.length_histogram == b.length_histogram;
+}
+
+}  // namespace
+
+TEST_CASE("FastqQc") {
+  SECTION("Single reads") {
+    auto qc = FastqQc{};
+    qc.add(FastqRecord<>{{"r1", "ACGN"}, "!+5I"});
+    qc.add(FastqRecord<>{{"r2", "GG"}, "II"});
+    const auto& stats = qc.stats;
+    CHECK(stats.reads == 2);
+    CHECK(stats.bases == 6);
+    CHECK(stats.base_counts[0] == std::array<std::uint64_t, 5>{1, 0, 1, 0, 0});
+    CHECK(stats.base_counts[3] == std::array<std::uint64_t, 5>{0, 0, 0, 0, 1});
+    CHECK(stats.mean_quality(0) == 20);
+    CHECK(stats.mean_quality(2) == 20);
+    CHECK(stats.quality_quantile(0, 0.5) == 0);
+    CHECK(stats.quality_quantile(0, 0.75) == 40);
+    CHECK(stats.gc_histogram[67] == 1);
+    CHECK(stats.gc_histogram[100] == 1);
+    CHECK(stats.mean_quality_histogram[17] == 1);
+    CHECK(stats.length_histogram == std::vector<std::uint64_t>{0, 0, 1, 0, 1});
+  }
+
+  SECTION("Batches against naive") {
+    const auto reads = random_reads(3000);
+    auto qc = FastqQc{};
+    qc.add(reads);
+    CHECK(same_stats(qc.stats, naive_stats(reads)));
+
+    auto ss = std::stringstream{};
+    for (const auto& read : reads) ss << read << "\n";
+    auto streamed = FastqQc{.BATCH_SIZE = 700};
+    streamed.add(ss);
+    CHECK(same_stats(streamed.stats, qc.stats));
+    CHECK(streamed.deduplicated_fraction() == 1);
+  }
+
+  SECTION("Duplication and over-represented sequences") {
+    auto reads = random_reads(1000);
+    for (auto i = 0; i < 100; i++) {
+      reads[i].seq = reads[0].seq;
+      reads[i].qual = reads[0].qual;
+    }
+    for (auto i = 100; i < 110; i++) {
+      reads[i].seq = std::string(100, 'A');
+      reads[i].qual = std::string(100, 'I');
+    }
+    auto qc = FastqQc{.OVERREPRESENTED_FRACTION = 0.005};
+    qc.add(reads);
+    const auto overrepresented = qc.overrepresented();
+    REQUIRE(overrepresented.size() == 2);
+    CHECK(overrepresented[0].first == reads[0].seq.substr(
+            0, reads[0].seq.size() > 75 ? 50 : reads[0].seq.size()));
+    CHECK(overrepresented[0].second == 100);
+    CHECK(overrepresented[1] == std::pair{std::string(50, 'A'),
+                                          std::uint64_t{10}});
+    const auto levels = qc.duplication_levels();
+    CHECK(levels[0] == 890);
+    CHECK(levels[9] == 2);
+    CHECK(qc.deduplicated_fraction() == Approx(892 / 1000.0));
+
+    auto sampled = FastqQc{.DUPLICATION_SAMPLE = 10};
+    sampled.add(reads);
+    // Reads 110 to 117 are the last tracked distinct sequences.
+    CHECK(sampled.duplication_levels()[0] == 8);
+    CHECK(sampled.duplication_levels()[9] == 2);
+    CHECK(sampled.deduplicated_fraction() == Approx(10 / 118.0));
+  }
+}
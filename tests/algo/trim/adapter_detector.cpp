@@ -0,0 +1,76 @@
+#include <biovoltron/algo/trim/adapter_detector.hpp>
+#include <biovoltron/algo/trim/adapter_trimmer.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace biovoltron;
+
+namespace {
+
+const auto data_path = std::filesystem::path{DATA_PATH} / "adapter_trimmer";
+
+auto
+read_fastq(const std::filesystem::path& path) {
+  auto reads = std::vector<FastqRecord<>>{};
+  auto fin = std::ifstream{path};
+  for (auto read = FastqRecord<>{}; fin >> read;) reads.push_back(read);
+  return reads;
+}
+
+auto
+starts_with(const std::vector<AdapterDetector::Candidate>& candidates,
+            std::string_view adapter) {
+  return candidates.size() == 1 && candidates[0].seq.size() >= 20
+         && adapter.starts_with(candidates[0].seq.substr(0, adapter.size()))
+         && candidates[0].frequency > 0.05;
+}
+
+}  // namespace
+
+TEST_CASE("AdapterDetector") {
+  const auto detector = AdapterDetector{};
+  const auto trimmer = AdapterTrimmer{};
+  const auto reads1 = read_fastq(data_path / "has_adapter_1.fq");
+  const auto reads2 = read_fastq(data_path / "has_adapter_2.fq");
+  const auto clean1 = read_fastq(data_path / "no_adapter_1.fq");
+  const auto clean2 = read_fastq(data_path / "no_adapter_2.fq");
+
+  SECTION("Single-end") {
+    CHECK(starts_with(detector.detect(reads1), trimmer.ADAPTER1));
+    CHECK(starts_with(detector.detect(reads2), trimmer.ADAPTER2));
+    CHECK(detector.detect(clean1).empty());
+    CHECK(AdapterDetector{.SAMPLE_SIZE = 2000}.detect(clean2).empty());
+  }
+
+  SECTION("Only 3' tails are counted") {
+    auto gen = std::mt19937{};
+    auto reads = std::vector<FastqRecord<>>(1000);
+    for (auto& read : reads) {
+      read.seq = "GATCGGAAGAGCACACGTCTGAACTCCAGTCAC";
+      while (read.seq.size() < 300) read.seq += "ACGT"[gen() % 4];
+      read.qual = std::string(read.seq.size(), 'I');
+    }
+    CHECK(detector.detect(reads).empty());
+  }
+
+  SECTION("Paired-end") {
+    const auto [adapters1, adapters2] = detector.detect(reads1, reads2);
+    REQUIRE(starts_with(adapters1, trimmer.ADAPTER1));
+    REQUIRE(starts_with(adapters2, trimmer.ADAPTER2));
+    const auto [none1, none2] = detector.detect(clean1, clean2);
+    CHECK(none1.empty());
+    CHECK(none2.empty());
+
+    auto trimmed1 = reads1, trimmed2 = reads2;
+    const auto detected = AdapterTrimmer{.ADAPTER1 = adapters1[0].seq,
+                                         .ADAPTER2 = adapters2[0].seq};
+    detected.trim(trimmed1, trimmed2);
+    const auto ans1 = read_fastq(data_path / "has_adapter_ans_1.fq");
+    auto same = 0;
+    for (auto i = 0u; i < ans1.size(); i++)
+      same += trimmed1[i].seq == ans1[i].seq;
+    CHECK(same >= ans1.size() * 0.99);
+  }
+}
@@ -0,0 +1,79 @@
+#include <biovoltron/algo/trim/adapter_trimmer.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace biovoltron;
+
+namespace {
+
+const auto data_path = std::filesystem::path{DATA_PATH} / "adapter_trimmer";
+
+auto
+read_fastq(const std::filesystem::path& path) {
+  auto reads = std::vector<FastqRecord<>>{};
+  auto fin = std::ifstream{path};
+  for (auto read = FastqRecord<>{}; fin >> read;) reads.push_back(read);
+  return reads;
+}
+
+auto
+same_reads(const std::vector<FastqRecord<>>& a,
+           const std::vector<FastqRecord<>>& b) {
+  auto same = a.size() == b.size();
+  for (auto i = 0u; same && i < a.size(); i++)
+    same = a[i].name == b[i].name && a[i].seq == b[i].seq
+           && a[i].qual == b[i].qual;
+  return same;
+}
+
+}  // namespace
+
+TEST_CASE("AdapterTrimmer") {
+  const auto trimmer = AdapterTrimmer{};
+
+  SECTION("Single-end") {
+    auto read = FastqRecord<>{{"r", "ACGTACGTACAGATCGGAAGAGCACACGNCTG"},
+                              std::string(32, 'I')};
+    CHECK(trimmer.trim(read) == 22);
+    CHECK(read.seq == "ACGTACGTAC");
+    CHECK(read.qual == "IIIIIIIIII");
+
+    // Partial adapter with one mismatch at the 3' end.
+    read = {{"r", "TTTTTTTTTTTTTTTTTTTTAGATCGCAAGAG"}, std::string(32, 'I')};
+    CHECK(trimmer.trim(read) == 12);
+    read = {{"r", "TTTTTTTTTTTTTTTTTTTTAG"}, std::string(22, 'I')};
+    CHECK(trimmer.trim(read) == 0);
+
+    auto reads = read_fastq(data_path / "has_adapter_1.fq");
+    const auto ans = read_fastq(data_path / "has_adapter_ans_1.fq");
+    trimmer.trim(reads);
+    auto same = 0;
+    for (auto i = 0u; i < reads.size(); i++)
+      same += reads[i].seq == ans[i].seq;
+    // Without a mate, adapters of a few bases cannot be told from the genome.
+    CHECK(same >= reads.size() * 0.95);
+  }
+
+  SECTION("Paired-end reproduces the answer") {
+    auto reads1 = read_fastq(data_path / "has_adapter_1.fq");
+    auto reads2 = read_fastq(data_path / "has_adapter_2.fq");
+    trimmer.trim(reads1, reads2);
+    CHECK(same_reads(reads1, read_fastq(data_path / "has_adapter_ans_1.fq")));
+    CHECK(same_reads(reads2, read_fastq(data_path / "has_adapter_ans_2.fq")));
+  }
+
+  SECTION("Paired-end streams") {
+    auto fin1 = std::ifstream{data_path / "has_adapter_1.fq"};
+    auto fin2 = std::ifstream{data_path / "has_adapter_2.fq"};
+    auto out1 = std::stringstream{}, out2 = std::stringstream{};
+    AdapterTrimmer{.BATCH_SIZE = 1000}.trim(fin1, fin2, out1, out2);
+    auto ans1 = std::ifstream{data_path / "has_adapter_ans_1.fq"};
+    auto ans2 = std::ifstream{data_path / "has_adapter_ans_2.fq"};
+    CHECK(out1.str()
+          == std::string(std::istreambuf_iterator<char>{ans1}, {}));
+    CHECK(out2.str()
+          == std::string(std::istreambuf_iterator<char>{ans2}, {}));
+  }
+}
@@ -0,0 +1,182 @@
+#include <biovoltron/algo/trim/quality_filter.hpp>
+#include <catch.hpp>
+#include <random>
+#include <sstream>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+make_read(std::string seq, std::string qual) {
+  return FastqRecord<>{{"r", std::move(seq)}, std::move(qual)};
+}
+
+auto
+random_read(std::mt19937& gen, std::size_t len) {
+  auto read = FastqRecord<>{};
+  read.name = "r";
+  for (auto i = 0u; i < len; i++) {
+    read.seq += "ACGT"[gen() % 4];
+    read.qual += char('!' + gen() % 42);
+  }
+  return read;
+}
+
+auto
+naive_window_trim(std::string_view qual, int size, int quality) {
+  for (auto i = 0u; i + size <= qual.size(); i++) {
+    auto sum = 0;
+    for (auto j = 0; j < size; j++) sum += qual[i + j] - '!';
+    if (sum < quality * size)
+      return std::size_t{i};
+  }
+  return qual.size();
+}
+
+}  // namespace
+
+TEST_CASE("QualityFilter") {
+  SECTION("BWA-style trimming") {
+    const auto filter = QualityFilter{.TRIM_QUALITY = 20, .MIN_LENGTH = 0};
+    // Qualities 40 40 40 40 10 10 10 2: the last four bases sum to 48.
+    auto read = make_read("ACGTACGT", "IIII+++#");
+    CHECK(filter.filter(read) == QualityFilter::PASS);
+    CHECK(read.seq == "ACGT");
+    CHECK(read.qual == "IIII");
+    read = make_read("ACGTACGT", "IIIIIIII");
+    filter.filter(read);
+    CHECK(read.seq.size() == 8);
+  }
+
+  SECTION("Sliding window against naive") {
+    auto gen = std::mt19937{};
+    for (auto window : {1, 4, 7}) {
+      const auto filter = QualityFilter{
+        .WINDOW_SIZE = window, .WINDOW_QUALITY = 15, .MIN_LENGTH = 0};
+      for (auto i = 0; i < 500; i++) {
+        auto read = random_read(gen, gen() % 150);
+        // Make low quality windows rare so that late cuts are tested too.
+        for (auto& q : read.qual) q = std::max<char>(q, '!' + 10);
+        const auto expect = naive_window_trim(read.qual, window, 15);
+        filter.filter(read);
+        CHECK(read.seq.size() == expect);
+      }
+    }
+  }
+
+  SECTION("Long windows") {
+    auto gen = std::mt19937{};
+    for (auto [window, quality] : std::vector<std::pair<int, int>>{
+           {16, 60}, {17, 20}, {500, 30}, {600, 90}}) {
+      const auto filter = QualityFilter{
+        .WINDOW_SIZE = window, .WINDOW_QUALITY = quality, .MIN_LENGTH = 0};
+      for (auto i = 0; i < 20; i++) {
+        auto read = random_read(gen, 1000 + gen() % 1000);
+        for (auto& q : read.qual) q = std::max<char>(q, '!' + quality - 15);
+        const auto expect = naive_window_trim(read.qual, window, quality);
+        filter.filter(read);
+        CHECK(read.seq.size() == expect);
+      }
+    }
+    const auto filter = QualityFilter{
+      .WINDOW_SIZE = 500, .WINDOW_QUALITY = 30, .MIN_LENGTH = 0};
+    auto read = make_read(std::string(1000, 'A'), std::string(1000, 'I'));
+    filter.filter(read);
+    CHECK(read.seq.size() == 1000);
+  }
+
+  SECTION("Filters") {
+    const auto filter = QualityFilter{
+      .MIN_LENGTH = 10, .MAX_N = 1, .MIN_MEAN_QUALITY = 20, .MAX_DUST = 4};
+    auto gen = std::mt19937{};
+    auto read = random_read(gen, 100);
+    read.qual = std::string(100, 'I');
+    CHECK(filter.filter(read) == QualityFilter::PASS);
+
+    auto short_read = make_read("ACGTACGTA", "IIIIIIIII");
+    CHECK(filter.filter(short_read) == QualityFilter::TOO_SHORT);
+
+    auto n_read = read;
+    n_read.seq[3] = n_read.seq[70] = 'N';
+    CHECK(filter.filter(n_read) == QualityFilter::TOO_MANY_N);
+    n_read.seq[70] = 'n';
+    CHECK(filter.filter(n_read) == QualityFilter::TOO_MANY_N);
+
+    auto low = read;
+    low.qual = std::string(50, 'I') + std::string(50, '!');
+    CHECK(filter.filter(low) == QualityFilter::PASS);
+    low.qual.front() = 'H';
+    CHECK(filter.filter(low) == QualityFilter::LOW_QUALITY);
+
+    auto repeat = make_read(std::string(60, 'A'), std::string(60, 'I'));
+    CHECK(filter.filter(repeat) == QualityFilter::LOW_COMPLEXITY);
+    repeat.seq.clear();
+    for (auto i = 0; i < 30; i++) repeat.seq += "CA";
+    CHECK(filter.filter(repeat) == QualityFilter::LOW_COMPLEXITY);
+
+    // 69,998 trinucleotides, more than a 16-bit count holds.
+    const auto long_repeat
+      = make_read(std::string(70000, 'A'), std::string(70000, 'I'));
+    const auto dust = (70000 - 2) / 2.0;
+    auto copy = long_repeat;
+    CHECK(QualityFilter{.MAX_DUST = dust - 1}.filter(copy)
+          == QualityFilter::LOW_COMPLEXITY);
+    copy = long_repeat;
+    CHECK(QualityFilter{.MAX_DUST = dust}.filter(copy) == QualityFilter::PASS);
+
+    const auto disabled = QualityFilter{
+      .MIN_LENGTH = 0, .MAX_N = std::numeric_limits<std::size_t>::max()};
+    for (auto r : {read, short_read, n_read, low, repeat})
+      CHECK(disabled.filter(r) == QualityFilter::PASS);
+    n_read.seq[70] = 'A';
+    CHECK(QualityFilter{.MAX_N = 0}.filter(n_read)
+          == QualityFilter::TOO_MANY_N);
+  }
+
+  SECTION("Batches and streams") {
+    const auto filter = QualityFilter{
+      .WINDOW_QUALITY = 20, .MIN_LENGTH = 30, .BATCH_SIZE = 100};
+    auto gen = std::mt19937{};
+    auto reads = std::vector<FastqRecord<>>{};
+    for (auto i = 0; i < 1000; i++) {
+      auto read = random_read(gen, 100);
+      for (auto j = 0; j < 100; j++)
+        read.qual[j] = j < 20 + i % 80 ? 'I' : '#';
+      if (i % 10 == 0)
+        read.seq.replace(0, 6, "NNNNNN");
+      reads.push_back(read);
+    }
+    auto ss = std::stringstream{};
+    for (const auto& read : reads) ss << read << "\n";
+
+    auto expect = std::stringstream{};
+    auto expect_counts = QualityFilter::Counts{};
+    for (auto read : reads) {
+      const auto result = filter.filter(read);
+      if (result == QualityFilter::PASS)
+        expect << read << "\n";
+      expect_counts.passed += result == QualityFilter::PASS;
+      expect_counts.too_short += result == QualityFilter::TOO_SHORT;
+      expect_counts.too_many_n += result == QualityFilter::TOO_MANY_N;
+    }
+    CHECK(expect_counts.too_short > 0);
+    CHECK(expect_counts.too_many_n > 0);
+
+    auto batch = reads;
+    CHECK(filter.filter(batch) == expect_counts);
+    CHECK(batch.size() == expect_counts.passed);
+
+    auto out = std::stringstream{};
+    CHECK(filter.filter(ss, out) == expect_counts);
+    CHECK(out.str() == expect.str());
+
+    auto reads1 = reads, reads2 = reads;
+    std::ranges::reverse(reads2);
+    const auto counts = filter.filter(reads1, reads2);
+    CHECK(counts.passed == reads1.size());
+    CHECK(counts.passed < expect_counts.passed);
+    CHECK(reads2.size() == reads1.size());
+    CHECK_THROWS_AS(filter.filter(reads1, batch), std::invalid_argument);
+  }
+}
@@ -0,0 +1,103 @@
+#include <biovoltron/file_io/bcf.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace biovoltron;
+
+namespace {
+
+template<class T>
+concept info_type
+  = requires(BcfReader& reader) { reader.get_info<T>("AA"); };
+
+template<class T>
+concept format_type
+  = requires(BcfReader& reader) { reader.get_format<T>("GT"); };
+
+}  // namespace
+
+TEST_CASE("Bcf") {
+  const auto vcf = std::filesystem::path{DATA_PATH} / "test1.vcf";
+  const auto path
+    = std::filesystem::temp_directory_path() / "biovoltron_bcf.bcf";
+
+  auto fin = std::ifstream{vcf};
+  auto header = VcfHeader{};
+  fin >> header;
+  auto records = std::vector<VcfRecord>{};
+  for (auto record = VcfRecord{}; fin >> record;) records.push_back(record);
+  {
+    auto writer = BcfWriter{path, header, 2};
+    for (const auto& record : records) writer.write(record);
+  }
+
+  SECTION("Round trip") {
+    auto reader = BcfReader{path, 2};
+    CHECK(reader.header.samples == header.samples);
+    CHECK(reader.header.info_id("DP") >= 0);
+    for (const auto& expected : records) {
+      auto record = VcfRecord{};
+      REQUIRE(reader.read(record));
+      CHECK(record.chrom == expected.chrom);
+      CHECK(record.pos == expected.pos);
+      CHECK(record.id == expected.id);
+      CHECK(record.ref == expected.ref);
+      CHECK(record.alt == expected.alt);
+      CHECK(record.qual == expected.qual);
+      CHECK(record.filter == expected.filter);
+      CHECK(record.info == expected.info);
+      CHECK(record.format == expected.format);
+      CHECK(record.samples.size() == expected.samples.size());
+    }
+    auto record = VcfRecord{};
+    CHECK_FALSE(reader.read(record));
+  }
+
+  SECTION("Typed access") {
+    static_assert(info_type<std::string_view>);
+    static_assert(!info_type<std::vector<std::string>>);
+    static_assert(format_type<std::vector<int>>);
+    static_assert(!format_type<std::string_view>);
+    auto reader = BcfReader{path};
+    for (const auto& expected : records) {
+      REQUIRE(reader.read());
+      CHECK(reader.chrom() == expected.chrom);
+      CHECK(reader.pos() == expected.pos);
+      CHECK(reader.get_info<int>("DP") == expected.get_info<int>("DP"));
+      CHECK(reader.get_info<bool>("DB") == expected.get_info<bool>("DB"));
+      CHECK(reader.get_info<std::string>("AA")
+            == expected.get_info<std::string>("AA"));
+      CHECK(reader.get_info<std::string_view>("AA")
+            == expected.get_info<std::string_view>("AA"));
+      CHECK(reader.get_format<int>("GQ") == expected.get_format<int>("GQ"));
+      // Converted from the type in the header.
+      CHECK(reader.get_info<double>("DP") == expected.get_info<double>("DP"));
+      CHECK(reader.get_format<double>("GQ")
+            == expected.get_format<double>("GQ"));
+      if (const auto af = expected.get_info<std::vector<double>>("AF")) {
+        const auto truncated = reader.get_info<std::vector<int>>("AF");
+        REQUIRE(truncated);
+        CHECK(truncated->size() == af->size());
+      }
+      const auto genotypes = reader.get_format<std::string>("GT");
+      const auto expected_genotypes
+        = expected.get_format<std::string>("GT");
+      CHECK(genotypes == expected_genotypes);
+    }
+  }
+
+  SECTION("Qualities") {
+    // A float QUAL written in full, not in 6 digits.
+    {
+      auto writer = BcfWriter{path, header};
+      writer.write({{}, nullptr, "20", 14370, ".", "G", "A", 1234567.5, "PASS",
+                    "."});
+    }
+    auto reader = BcfReader{path};
+    REQUIRE(reader.read());
+    CHECK(reader.qual() == 1234567.5);
+  }
+
+  std::filesystem::remove(path);
+}
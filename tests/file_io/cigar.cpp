@@ -72,6 +72,48 @@ TEST_CASE("Cigar") {
     CHECK(cigar.read_size() == 15);
   }
 
+  SECTION("Clip size") {
+    // Only count: S, H.
+    auto cigar = Cigar{"1M2I3S4=5X6H"};
+    CHECK(cigar.clip_size() == 9);
+  }
+
+  SECTION("Sizes after mutation") {
+    auto cigar = Cigar{"5S10M2I3D10M"};
+    const auto sizes = [&cigar] {
+      return std::tuple{cigar.ref_size(), cigar.read_size(), cigar.clip_size()};
+    };
+    CHECK(sizes() == std::tuple{23, 27, 5});
+    cigar.emplace_back(4, 'H');
+    CHECK(sizes() == std::tuple{23, 27, 9});
+    cigar.push_back({6, 'N'});
+    CHECK(sizes() == std::tuple{29, 27, 9});
+    cigar.append(Cigar{"1M1S"});
+    CHECK(sizes() == std::tuple{30, 29, 10});
+    cigar.pop_front();
+    CHECK(sizes() == std::tuple{30, 24, 5});
+    cigar.pop_back();
+    CHECK(sizes() == std::tuple{30, 23, 4});
+    cigar.reverse();
+    cigar.compact();
+    CHECK(sizes() == std::tuple{30, 23, 4});
+    cigar.front() = {2, 'M'};
+    CHECK(sizes() == std::tuple{31, 24, 4});
+    cigar[1] = Cigar::Element{6, 'S'};
+    CHECK(sizes() == std::tuple{25, 30, 10});
+    cigar = "7M";
+    CHECK(sizes() == std::tuple{7, 7, 0});
+    cigar.clear();
+    CHECK(sizes() == std::tuple{0, 0, 0});
+  }
+
+  SECTION("Consumption") {
+    CHECK(Cigar::consumes_ref('N'));
+    CHECK_FALSE(Cigar::consumes_ref('I'));
+    CHECK(Cigar::consumes_read('S'));
+    CHECK_FALSE(Cigar::consumes_read('H'));
+  }
+
   SECTION("Begin, end, front, back, operator[]") {
     auto cigar = Cigar{"1M2D3I"};
 
@@ -115,6 +157,64 @@ TEST_CASE("Cigar") {
     CHECK(cigar.size() == 3);
   }
 
+  SECTION("Packed storage") {
+    auto cigar = Cigar{"1M2D3I"};
+    CHECK(cigar.data()[0] == (1u << 4 | 0));
+    CHECK(cigar.data()[1] == (2u << 4 | 2));
+    CHECK(cigar.data()[2] == (3u << 4 | 1));
+    CHECK(Cigar::unpack(Cigar::pack({7, 'X'})) == Cigar::Element{7, 'X'});
+    static_assert(std::random_access_iterator<Cigar::Iterator>);
+  }
+
+  SECTION("Growing beyond the inline elements") {
+    auto cigar = Cigar{"1S2M3I4M5D6M7N8M9H"};
+    CHECK(cigar.size() == 9);
+    CHECK(cigar == "1S2M3I4M5D6M7N8M9H"s);
+    for (auto i = 10u; i < 40; i++) cigar.emplace_back(i, i % 2 ? 'M' : 'I');
+    CHECK(cigar.size() == 39);
+    CHECK(cigar[38] == Cigar::Element{39, 'M'});
+
+    auto copy = cigar;
+    CHECK(copy == cigar);
+    auto moved = std::move(copy);
+    CHECK(moved == cigar);
+    CHECK(copy.size() == 0);
+
+    auto small = Cigar{"5M"};
+    small = moved;
+    CHECK(small == cigar);
+    small = Cigar{"5M"};
+    CHECK(small == "5M"s);
+  }
+
+  SECTION("Mutable element access") {
+    auto cigar = Cigar{"5S10M5S"};
+    cigar.front() = {5, 'M'};
+    cigar[2] = cigar[1];
+    CHECK(cigar == "5M10M10M"s);
+    CHECK(Cigar::Element(cigar.back()).size == 10);
+    cigar.compact();
+    CHECK(cigar == "25M"s);
+
+    cigar = "5S10M2I";
+    CHECK(cigar[0].size() == 5);
+    CHECK(cigar[0].op() == 'S');
+    CHECK(cigar.back().op() == 'I');
+    CHECK(std::as_const(cigar)[1].size == 10);
+    cigar[0].set_op('M');
+    cigar.back().set_size(4);
+    cigar[1].set_size(cigar[1].size() + 1).set_op('=');
+    CHECK(cigar == "5M11=4I"s);
+    CHECK(cigar.ref_size() == 16);
+    CHECK(cigar.read_size() == 20);
+    CHECK(cigar.clip_size() == 0);
+  }
+
+  SECTION("Unavailable") {
+    auto cigar = Cigar{"*"};
+    CHECK(cigar.size() == 0);
+  }
+
   SECTION("Operator<<") {
     auto cigar = Cigar{"1M2D3I"};
     auto ss = std::stringstream{};
@@ -0,0 +1,160 @@
+#include <biovoltron/file_io/tabix.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <htslib/bgzf.h>
+#include <sstream>
+
+using namespace biovoltron;
+
+namespace {
+
+/*
+ * Bgzip a VCF into a temporary file and index it, as tabix and bgzip do.
+ */
+auto
+bgzip(const std::string& vcf, const std::string& name, int min_shift) {
+  const auto path = std::filesystem::temp_directory_path() / name;
+  const auto bgzf = bgzf_open(path.c_str(), "w");
+  REQUIRE(bgzf != nullptr);
+  REQUIRE(bgzf_write(bgzf, vcf.data(), vcf.size()) == ssize_t(vcf.size()));
+  REQUIRE(bgzf_close(bgzf) == 0);
+  REQUIRE(tbx_index_build(path.c_str(), min_shift, &tbx_conf_vcf) == 0);
+  return path;
+}
+
+auto
+remove_bgzip(const std::filesystem::path& path) {
+  for (const auto extension : {"", ".tbi", ".csi"})
+    std::filesystem::remove(path.string() + extension);
+}
+
+}  // namespace
+
+TEST_CASE("Tabix") {
+  SECTION("Query") {
+    auto fin = std::ifstream{std::filesystem::path{DATA_PATH} / "test1.vcf"};
+    const auto vcf = std::string{std::istreambuf_iterator<char>{fin}, {}};
+    const auto path = bgzip(vcf, "biovoltron_tabix.vcf.gz", 0);
+    auto reader = TabixReader{path};
+    CHECK(reader.header.samples.size() == 3);
+
+    auto positions = std::vector<std::uint32_t>{};
+    for (const auto& record : reader.query(Interval{"20:1110000-1240000"}))
+      positions.push_back(record.pos);
+    CHECK(positions
+          == std::vector<std::uint32_t>{1110696, 1230237, 1234567});
+
+    // The REF of 1234567 spans up to 1234569.
+    positions.clear();
+    for (const auto& record : reader.query(Interval{"20", 1234568, 1234570}))
+      positions.push_back(record.pos);
+    CHECK(positions == std::vector<std::uint32_t>{1234567});
+
+    auto query = reader.query(Interval{"Y:0-100000"});
+    auto it = query.begin();
+    REQUIRE(it != query.end());
+    CHECK(it->chrom == "Y");
+    CHECK(it->samples
+          == std::vector<std::string>{"0:0,49", "0:0,3", "1:41,0"});
+    CHECK(++it == query.end());
+
+    CHECK(std::ranges::distance(reader.query(Interval{"X:0-100000"})) == 0);
+    remove_bgzip(path);
+  }
+
+  SECTION("Structural variants") {
+    // The deletion spans up to its END, over three chunks.
+    const auto vcf = std::string{
+      "##fileformat=VCFv4.2\n"
+      "##INFO=<ID=END,Number=1,Type=Integer,Description=\"End\">\n"
+      "##contig=<ID=chr1>\n"
+      "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n"
+      "chr1\t100\t.\tA\t<DEL>\t50\tPASS\tEND=50000\n"
+      "chr1\t20050\t.\tA\tC\t50\tPASS\t.\n"
+      "chr1\t70000\t.\tA\tC\t50\tPASS\t.\n"};
+    for (const auto min_shift : {0, 14}) {
+      const auto path = bgzip(vcf, "biovoltron_sv.vcf.gz", min_shift);
+      auto reader = TabixReader{path};
+      reader.MERGE_DISTANCE = 0;
+      auto positions = std::vector<std::uint32_t>{};
+      for (const auto& record : reader.query(
+             {Interval{"chr1:1000-1100"}, Interval{"chr1:20000-20100"},
+              Interval{"chr1:40000-40100"}, Interval{"chr1:60000-60100"}}))
+        positions.push_back(record.pos);
+      CHECK(positions == std::vector<std::uint32_t>{100, 20050});
+
+      positions.clear();
+      for (const auto& record : reader.query(Interval{"chr1:49999-50100"}))
+        positions.push_back(record.pos);
+      CHECK(positions == std::vector<std::uint32_t>{100});
+      CHECK(std::ranges::distance(reader.query(Interval{"chr1:50000-60000"}))
+            == 0);
+      remove_bgzip(path);
+    }
+  }
+
+  SECTION("Exons of gene.bed") {
+    // A variant every 200 bases around the genes of gene.bed.
+    auto exons = std::vector<Interval>{};
+    auto bed = std::ifstream{std::filesystem::path{DATA_PATH} / "gene.bed"};
+    for (auto line = std::string{}; std::getline(bed, line);) {
+      auto iss = std::istringstream{line};
+      auto chrom = std::string{}, name = std::string{}, sizes = std::string{},
+           starts = std::string{};
+      auto begin = std::uint32_t{}, end = std::uint32_t{}, count = 0u;
+      auto ignored = std::string{};
+      iss >> chrom >> begin >> end >> name >> ignored >> ignored >> ignored
+        >> ignored >> ignored >> count >> sizes >> starts;
+      std::replace(sizes.begin(), sizes.end(), ',', ' ');
+      std::replace(starts.begin(), starts.end(), ',', ' ');
+      auto size_stream = std::istringstream{sizes};
+      auto start_stream = std::istringstream{starts};
+      for (auto i = 0u; i < count; i++) {
+        auto size = std::uint32_t{}, start = std::uint32_t{};
+        size_stream >> size;
+        start_stream >> start;
+        exons.emplace_back(chrom, begin + start, begin + start + size);
+      }
+    }
+    REQUIRE(!exons.empty());
+
+    auto vcf = std::string{
+      "##fileformat=VCFv4.2\n"
+      "##contig=<ID=chr1>\n##contig=<ID=chr2>\n"
+      "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n"};
+    auto all = std::vector<VcfRecord>{};
+    for (const auto chrom : {"chr1", "chr2"})
+      for (auto pos = 1u; pos < 3'100'000; pos += 200) {
+        const auto ref = pos % 1000 == 1 ? "ACGT" : "A";
+        vcf += std::string{chrom} + "\t" + std::to_string(pos) + "\t.\t" + ref
+               + "\tC\t50\tPASS\t.\n";
+        all.push_back({{}, nullptr, chrom, pos, ".", ref, "C", 50, "PASS",
+                       "."});
+      }
+    const auto expected = [&] {
+      auto expected = std::vector<std::pair<std::string, std::uint32_t>>{};
+      for (const auto& record : all)
+        if (std::ranges::any_of(exons, [&](auto exon) {
+              exon.strand = '+';
+              return exon.overlaps(record);
+            }))
+          expected.emplace_back(record.chrom, record.pos);
+      return expected;
+    }();
+    REQUIRE(!expected.empty());
+
+    for (const auto min_shift : {0, 14}) {
+      const auto path = bgzip(vcf, "biovoltron_exons.vcf.gz", min_shift);
+      for (const auto distance : {0u, 1u << 14}) {
+        auto reader = TabixReader{path, 2};
+        reader.MERGE_DISTANCE = distance;
+        auto found = std::vector<std::pair<std::string, std::uint32_t>>{};
+        for (const auto& record : reader.query(exons))
+          found.emplace_back(record.chrom, record.pos);
+        CHECK(found == expected);
+      }
+      remove_bgzip(path);
+    }
+  }
+}
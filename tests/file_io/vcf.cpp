@@ -1,6 +1,7 @@
 #include <biovoltron/file_io/vcf.hpp>
 #include <catch.hpp>
 #include <filesystem>
+#include <fstream>
 #include <sstream>
 
 using namespace biovoltron;
@@ -31,4 +32,83 @@ TEST_CASE("vcf") {
   REQUIRE(r.samples[1] == "2|1:2:0:18,2");
   REQUIRE(r.samples[2] == "2/2:35:4");
   REQUIRE(Interval{r} == Interval{"20", 1110696 - 1, 1110696, '+'});
+  r.info = "SVTYPE=DEL;END=1120000";
+  REQUIRE(Interval{r} == Interval{"20", 1110696 - 1, 1120000, '+'});
+  r.info = "DP=10";
+  r.ref = "GTC";
+  REQUIRE(Interval{r} == Interval{"20", 1110696 - 1, 1110696 + 2, '+'});
+}
+
+TEST_CASE("vcf schema") {
+  auto fin = std::ifstream{data_path / "test1.vcf"};
+  auto header = VcfHeader{};
+  fin >> header;
+
+  SECTION("Header") {
+    REQUIRE(header.infos.size() == 7);
+    REQUIRE(header.info_id("DP") == 1);
+    REQUIRE(header.infos[1].type == VcfHeader::INTEGER);
+    REQUIRE(header.infos[2].number == "A");
+    REQUIRE(header.infos[4].type == VcfHeader::FLAG);
+    REQUIRE(header.infos[4].description == "dbSNP membership, build 129");
+    REQUIRE(header.formats.size() == 5);
+    REQUIRE(header.format_id("GQ") == 1);
+    REQUIRE(header.format_id("XX") == -1);
+    REQUIRE(header.filters
+            == std::vector<std::string>{"PASS", "q10", "s50"});
+    REQUIRE(header.filter_id("s50") == 2);
+    REQUIRE(header.contigs.size() == 3);
+    REQUIRE(header.contig_id("20") == 1);
+    REQUIRE(header.contigs[1].length == 63025520);
+    REQUIRE(header.samples
+            == std::vector<std::string>{"NA00001", "NA00002", "NA00003"});
+  }
+
+  SECTION("Typed getters") {
+    auto r = VcfRecord{};
+    fin >> r >> r >> r;
+    REQUIRE(r.pos == 1110696);
+    REQUIRE(r.get_info<int>("DP") == 10);
+    REQUIRE(r.get_info<int>("D") == std::nullopt);
+    REQUIRE(r.get_info<std::string>("AA") == "T");
+    REQUIRE(r.get_info<std::vector<double>>("AF")
+            == std::vector{0.333, 0.667});
+    REQUIRE(r.get_info<bool>("DB"));
+    REQUIRE_FALSE(r.get_info<bool>("H2"));
+    REQUIRE(r.get_format<std::string_view>("GT")
+            == std::vector<std::optional<std::string_view>>{"1|2", "2|1",
+                                                             "2/2"});
+    REQUIRE(r.get_format<int>("GQ")
+            == std::vector<std::optional<int>>{21, 2, 35});
+    REQUIRE(r.get_format<std::vector<int>>("HQ")
+            == std::vector<std::optional<std::vector<int>>>{
+              std::vector{23, 27}, std::vector{18, 2}, std::nullopt});
+
+    const auto fields = VcfFields{r, header};
+    const auto dp = header.info_id("DP");
+    REQUIRE(fields.info<int>(dp) == 10);
+    REQUIRE(fields.info<int>(header.info_id("NS")) == 2);
+    REQUIRE(fields.info<bool>(header.info_id("DB")));
+    REQUIRE_FALSE(fields.info<bool>(header.info_id("H2")));
+    REQUIRE_FALSE(fields.info<int>(-1));
+    REQUIRE(fields.info<double>("AF") == std::nullopt);
+    REQUIRE(fields.format<int>(header.format_id("GQ"), 2) == 35);
+    REQUIRE(fields.format<int>(header.format_id("HQ"), 2) == std::nullopt);
+    REQUIRE(fields.format<int>("DP")
+            == std::vector<std::optional<int>>{6, 0, 4});
+    REQUIRE(fields.format<int>(header.format_id("GL"))
+            == std::vector<std::optional<int>>(3));
+  }
+
+  SECTION("Reused index") {
+    auto fields = VcfFields{header};
+    const auto ns = header.info_id("NS");
+    const auto aa = header.info_id("AA");
+    for (auto r = VcfRecord{}; fin >> r;) {
+      fields.assign(r);
+      REQUIRE(fields.info<int>(ns) == r.get_info<int>("NS"));
+      REQUIRE(fields.info<std::string>(aa) == r.get_info<std::string>("AA"));
+      REQUIRE(fields.format<int>("GQ") == r.get_format<int>("GQ"));
+    }
+  }
 }
@@ -0,0 +1,99 @@
+#include <biovoltron/file_io/vcf_reader.hpp>
+#include <catch.hpp>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace biovoltron;
+
+TEST_CASE("VcfReader") {
+  SECTION("Columns") {
+    auto iss = std::istringstream{
+      "##fileformat=VCFv4.1\n"
+      "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tA\tB\tC\n"
+      "20\t1110696\trs6040355\tA\tG,T\t67\tPASS\tNS=2;DP=10;AF=0.333,0.667;"
+      "AA=T;DB\tGT:GQ:DP:HQ\t1|2:21:6:23,27\t2|1:2:0:18,2\t2/2:35:4\r\n"
+      "\n"
+      "20\t1230237\t.\tT\t.\t.\tq10\tNS=3"};
+    auto reader = VcfReader{iss};
+    CHECK(reader.header.lines.size() == 2);
+
+    REQUIRE(reader.read());
+    CHECK(reader.chrom() == "20");
+    CHECK(reader.pos() == 1110696);
+    CHECK(reader.id() == "rs6040355");
+    CHECK(reader.ref() == "A");
+    CHECK(reader.alt() == "G,T");
+    CHECK(reader.qual() == 67);
+    CHECK(reader.filter() == "PASS");
+    CHECK(reader.info() == "NS=2;DP=10;AF=0.333,0.667;AA=T;DB");
+    CHECK(reader.info("DP") == "10");
+    CHECK(reader.info("AF") == "0.333,0.667");
+    CHECK(reader.info("DB") == "");
+    CHECK_FALSE(reader.info("D"));
+    CHECK(reader.format() == "GT:GQ:DP:HQ");
+    CHECK(reader.samples() == "1|2:21:6:23,27\t2|1:2:0:18,2\t2/2:35:4");
+    CHECK(reader.sample_list().size() == 3);
+    CHECK(reader.sample(2) == "2/2:35:4");
+
+    REQUIRE(reader.read());
+    CHECK(reader.pos() == 1230237);
+    CHECK(std::isnan(reader.qual()));
+    CHECK(reader.filter() == "q10");
+    CHECK(reader.info() == "NS=3");
+    CHECK(reader.format().empty());
+    CHECK(reader.sample_list().empty());
+    CHECK_FALSE(reader.read());
+  }
+
+  SECTION("Same records as VcfRecord") {
+    auto fin = std::ifstream{std::filesystem::path{DATA_PATH} / "test.vcf"};
+    auto header = VcfHeader{};
+    fin >> header;
+    auto expected = std::vector<VcfRecord>{};
+    for (auto record = VcfRecord{}; fin >> record;) expected.push_back(record);
+
+    fin = std::ifstream{std::filesystem::path{DATA_PATH} / "test.vcf"};
+    auto reader = VcfReader{fin};
+    CHECK(reader.header == header);
+    for (const auto& record : expected) {
+      REQUIRE(reader.read());
+      const auto read = reader.to_record();
+      CHECK(read.chrom == record.chrom);
+      CHECK(read.pos == record.pos);
+      CHECK(read.id == record.id);
+      CHECK(read.ref == record.ref);
+      CHECK(read.alt == record.alt);
+      // The stream parser of VcfRecord stops at a missing QUAL.
+      if (std::isnan(read.qual))
+        continue;
+      CHECK(read.qual == record.qual);
+      CHECK(read.filter == record.filter);
+      CHECK(read.info == record.info);
+      CHECK(read.format == record.format);
+      CHECK(read.samples == record.samples);
+    }
+    CHECK_FALSE(reader.read());
+  }
+
+  SECTION("Lines longer than a block") {
+    auto samples = std::string{};
+    for (auto i = 0; i < 100000; i++) samples += "\t0|1:35:" + std::to_string(i);
+    auto vcf = std::string{"#CHROM\n"};
+    for (auto i = 1; i <= 30; i++)
+      vcf += "1\t" + std::to_string(i) + "\t.\tA\tC\t50\tPASS\t.\tGT:GQ:DP"
+             + samples + "\n";
+    auto iss = std::istringstream{vcf};
+    auto reader = VcfReader{iss};
+    for (auto i = 1u; i <= 30; i++) {
+      REQUIRE(reader.read());
+      CHECK(reader.pos() == i);
+      if (i % 10 == 0) {
+        CHECK(reader.sample_list().size() == 100000);
+        CHECK(reader.sample(99999) == "0|1:35:99999");
+      }
+    }
+    CHECK_FALSE(reader.read());
+  }
+}
@@ -0,0 +1,66 @@
+#include <biovoltron/utility/archive/quality_codec.hpp>
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/utility/read/quality_binner.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+read_quals(const std::filesystem::path& path) {
+  auto quals = std::vector<std::string>{};
+  auto fin = std::ifstream{path};
+  for (auto read = FastqRecord<>{}; fin >> read;) quals.push_back(read.qual);
+  return quals;
+}
+
+auto
+size_of(const std::vector<std::string>& quals) {
+  auto size = std::size_t{};
+  for (const auto& qual : quals) size += qual.size();
+  return size;
+}
+
+}  // namespace
+
+TEST_CASE("QualityCodec") {
+  SECTION("Empty blocks") {
+    const auto none = std::vector<std::string>{};
+    CHECK(QualityCodec::decompress(QualityCodec::compress(none)).empty());
+    const auto empty = std::vector<std::string>{"", "", ""};
+    CHECK(QualityCodec::decompress(QualityCodec::compress(empty)) == empty);
+    const auto single = std::vector<std::string>{"I"};
+    CHECK(QualityCodec::decompress(QualityCodec::compress(single)) == single);
+  }
+
+  SECTION("Random qualities") {
+    auto gen = std::mt19937{};
+    auto quals = std::vector<std::string>(500);
+    for (auto& qual : quals)
+      for (auto len = gen() % 300; qual.size() < len;)
+        qual += char(gen() % 256);
+    const auto block = QualityCodec::compress(quals);
+    CHECK(QualityCodec::decompress(block) == quals);
+    CHECK_THROWS_AS(QualityCodec::decompress(block.substr(0, 1)),
+                    std::runtime_error);
+  }
+
+  SECTION("Sequencer qualities") {
+    const auto path = std::filesystem::path{DATA_PATH} / "test1.fastq";
+    auto quals = read_quals(path);
+    REQUIRE(!quals.empty());
+    const auto raw = QualityCodec::compress(quals);
+    CHECK(QualityCodec::decompress(raw) == quals);
+    CHECK(raw.size() < size_of(quals) / 2);
+
+    const auto binner = QualityBinner::illumina8();
+    for (auto& qual : quals) binner.bin(qual);
+    const auto binned = QualityCodec::compress(quals);
+    CHECK(QualityCodec::decompress(binned) == quals);
+    CHECK(binned.size() <= raw.size());
+  }
+}
@@ -0,0 +1,125 @@
+#include <biovoltron/utility/archive/read_archive.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using namespace biovoltron;
+
+namespace {
+
+auto
+read_fastq(const std::filesystem::path& path) {
+  auto reads = std::vector<FastqRecord<>>{};
+  auto fin = std::ifstream{path};
+  for (auto read = FastqRecord<>{}; fin >> read;) reads.push_back(read);
+  return reads;
+}
+
+auto
+same_reads(const std::vector<FastqRecord<>>& a,
+           const std::vector<FastqRecord<>>& b) {
+  auto same = a.size() == b.size();
+  for (auto i = 0u; same && i < a.size(); i++)
+    same = a[i].name == b[i].name && a[i].seq == b[i].seq
+           && a[i].qual == b[i].qual;
+  return same;
+}
+
+/*
+ * Output buffer which cannot seek, as the one of a pipe.
+ */
+struct PipeBuffer : std::streambuf {
+  std::string data;
+
+  auto
+  overflow(int_type c) -> int_type override {
+    data += traits_type::to_char_type(c);
+    return c;
+  }
+};
+
+}  // namespace
+
+TEST_CASE("ReadArchive") {
+  const auto path
+    = std::filesystem::temp_directory_path() / "biovoltron_read_archive.fqa";
+
+  SECTION("Blocks") {
+    auto reads = std::vector<FastqRecord<>>{
+      {{"A00709:43:HYG25DSXX:1:1101:3640:1000", "ACGTNNACGTA"}, "FFFF##FFFF:"},
+      {{"A00709:43:HYG25DSXX:1:1101:6189:1000", "NNNN"}, "####"},
+      {{"A00709:43:HYG25DSXX:1:1101:6189:999", ""}, ""},
+      {{"read_007", "acgtRYacgt"}, "IIIIIIIIII"},
+      {{"read_7", "T"}, "I"},
+      {{"", "GATTACA"}, "IIIIIII"},
+      {{"a1b2c3d4e5f6g7h8i9j10k11", "A"}, "I"},
+      {{"a1b2c3d4e5f6g7h8i9j10k12", "C"}, "I"},
+      {{"r\xe9ad\xb2_42\xff", "G"}, "I"}};
+    const auto decoded
+      = ReadArchive::decompress_block(ReadArchive::compress_block(reads));
+    reads[3].seq = "ACGTNNACGT";
+    CHECK(same_reads(decoded, reads));
+    CHECK(ReadArchive::decompress_block(ReadArchive::compress_block({}))
+            .empty());
+
+    // Repeated sequences are deflated.
+    const auto repeated = std::vector<FastqRecord<>>(
+      1000, {{"read", std::string(100, 'A') + std::string(100, 'C')},
+             std::string(200, 'I')});
+    const auto block = ReadArchive::compress_block(repeated);
+    CHECK(block.size() < 1000 * 200 / 4 / 2);
+    CHECK(same_reads(ReadArchive::decompress_block(block), repeated));
+  }
+
+  SECTION("Random access") {
+    const auto reads
+      = read_fastq(std::filesystem::path{DATA_PATH} / "adapter_trimmer"
+                   / "has_adapter_1.fq");
+    {
+      auto fin = std::ifstream{std::filesystem::path{DATA_PATH}
+                               / "adapter_trimmer" / "has_adapter_1.fq"};
+      auto fout = std::ofstream{path, std::ios::binary};
+      ReadArchive{.BLOCK_SIZE = 1000}.save(fin, fout);
+    }
+    auto archive = ReadArchive{};
+    archive.load(path);
+    REQUIRE(archive.size() == reads.size());
+    CHECK(archive.blocks() == 10);
+    CHECK(std::filesystem::file_size(path) < 2218894 / 3);
+    CHECK(same_reads(archive.read(0, archive.size()), reads));
+    CHECK(same_reads(archive.read(999, 2001),
+                     {reads.begin() + 999, reads.begin() + 2001}));
+    CHECK(archive.read(5, 5).empty());
+    const auto read = archive.get(4321);
+    CHECK(read.name == reads[4321].name);
+    CHECK(read.seq == reads[4321].seq);
+    CHECK_THROWS_AS(archive.read(0, reads.size() + 1), std::out_of_range);
+
+    auto ss = std::stringstream{};
+    ReadArchive{}.save(std::span{reads}.first(10), ss);
+    {
+      auto fout = std::ofstream{path, std::ios::binary};
+      fout << ss.str();
+    }
+    archive.load(path);
+    CHECK(archive.blocks() == 1);
+    CHECK(same_reads(archive.block(0), {reads.begin(), reads.begin() + 10}));
+
+    auto buffer = PipeBuffer{};
+    auto pipe = std::ostream{&buffer};
+    REQUIRE(pipe.tellp() == -1);
+    ReadArchive{}.save(std::span{reads}.first(10), pipe);
+    CHECK(buffer.data == ss.str());
+  }
+
+  SECTION("Not an archive") {
+    {
+      auto fout = std::ofstream{path};
+      fout << "@r\nACGT\n+\nIIII\n";
+    }
+    CHECK_THROWS_AS(ReadArchive{}.load(path), std::runtime_error);
+  }
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,96 @@
+#include <biovoltron/utility/archive/serializer.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace biovoltron;
+
+TEST_CASE("Serializer") {
+  const auto path
+    = std::filesystem::temp_directory_path() / "biovoltron_serializer.bin";
+  {
+    auto fout = std::ofstream{path, std::ios::binary};
+    auto writer = Serializer::Writer{fout};
+    writer.save(42u);
+    writer.save(std::vector{1, 2, 3});
+    writer.save('x');
+    writer.save(std::vector<double>{0.5});
+    writer.save(std::vector<bool>{true, false, true});
+  }
+
+  {
+    auto fin = std::ifstream{path, std::ios::binary};
+    auto value = 0u;
+    auto ints = std::vector<int>{};
+    auto c = char{};
+    auto doubles = std::vector<double>{};
+    auto bools = std::vector<bool>{};
+    auto loader = Serializer::Loader{fin};
+    loader.load(value);
+    loader.load(ints);
+    loader.load(c);
+    loader.load(doubles);
+    loader.load(bools);
+    CHECK(value == 42u);
+    CHECK(ints == std::vector{1, 2, 3});
+    CHECK(c == 'x');
+    CHECK(doubles == std::vector{0.5});
+    CHECK(bools == std::vector{true, false, true});
+  }
+
+  {
+    // An archive after other data is padded from its own beginning.
+    auto alone = std::ostringstream{};
+    Serializer::Writer{alone}.save(std::vector{1, 2, 3});
+    auto ss = std::stringstream{};
+    ss << "head";
+    Serializer::Writer{ss}.save(std::vector{1, 2, 3});
+    CHECK(ss.str() == "head" + alone.str());
+
+    auto head = std::string(4, '\0');
+    ss.read(head.data(), head.size());
+    auto ints = std::vector<int>{};
+    Serializer::Loader{ss}.load(ints);
+    CHECK(ints == std::vector{1, 2, 3});
+
+    auto truncated = std::istringstream{alone.str().substr(0, 70)};
+    CHECK_THROWS_AS(Serializer::Loader{truncated}.load(ints),
+                    std::runtime_error);
+  }
+
+  {
+    auto bytes = std::string{};
+    const auto values
+      = std::vector<std::uint64_t>{0, 127, 128, 300, ~std::uint64_t{}};
+    for (const auto value : values) Serializer::put_varint(bytes, value);
+    CHECK(bytes.size() == 1 + 1 + 2 + 2 + 10);
+    auto pos = std::size_t{};
+    for (const auto value : values)
+      CHECK(Serializer::get_varint(bytes, pos) == value);
+    CHECK(pos == bytes.size());
+    pos = 2;
+    CHECK_THROWS_AS(Serializer::get_varint(bytes.substr(0, 3), pos),
+                    std::runtime_error);
+  }
+
+  auto reader = Serializer::Reader{path};
+  CHECK(reader.value<unsigned>() == 42u);
+  const auto ints = reader.array<int>();
+  CHECK(std::vector(ints.begin(), ints.end()) == std::vector{1, 2, 3});
+  CHECK(reinterpret_cast<std::uintptr_t>(ints.data()) % Serializer::ALIGNMENT
+        == reinterpret_cast<std::uintptr_t>(reader.file->data)
+             % Serializer::ALIGNMENT);
+  CHECK(reader.value<char>() == 'x');
+  const auto doubles = reader.array<double>();
+  REQUIRE(doubles.size() == 1);
+  CHECK(doubles[0] == 0.5);
+  CHECK(reader.array<bool>().size() == 3);
+  CHECK_THROWS(reader.value<int>());
+
+  // The mapping outlives the reader.
+  const auto copy = ints;
+  reader = Serializer::Reader{path};
+  CHECK(copy[2] == 3);
+  std::filesystem::remove(path);
+}
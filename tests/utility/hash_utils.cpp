@@ -0,0 +1,19 @@
+#include <biovoltron/utility/hash_utils.hpp>
+#include <catch.hpp>
+#include <unordered_set>
+
+using namespace biovoltron;
+
+TEST_CASE("HashUtils") {
+  SECTION("MurmurHash3 finalizer") {
+    // Spilled partitions and saved hashes depend on these values.
+    static_assert(HashUtils::fmix64(0) == 0);
+    CHECK(HashUtils::fmix64(1) == 0xb456bcfc34c2cb2cull);
+    CHECK(HashUtils::fmix64(0x0123456789abcdefull) == 0x87cbfbfe89022ceaull);
+
+    auto hashes = std::unordered_set<std::uint64_t>{};
+    for (auto key = 0ull; key < 1 << 16; key++)
+      hashes.insert(HashUtils::fmix64(key));
+    CHECK(hashes.size() == 1 << 16);
+  }
+}
@@ -0,0 +1,68 @@
+#include <biovoltron/utility/kmer_view.hpp>
+#include <catch.hpp>
+#include <random>
+#include <sstream>
+
+using namespace biovoltron;
+
+TEST_CASE("KmerView") {
+  SECTION("Keys and N-skipping") {
+    auto kmers = std::vector<Kmer>{};
+    for (const auto kmer : std::string{"ACGTNACGn"} | views::kmers(3))
+      kmers.push_back(kmer);
+    REQUIRE(kmers.size() == 3);
+    CHECK(kmers[0] == Kmer{6, 27, 0});
+    CHECK(kmers[1] == Kmer{27, 6, 1});
+    CHECK(kmers[2] == Kmer{6, 27, 5});
+    CHECK(kmers[1].canonical() == 6);
+
+    CHECK(std::ranges::distance(views::kmers(0123_s, 5)) == 0);
+    CHECK(std::ranges::distance(views::kmers(0123_s, 0)) == 0);
+    CHECK(std::ranges::distance(views::kmers(0123_s, 33)) == 0);
+    CHECK(std::ranges::distance(views::kmers(4444_s, 1)) == 0);
+  }
+
+  SECTION("Against Codec::hash") {
+    auto gen = std::mt19937{};
+    auto seq = istring{};
+    for (auto i = 0; i < 2000; i++) seq += gen() % 40 ? gen() % 4 : 4;
+    for (const auto k : {1u, 7u, 21u, 32u}) {
+      auto expect = std::vector<Kmer>{};
+      for (auto i = 0u; i + k <= seq.size(); i++) {
+        const auto kmer = istring_view{seq}.substr(i, k);
+        if (kmer.find(4) == istring_view::npos)
+          expect.push_back(
+            {Codec::hash(kmer), Codec::hash(Codec::rev_comp(kmer)), i});
+      }
+      auto kmers = std::vector<Kmer>{};
+      std::ranges::copy(seq | views::kmers(k), std::back_inserter(kmers));
+      REQUIRE(kmers == expect);
+
+      // Characters and integers give the same k-mers.
+      kmers.clear();
+      std::ranges::copy(views::kmers(Codec::to_string(seq), k),
+                        std::back_inserter(kmers));
+      REQUIRE(kmers == expect);
+    }
+  }
+
+  SECTION("Compose with std::ranges") {
+    const auto seq = std::string{"ACGTACGTAC"};
+    auto view = seq | views::kmers(4)
+                | std::views::filter([](const auto& kmer) {
+                    return kmer.fwd == kmer.canonical();
+                  })
+                | std::views::transform(&Kmer::pos);
+    auto pos = std::vector<std::size_t>{};
+    std::ranges::copy(view, std::back_inserter(pos));
+    CHECK(pos == std::vector<std::size_t>{0, 1, 2, 4, 5, 6});
+    static_assert(std::ranges::forward_range<decltype(seq | views::kmers(4))>);
+
+    auto is = std::istringstream{"ACGTA"};
+    auto stream = std::ranges::subrange{std::istreambuf_iterator<char>{is},
+                                        std::istreambuf_iterator<char>{}};
+    auto count = 0;
+    for (const auto kmer : stream | views::kmers(2)) count += kmer.pos;
+    CHECK(count == 0 + 1 + 2 + 3);
+  }
+}
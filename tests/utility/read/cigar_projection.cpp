@@ -0,0 +1,89 @@
+#include <biovoltron/utility/read/cigar_projection.hpp>
+#include <biovoltron/file_io/sam.hpp>
+#include <catch.hpp>
+#include <random>
+
+using namespace biovoltron;
+
+TEST_CASE("CigarProjection") {
+  SECTION("Clips, insertions and deletions") {
+    const auto projection = CigarProjection{Cigar{"3H2S3M1I2M4D3M2S"}, 100};
+    CHECK(projection.read_size == 13);
+    CHECK(projection.ref_end == 112);
+
+    CHECK_FALSE(projection.ref_pos(0));
+    CHECK(projection.ref_pos(2) == 100);
+    CHECK(projection.ref_pos(4) == 102);
+    CHECK_FALSE(projection.ref_pos(5));
+    CHECK(projection.ref_pos(6) == 103);
+    CHECK(projection.ref_pos(8) == 109);
+    CHECK_FALSE(projection.ref_pos(11));
+    CHECK_FALSE(projection.ref_pos(13));
+
+    CHECK_FALSE(projection.read_offset(99));
+    CHECK(projection.read_offset(100) == 2);
+    CHECK(projection.read_offset(103) == 6);
+    CHECK_FALSE(projection.read_offset(105));
+    CHECK(projection.read_offset(111) == 10);
+    CHECK_FALSE(projection.read_offset(112));
+
+    CHECK(projection.project(std::string{"aaCGTTCAGGGcc"}, '-')
+          == "CGTCA----GGG");
+  }
+
+  SECTION("Spliced") {
+    auto record = SamRecord<>{};
+    record.pos = 11;
+    record.cigar = "6M14N1I5M";
+    record.seq = "ACGTACGTACGT";
+    const auto projection = CigarProjection{record.cigar, record.begin()};
+    CHECK(projection.ref_end == record.end());
+    CHECK(projection.ref_pos(5) == 15);
+    CHECK_FALSE(projection.ref_pos(6));
+    CHECK(projection.ref_pos(7) == 30);
+    CHECK(projection.read_offset(30) == 7);
+    CHECK_FALSE(projection.read_offset(20));
+    CHECK(projection.project(record.seq, 'N')
+          == "ACGTAC" + std::string(14, 'N') + "TACGT");
+  }
+
+  SECTION("Agrees with a walk over the cigar") {
+    auto gen = std::mt19937{};
+    for (auto n = 0; n < 200; n++) {
+      auto cigar = Cigar{};
+      if (gen() % 2)
+        cigar.emplace_back(1 + gen() % 5, gen() % 2 ? 'S' : 'H');
+      for (auto k = gen() % 8; k-- > 0;)
+        cigar.emplace_back(1 + gen() % 10, "MIDN=X"[gen() % 6]);
+      cigar.emplace_back(1 + gen() % 10, 'M');
+      if (gen() % 2)
+        cigar.emplace_back(1 + gen() % 5, 'S');
+
+      const auto projection = CigarProjection{cigar, 50};
+      auto ref_positions = std::vector<std::int64_t>{};
+      auto read_offsets = std::vector<std::int64_t>{};
+      for (const auto [size, op] : cigar)
+        for (auto i = 0u; i < size; i++) {
+          const auto read = Cigar::consumes_read(op);
+          const auto ref = Cigar::consumes_ref(op);
+          if (read)
+            ref_positions.push_back(ref ? 50 + read_offsets.size() : -1);
+          if (ref)
+            read_offsets.push_back(read ? ref_positions.size() - 1 : -1);
+        }
+      REQUIRE(projection.ref_positions() == ref_positions);
+      REQUIRE(projection.read_offsets() == read_offsets);
+      for (auto i = 0u; i <= ref_positions.size(); i++) {
+        const auto pos = projection.ref_pos(i);
+        const auto expect = i < ref_positions.size() ? ref_positions[i] : -1;
+        REQUIRE((pos ? std::int64_t{*pos} : -1) == expect);
+      }
+      for (auto i = 0u; i <= read_offsets.size() + 1; i++) {
+        const auto offset = projection.read_offset(49 + i);
+        const auto expect
+          = i > 0 && i <= read_offsets.size() ? read_offsets[i - 1] : -1;
+        REQUIRE((offset ? std::int64_t{*offset} : -1) == expect);
+      }
+    }
+  }
+}
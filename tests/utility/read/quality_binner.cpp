@@ -0,0 +1,50 @@
+#include <biovoltron/utility/read/quality_binner.hpp>
+#include <biovoltron/file_io/fasta.hpp>
+#include <biovoltron/file_io/sam.hpp>
+#include <catch.hpp>
+#include <random>
+
+using namespace biovoltron;
+
+TEST_CASE("QualityBinner") {
+  SECTION("Illumina 8-level") {
+    const auto binner = QualityBinner::illumina8();
+    const auto expect = [](int q) {
+      if (q < 2) return q;
+      if (q < 10) return 6;
+      if (q < 20) return 15;
+      if (q < 25) return 22;
+      if (q < 30) return 27;
+      if (q < 35) return 33;
+      if (q < 40) return 37;
+      return 40;
+    };
+    auto gen = std::mt19937{};
+    for (auto len : {0, 5, 32, 45, 150}) {
+      auto qual = std::string{};
+      for (auto i = 0; i < len; i++) qual += char('!' + gen() % 94);
+      auto binned = qual;
+      binner.bin(binned);
+      for (auto i = 0; i < len; i++)
+        CHECK(binned[i] - '!' == expect(qual[i] - '!'));
+    }
+  }
+
+  SECTION("Configurable bins and records") {
+    const auto bounds = std::array{10, 30};
+    const auto values = std::array{20, 35};
+    const auto binner = QualityBinner::from_bins(bounds, values);
+    auto read = FastqRecord<>{{"r", "ACGTACGT"}, "#+5?I\x80\x10~"};
+    binner.bin(read);
+    CHECK(read.qual == "#55DD\x80\x10" "D");
+    auto record = SamRecord<>{};
+    record.qual = "*";
+    binner.bin(record);
+    CHECK(record.qual == "*");
+    record.qual = std::string(40, '+');
+    binner.bin(record);
+    CHECK(record.qual == std::string(40, '5'));
+    CHECK_THROWS_AS(QualityBinner::from_bins(values, std::array{1}),
+                    std::invalid_argument);
+  }
+}
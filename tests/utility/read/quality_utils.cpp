@@ -0,0 +1,49 @@
+#include <biovoltron/utility/read/quality_utils.hpp>
+#include <catch.hpp>
+#include <string>
+#include <vector>
+
+using namespace biovoltron;
+
+TEST_CASE("QualityUtils") {
+  SECTION("Tables") {
+    for (auto qual = 1; qual < 100; qual++) {
+      const auto error = std::pow(10.0, qual / -10.0);
+      CHECK(QualityUtils::qual_to_error_prob(qual) == Approx(error));
+      CHECK(QualityUtils::qual_to_prob(qual) == Approx(1 - error));
+      CHECK(QualityUtils::qual_to_error_prob_log10(qual) == -qual / 10.0);
+      CHECK(QualityUtils::qual_to_prob_log10(qual)
+            == Approx(std::log10(1 - error)));
+      CHECK(QualityUtils::qual_to_error_prob_ln(qual)
+            == Approx(std::log(error)));
+      CHECK(QualityUtils::qual_to_prob_ln(qual)
+            == Approx(std::log(1 - error)));
+      CHECK(QualityUtils::phred_scale_error_rate(error) == Approx(qual));
+    }
+    CHECK(QualityUtils::qual_to_error_prob(0) == 1);
+    CHECK(std::isinf(QualityUtils::qual_to_prob_log10(0)));
+    // log1p keeps the precision which 1 - p loses at high quality.
+    CHECK(QualityUtils::qual_to_prob_log10(200)
+          == Approx(-1e-20 / std::log(10.0)));
+    CHECK(QualityUtils::qual_to_prob_ln(200) != 0);
+  }
+
+  SECTION("Batch conversions") {
+    auto qual = std::string{};
+    for (auto i = 0; i < 45; i++) qual += char('!' + i % 42);
+    auto out = std::vector<float>(qual.size());
+    QualityUtils::quals_to_error_probs(qual, out);
+    for (auto i = 0u; i < qual.size(); i++)
+      CHECK(out[i] == float(QualityUtils::qual_to_error_prob(qual[i] - '!')));
+    QualityUtils::quals_to_prob_log10(qual, out);
+    for (auto i = 1u; i < qual.size(); i++)
+      if (qual[i] != '!')
+        CHECK(out[i] == float(QualityUtils::qual_to_prob_log10(qual[i] - '!')));
+    QualityUtils::quals_to_error_prob_log10(qual, out);
+    for (auto i = 0u; i < qual.size(); i++)
+      CHECK(out[i] == float((qual[i] - '!') / -10.0));
+    auto small = std::vector<float>(3);
+    CHECK_THROWS_AS(QualityUtils::quals_to_error_probs(qual, small),
+                    std::invalid_argument);
+  }
+}